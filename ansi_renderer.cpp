@@ -0,0 +1,305 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    The terminal is in raw mode (no output post-processing), so '\r' and '\n' only ever move the cursor and are the
+ *    cheapest moves there are. Everything else is plain ECMA-48: CUP, CUU/CUD/CUF/CUB and SGR.
+ */
+#include <cstring>
+#include <cerrno>
+
+// Linux specific headers.
+#include <unistd.h>
+
+#include "ansi_renderer.h"
+
+// Gaps this short between changed cells are cheaper to write over than to jump.
+const int c_iMaxRewriteGap = 4;
+
+static void Append(AnsiRenderer *pRenderer, const char *pStr)
+{
+    pRenderer->mvOut.insert(pRenderer->mvOut.end(), pStr, pStr + strlen(pStr));
+}
+
+static void AppendCode(AnsiRenderer *pRenderer, int aiNum, char acFinal)
+{
+    char sCode[16];
+    snprintf(sCode, sizeof(sCode), "\e[%d%c", aiNum, acFinal);
+    Append(pRenderer, sCode);
+}
+
+static int Digits(int aiNum)
+{
+    int iDigits = 1;
+
+    for (; 10 <= aiNum; aiNum /= 10)
+    {
+        ++iDigits;
+    }
+
+    return iDigits;
+}
+
+// Bytes it takes to move the cursor along a row with an escape code.
+static int ColumnMoveCost(int aiDist)
+{
+    return (1 == aiDist) ? 3 : (3 + Digits(aiDist));
+}
+
+// Blank cells don't care what color they're drawn in, and nothing does without a color palette.
+template <typename TPalette> static bool SameLook(const Cell &rCell, int aiColor)
+{
+    return !TPalette::c_bColor || ' ' == rCell.mcGlyph || aiColor == rCell.miColor;
+}
+
+// Whether the cells between the cursor and aiX can be written over with what's already meant to be there.
+template <typename TPalette> static bool CanRewrite(const AnsiRenderer *pRenderer, int aiX, int aiY)
+{
+    if ((aiX - pRenderer->miCursorX) > c_iMaxRewriteGap)
+    {
+        return false;
+    }
+
+    for (int iX = pRenderer->miCursorX; iX < aiX; ++iX)
+    {
+        if (!SameLook<TPalette>(pRenderer->mxBack.At(iX, aiY), pRenderer->miColor))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <typename TPalette> static void EmitCell(AnsiRenderer *pRenderer, int aiX, int aiY)
+{
+    const Cell &rCell = pRenderer->mxBack.At(aiX, aiY);
+
+    if (!SameLook<TPalette>(rCell, pRenderer->miColor))
+    {
+        Append(pRenderer, TPalette::Sgr(static_cast<EColor>(rCell.miColor)));
+        pRenderer->miColor = rCell.miColor;
+    }
+
+    pRenderer->mvOut.push_back(rCell.mcGlyph);
+
+    // Writing the last column leaves the cursor waiting to wrap, and terminals don't agree on where that is.
+    if (static_cast<u32>(aiX + 1) >= pRenderer->mxBack.miWidth)
+    {
+        pRenderer->miCursorX = -1;
+        pRenderer->miCursorY = -1;
+    }
+    else
+    {
+        pRenderer->miCursorX = aiX + 1;
+        pRenderer->miCursorY = aiY;
+    }
+}
+
+// Moves along the cursor's row to aiX, picking whichever of the ways to get there is shortest.
+template <typename TPalette> static void MoveAlongRow(AnsiRenderer *pRenderer, int aiX, int aiY)
+{
+    int iDist = aiX - pRenderer->miCursorX;
+
+    if (0 < iDist)
+    {
+        if (iDist <= ColumnMoveCost(iDist) && CanRewrite<TPalette>(pRenderer, aiX, aiY))
+        {
+            while (pRenderer->miCursorX < aiX)
+            {
+                EmitCell<TPalette>(pRenderer, pRenderer->miCursorX, aiY);
+            }
+        }
+        else
+        {
+            AppendCode(pRenderer, iDist, 'C');
+        }
+    }
+    else if (0 > iDist)
+    {
+        if (0 == aiX)
+        {
+            pRenderer->mvOut.push_back('\r');
+        }
+        else if (ColumnMoveCost(-iDist) <= (1 + ColumnMoveCost(aiX)))
+        {
+            AppendCode(pRenderer, -iDist, 'D');
+        }
+        else
+        {
+            pRenderer->mvOut.push_back('\r');
+            AppendCode(pRenderer, aiX, 'C');
+        }
+    }
+
+    pRenderer->miCursorX = aiX;
+}
+
+template <typename TPalette> static void MoveCursor(AnsiRenderer *pRenderer, int aiX, int aiY)
+{
+    if (aiX == pRenderer->miCursorX && aiY == pRenderer->miCursorY)
+    {
+        return;
+    }
+
+    int iAbsCost = 4 + Digits(aiY + 1) + Digits(aiX + 1);
+
+    if (0 <= pRenderer->miCursorY && aiY >= pRenderer->miCursorY)
+    {
+        // Going down a few rows is a run of line feeds, which keep the column.
+        int iRows = aiY - pRenderer->miCursorY;
+        int iRowCost = (iRows <= (3 + Digits(iRows))) ? iRows : (3 + Digits(iRows));
+        int iColDist = aiX - pRenderer->miCursorX;
+        int iColCost = (0 == iColDist) ? 0 : ((0 == aiX) ? 1 : ColumnMoveCost((0 < iColDist) ? iColDist : -iColDist));
+
+        if ((iRowCost + iColCost) < iAbsCost)
+        {
+            if (iRows == iRowCost)
+            {
+                pRenderer->mvOut.insert(pRenderer->mvOut.end(), iRows, '\n');
+            }
+            else
+            {
+                AppendCode(pRenderer, iRows, 'B');
+            }
+
+            pRenderer->miCursorY = aiY;
+            MoveAlongRow<TPalette>(pRenderer, aiX, aiY);
+            return;
+        }
+    }
+
+    char sCode[32];
+    snprintf(sCode, sizeof(sCode), "\e[%d;%dH", aiY + 1, aiX + 1);
+    Append(pRenderer, sCode);
+
+    pRenderer->miCursorX = aiX;
+    pRenderer->miCursorY = aiY;
+}
+
+// Sends everything in mvOut, counting the bytes and the write() calls it took.
+static EError Flush(AnsiRenderer *pRenderer)
+{
+    u64 iSize = pRenderer->mvOut.size();
+    const char *pData = pRenderer->mvOut.data();
+    u64 iSent = 0;
+
+    while (iSent < iSize)
+    {
+        ssize_t iWritten = write(pRenderer->miOutFd, pData + iSent, iSize - iSent);
+        ++pRenderer->mxStats.miWrites;
+
+        if (0 > iWritten)
+        {
+            if (EINTR == errno || EAGAIN == errno)
+            {
+                continue;
+            }
+
+            pRenderer->mvOut.clear();
+            return EError_Unknown;
+        }
+
+        iSent += iWritten;
+    }
+
+    pRenderer->mxStats.miBytes += iSize;
+    if (iSize > pRenderer->mxStats.miMaxFrameBytes)
+    {
+        pRenderer->mxStats.miMaxFrameBytes = iSize;
+    }
+
+    pRenderer->mvOut.clear();
+    return EError_OK;
+}
+
+template <typename TPalette> static EError Present(AnsiRenderer *pRenderer)
+{
+    FrameBuffer *pFront = &pRenderer->mxFront;
+    const FrameBuffer *pBack = &pRenderer->mxBack;
+
+    for (u32 iY = 0; iY < pBack->miHeight; ++iY)
+    {
+        const Cell *pFrontRow = &pFront->mvCells[iY * pBack->miWidth];
+        const Cell *pBackRow = &pBack->mvCells[iY * pBack->miWidth];
+
+        // Rows that didn't change are skipped whole.
+        if (0 == memcmp(pFrontRow, pBackRow, pBack->miWidth * sizeof(Cell)))
+        {
+            continue;
+        }
+
+        for (u32 iX = 0; iX < pBack->miWidth; ++iX)
+        {
+            if (pFrontRow[iX] != pBackRow[iX])
+            {
+                MoveCursor<TPalette>(pRenderer, iX, iY);
+                EmitCell<TPalette>(pRenderer, iX, iY);
+            }
+        }
+    }
+
+    pFront->mvCells = pBack->mvCells;
+    ++pRenderer->mxStats.miFrames;
+
+    return Flush(pRenderer);
+}
+
+EError AnsiInit(AnsiRenderer *pRenderer, int aiOutFd, u32 aiWidth, u32 aiHeight, EPalette aePalette)
+{
+    if (nullptr == pRenderer)
+    {
+        return EError_InvalidArg;
+    }
+
+    pRenderer->miOutFd = aiOutFd;
+    pRenderer->mpPresent = (EPalette_Mono == aePalette) ? Present<MonoPalette> :
+                           ((EPalette_256 == aePalette) ? Present<Palette256> : Present<Palette8>);
+    pRenderer->mxFront.Resize(aiWidth, aiHeight);
+    pRenderer->mxBack.Resize(aiWidth, aiHeight);
+    pRenderer->mvOut.reserve(aiWidth * aiHeight * 8);
+
+    // Alternate screen, no cursor, black background, and a clean slate to match the blank front buffer.
+    Append(pRenderer, "\e[?1049h\e[?25l\e[0;40m\e[2J\e[H");
+    pRenderer->miCursorX = 0;
+    pRenderer->miCursorY = 0;
+    pRenderer->miColor = EColor_Default;
+
+    EError eErr = Flush(pRenderer);
+    pRenderer->mxStats = OutputStats();
+
+    return eErr;
+}
+
+EError AnsiPresent(AnsiRenderer *pRenderer)
+{
+    return pRenderer->mpPresent(pRenderer);
+}
+
+// For when the terminal's mangled what's on screen (a resize), so the front buffer can't be trusted any more. The
+// clear goes out with the next frame.
+void AnsiRepaint(AnsiRenderer *pRenderer)
+{
+    Append(pRenderer, "\e[0;40m\e[2J\e[H");
+    pRenderer->mxFront.Clear();
+    pRenderer->miCursorX = 0;
+    pRenderer->miCursorY = 0;
+    pRenderer->miColor = EColor_Default;
+}
+
+void AnsiShutdown(AnsiRenderer *pRenderer)
+{
+    Append(pRenderer, "\e[0m\e[?25h\e[?1049l");
+
+    u64 iWrites = pRenderer->mxStats.miWrites;
+    u64 iBytes = pRenderer->mxStats.miBytes;
+    u64 iMax = pRenderer->mxStats.miMaxFrameBytes;
+    Flush(pRenderer);
+
+    // Leaving the screen isn't part of any frame.
+    pRenderer->mxStats.miWrites = iWrites;
+    pRenderer->mxStats.miBytes = iBytes;
+    pRenderer->mxStats.miMaxFrameBytes = iMax;
+}
@@ -0,0 +1,40 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    A renderer that talks to the terminal directly instead of going through NCurses. Frames are composed into a back
+ *    buffer, diffed against what's already on screen and only the changed cells are sent, as the fewest escape codes
+ *    it can manage, in a single write().
+ */
+#ifndef SHELL_INVADERS_ANSI_RENDERER_H
+#define SHELL_INVADERS_ANSI_RENDERER_H
+
+#include <vector>
+
+#include "game.h"
+#include "framebuffer.h"
+#include "palette.h"
+
+struct AnsiRenderer
+{
+    int miOutFd; //!< Where frames get written.
+    EError (*mpPresent)(AnsiRenderer *pRenderer); //!< AnsiPresent() specialized for the palette.
+    FrameBuffer mxFront; //!< What the terminal is showing.
+    FrameBuffer mxBack; //!< What the next frame should show.
+    std::vector<char> mvOut; //!< Escape codes built up for the frame being presented.
+    int miCursorX; //!< Where the terminal's cursor is, -1 when it isn't known.
+    int miCursorY;
+    int miColor; //!< Color the terminal is drawing in, -1 when it isn't known.
+    OutputStats mxStats;
+
+    AnsiRenderer() : miOutFd(-1), mpPresent(nullptr), miCursorX(-1), miCursorY(-1), miColor(-1) {}
+};
+
+EError AnsiInit(AnsiRenderer *pRenderer, int aiOutFd, u32 aiWidth, u32 aiHeight, EPalette aePalette); //!< Takes over the screen.
+EError AnsiPresent(AnsiRenderer *pRenderer); //!< Sends the difference between the back and front buffers.
+void AnsiRepaint(AnsiRenderer *pRenderer); //!< Clears the screen, the next AnsiPresent() sends every cell again.
+void AnsiShutdown(AnsiRenderer *pRenderer); //!< Gives the screen back.
+
+#endif // SHELL_INVADERS_ANSI_RENDERER_H
@@ -0,0 +1,466 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "batch.h"
+#include "game.h"
+#include "headless.h"
+#include "scheduler.h"
+
+// Parameters that can be swept, by the name they're given on the command line.
+enum ESweep
+{
+    ESweep_HordeReset,
+    ESweep_FireCooldown,
+    ESweep_EnemyFireOdds,
+    ESweep_UFOOdds,
+    ESweep_Lives,
+    ESweep_Count
+};
+
+static const char *s_vSweepNames[ESweep_Count] = { "horde-reset", "fire-cooldown", "enemy-fire-odds", "ufo-odds",
+                                                    "lives" };
+
+// Most ticks between horde moves a sweep can ask for, the most the fixed point holds.
+static const double c_nMaxHordeReset = 65535;
+
+struct BatchJob
+{
+    u32 miSet; //!< Parameter set the game is played with.
+    u64 miSeed; //!< Seed for the game and its random input.
+};
+
+struct BatchResult
+{
+    bool mbWin; //!< The horde was wiped out.
+    bool mbCapped; //!< Still going when the tick cap was hit.
+    u64 miTicks; //!< Ticks the game took.
+    u32 miScore; //!< Final score.
+};
+
+// One per worker. The owner pushes and pops at the back, thieves take from the front.
+struct WorkQueue
+{
+    std::mutex mxLock;
+    std::deque<u32> mvJobs; //!< Indices into the job list.
+};
+
+struct BatchRun
+{
+    u32 miWidth;
+    u32 miHeight;
+    u64 miMaxTicks; //!< Most ticks a single game may run for.
+    const char *mpScript; //!< Keys to loop, nullptr for random input.
+    std::vector<GameParams> mvSets;
+    std::vector<BatchJob> mvJobs;
+    std::vector<BatchResult> mvResults; //!< One per job, each written only by the thread that played it.
+    std::vector<WorkQueue*> mvQueues;
+    std::vector<u64> mvSteals; //!< Jobs each worker took from someone else.
+};
+
+static bool SetSweepValue(GameParams *pParams, ESweep aeSweep, double anValue)
+{
+    if (0 > anValue || (ESweep_HordeReset != aeSweep && 0 == anValue) ||
+        (ESweep_HordeReset == aeSweep && c_nMaxHordeReset < anValue))
+    {
+        return false;
+    }
+
+    switch (aeSweep)
+    {
+        case ESweep_HordeReset:
+            // Fractions of a tick are kept, to the nearest the fixed point can hold.
+            pParams->miHordeReset = static_cast<u32>((anValue * (1 << c_iHordeResetShift)) + 0.5);
+            break;
+        case ESweep_FireCooldown:
+            pParams->miFireCooldown = static_cast<u32>(anValue);
+            break;
+        case ESweep_EnemyFireOdds:
+            pParams->miEnemyFireOdds = static_cast<u32>(anValue);
+            break;
+        case ESweep_UFOOdds:
+            pParams->miUFOSpawnOdds = static_cast<u32>(anValue);
+            break;
+        case ESweep_Lives:
+            pParams->miLives = static_cast<u32>(anValue);
+            break;
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+// Parses NAME=V1,V2,... and multiplies the sets out by every value given.
+static bool AddSweep(std::vector<GameParams> *pSets, const char *pArg)
+{
+    const char *pEquals = strchr(pArg, '=');
+    u32 iSweep = 0;
+
+    for (; nullptr != pEquals && iSweep < ESweep_Count; ++iSweep)
+    {
+        if (strlen(s_vSweepNames[iSweep]) == static_cast<size_t>(pEquals - pArg) &&
+            0 == strncmp(pArg, s_vSweepNames[iSweep], pEquals - pArg))
+        {
+            break;
+        }
+    }
+
+    if (nullptr == pEquals || ESweep_Count == iSweep)
+    {
+        return false;
+    }
+
+    std::vector<GameParams> vOut;
+    const char *pValue = pEquals + 1;
+
+    while ('\0' != *pValue)
+    {
+        char *pEnd = nullptr;
+        double nValue = strtod(pValue, &pEnd);
+
+        if (pEnd == pValue || (',' != *pEnd && '\0' != *pEnd))
+        {
+            return false;
+        }
+
+        for (size_t iIdx = 0; iIdx < pSets->size(); ++iIdx)
+        {
+            GameParams xParams = (*pSets)[iIdx];
+
+            if (!SetSweepValue(&xParams, static_cast<ESweep>(iSweep), nValue))
+            {
+                return false;
+            }
+
+            vOut.push_back(xParams);
+        }
+
+        pValue = (',' == *pEnd) ? (pEnd + 1) : pEnd;
+    }
+
+    if (vOut.empty())
+    {
+        return false;
+    }
+
+    pSets->swap(vOut);
+    return true;
+}
+
+// Plays one game from the intro screen to the end, in whatever world the calling thread has.
+static void PlayGame(const BatchRun *pRun, const BatchJob *pJob, BatchResult *pResult)
+{
+    World *pWorld = g_pWorld;
+    pWorld->mxParams = pRun->mvSets[pJob->miSet];
+
+    // RunBatch() has already laid this board out once, this can't fail unless that check goes.
+    if (EError_OK != InitGame(pRun->miWidth, pRun->miHeight, &pWorld->mxPlayer, &pWorld->mxScore))
+    {
+        memset(pResult, 0, sizeof(BatchResult));
+        return;
+    }
+
+    SeedGame(pJob->miSeed);
+
+    Rng xInputRng;
+    xInputRng.Seed(pJob->miSeed, ERngStream_Input);
+
+    u32 iScriptLen = (nullptr == pRun->mpScript) ? 0 : strlen(pRun->mpScript);
+    u64 iTick = 0;
+
+    ApplyInput(EInput_Start, &pWorld->mxPlayer, &pWorld->mxScore);
+
+    for (; iTick < pRun->miMaxTicks && !pWorld->mbGameOver && !pWorld->mbWin; ++iTick)
+    {
+        StepGame(&pWorld->mxPlayer, &pWorld->mxScore);
+
+        EInput eInput = (0 == iScriptLen) ? RandomInput(&xInputRng) : CharToInput(pRun->mpScript[iTick % iScriptLen]);
+        ApplyInput(eInput, &pWorld->mxPlayer, &pWorld->mxScore);
+    }
+
+    pResult->mbWin = pWorld->mbWin;
+    pResult->mbCapped = !pWorld->mbGameOver && !pWorld->mbWin;
+    pResult->miTicks = iTick;
+    pResult->miScore = pWorld->mxScore.miValue;
+
+    ShutdownGame();
+}
+
+// Takes the next job, from the back of our own queue or, failing that, the front of someone else's.
+static bool TakeJob(BatchRun *pRun, u32 aiWorker, Rng *pRng, u32 *pJob)
+{
+    WorkQueue *pOwn = pRun->mvQueues[aiWorker];
+
+    {
+        std::lock_guard<std::mutex> xGuard(pOwn->mxLock);
+
+        if (!pOwn->mvJobs.empty())
+        {
+            *pJob = pOwn->mvJobs.back();
+            pOwn->mvJobs.pop_back();
+            return true;
+        }
+    }
+
+    // Start at a random victim so the thieves don't all pile onto the same queue.
+    u32 iWorkers = pRun->mvQueues.size();
+    u32 iFirst = pRng->Below(iWorkers);
+
+    for (u32 iIdx = 0; iIdx < iWorkers; ++iIdx)
+    {
+        WorkQueue *pVictim = pRun->mvQueues[(iFirst + iIdx) % iWorkers];
+
+        if (pVictim == pOwn)
+        {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> xGuard(pVictim->mxLock);
+
+        if (!pVictim->mvJobs.empty())
+        {
+            *pJob = pVictim->mvJobs.front();
+            pVictim->mvJobs.pop_front();
+            ++pRun->mvSteals[aiWorker];
+            return true;
+        }
+    }
+
+    // No job ever makes another, so once every queue is empty we're done.
+    return false;
+}
+
+static void RunWorker(BatchRun *pRun, u32 aiWorker)
+{
+    World xWorld;
+    g_pWorld = &xWorld;
+
+    Rng xStealRng;
+    xStealRng.Seed(aiWorker + 1, 0);
+
+    u32 iJob = 0;
+
+    while (TakeJob(pRun, aiWorker, &xStealRng, &iJob))
+    {
+        PlayGame(pRun, &pRun->mvJobs[iJob], &pRun->mvResults[iJob]);
+    }
+
+    g_pWorld = nullptr;
+}
+
+template <typename T> static T PercentileOf(const std::vector<T> &vSorted, double anPercent)
+{
+    size_t iRank = static_cast<size_t>((anPercent / 100.0) * (vSorted.size() - 1) + 0.5);
+    return vSorted[iRank];
+}
+
+static void ReportSet(const BatchRun *pRun, u32 aiSet, u32 aiGames)
+{
+    const GameParams &xParams = pRun->mvSets[aiSet];
+    std::vector<u64> vTicks;
+    std::vector<u32> vScores;
+    u64 iWins = 0;
+    u64 iCapped = 0;
+    u64 iTotalTicks = 0;
+    u64 iTotalScore = 0;
+
+    vTicks.reserve(aiGames);
+    vScores.reserve(aiGames);
+
+    // Jobs were laid out set by set.
+    for (u32 iIdx = aiSet * aiGames; iIdx < (aiSet + 1) * aiGames; ++iIdx)
+    {
+        const BatchResult &xResult = pRun->mvResults[iIdx];
+
+        iWins += xResult.mbWin ? 1 : 0;
+        iCapped += xResult.mbCapped ? 1 : 0;
+        iTotalTicks += xResult.miTicks;
+        iTotalScore += xResult.miScore;
+        vTicks.push_back(xResult.miTicks);
+        vScores.push_back(xResult.miScore);
+    }
+
+    std::sort(vTicks.begin(), vTicks.end());
+    std::sort(vScores.begin(), vScores.end());
+
+    printf("set,%u,%g,%u,%u,%u,%u,%u,%llu,%llu,%.4f,%.1f,%llu,%llu,%.1f,%u,%u,%u,%u\n", aiSet,
+           static_cast<double>(xParams.miHordeReset) / (1 << c_iHordeResetShift), xParams.miFireCooldown,
+           xParams.miEnemyFireOdds, xParams.miUFOSpawnOdds, xParams.miLives, aiGames, iWins, iCapped,
+           static_cast<double>(iWins) / aiGames, static_cast<double>(iTotalTicks) / aiGames, PercentileOf(vTicks, 50),
+           vTicks.back(), static_cast<double>(iTotalScore) / aiGames, PercentileOf(vScores, 10),
+           PercentileOf(vScores, 50), PercentileOf(vScores, 90), vScores.back());
+}
+
+int RunBatch(int argc, char **argv)
+{
+    BatchRun xRun;
+    xRun.miWidth = 80;
+    xRun.miHeight = 24;
+    xRun.miMaxTicks = 1000000;
+    xRun.mpScript = nullptr;
+    xRun.mvSets.push_back(GameParams());
+
+    u32 iGames = 1000;
+    u32 iThreads = std::thread::hardware_concurrency();
+    u64 iSeed = 1;
+
+    for (int iIdx = 1; iIdx < argc; ++iIdx)
+    {
+        if (0 == strcmp(argv[iIdx], "--headless") || 0 == strcmp(argv[iIdx], "--batch"))
+        {
+            // Already here.
+        }
+        else if (0 == strcmp(argv[iIdx], "--size") && (iIdx + 1) < argc)
+        {
+            if (2 != sscanf(argv[++iIdx], "%ux%u", &xRun.miWidth, &xRun.miHeight))
+            {
+                fprintf(stderr, "Board size must be given as WIDTHxHEIGHT!\n");
+                return -3;
+            }
+        }
+        else if (0 == strcmp(argv[iIdx], "--games") && (iIdx + 1) < argc)
+        {
+            iGames = strtoul(argv[++iIdx], nullptr, 10);
+        }
+        else if (0 == strcmp(argv[iIdx], "--threads") && (iIdx + 1) < argc)
+        {
+            iThreads = strtoul(argv[++iIdx], nullptr, 10);
+        }
+        else if (0 == strcmp(argv[iIdx], "--seed") && (iIdx + 1) < argc)
+        {
+            iSeed = strtoull(argv[++iIdx], nullptr, 10);
+        }
+        else if (0 == strcmp(argv[iIdx], "--script") && (iIdx + 1) < argc)
+        {
+            xRun.mpScript = argv[++iIdx];
+        }
+        else if (0 == strcmp(argv[iIdx], "--max-ticks") && (iIdx + 1) < argc)
+        {
+            xRun.miMaxTicks = strtoull(argv[++iIdx], nullptr, 10);
+        }
+        else if (0 == strcmp(argv[iIdx], "--sweep") && (iIdx + 1) < argc)
+        {
+            if (!AddSweep(&xRun.mvSets, argv[++iIdx]))
+            {
+                fprintf(stderr, "Sweeps are NAME=V1,V2,... with NAME one of horde-reset, fire-cooldown, "
+                        "enemy-fire-odds, ufo-odds or lives!\n");
+                return -3;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s --batch [--games N] [--threads N] [--size WxH] [--seed N] [--script KEYS]"
+                    " [--max-ticks N] [--sweep NAME=V1,V2,...]...\n", argv[0]);
+            return -3;
+        }
+    }
+
+    if (c_iMinBoardWidth > xRun.miWidth || c_iMinBoardHeight > xRun.miHeight || c_iMaxBoardWidth < xRun.miWidth ||
+        c_iMaxBoardHeight < xRun.miHeight)
+    {
+        fprintf(stderr, "Board must be between %ux%u and %ux%u!\n", c_iMinBoardWidth, c_iMinBoardHeight,
+                c_iMaxBoardWidth, c_iMaxBoardHeight);
+        return -1;
+    }
+
+    // Every game is played on the same board, so it's laid out once here first and no worker ever starts on one that
+    // InitGame() won't take.
+    World xTrial;
+    World *pMainWorld = g_pWorld;
+    g_pWorld = &xTrial;
+    EError eLayout = InitGame(xRun.miWidth, xRun.miHeight, &xTrial.mxPlayer, &xTrial.mxScore);
+    ShutdownGame();
+    g_pWorld = pMainWorld;
+
+    if (EError_OK != eLayout)
+    {
+        fprintf(stderr, "Board must be between %ux%u and %ux%u!\n", c_iMinBoardWidth, c_iMinBoardHeight,
+                c_iMaxBoardWidth, c_iMaxBoardHeight);
+        return -1;
+    }
+
+    if (0 == iGames)
+    {
+        fprintf(stderr, "Need at least one game per set!\n");
+        return -3;
+    }
+
+    iThreads = (0 == iThreads) ? 1 : iThreads;
+
+    // Every set plays the same seeds, so differences between sets come from the parameters and not the luck of the
+    // draw.
+    u32 iSets = xRun.mvSets.size();
+    u32 iJobs = iSets * iGames;
+
+    xRun.mvJobs.resize(iJobs);
+    xRun.mvResults.resize(iJobs);
+    xRun.mvSteals.assign(iThreads, 0);
+
+    for (u32 iIdx = 0; iIdx < iJobs; ++iIdx)
+    {
+        xRun.mvJobs[iIdx].miSet = iIdx / iGames;
+        xRun.mvJobs[iIdx].miSeed = iSeed + (iIdx % iGames);
+    }
+
+    // Each worker starts with an even, contiguous share. Game lengths vary a lot between sets, stealing evens it out.
+    for (u32 iIdx = 0; iIdx < iThreads; ++iIdx)
+    {
+        WorkQueue *pQueue = new WorkQueue();
+        u32 iBegin = static_cast<u32>((static_cast<u64>(iJobs) * iIdx) / iThreads);
+        u32 iEnd = static_cast<u32>((static_cast<u64>(iJobs) * (iIdx + 1)) / iThreads);
+
+        for (u32 iJob = iBegin; iJob < iEnd; ++iJob)
+        {
+            pQueue->mvJobs.push_back(iJob);
+        }
+
+        xRun.mvQueues.push_back(pQueue);
+    }
+
+    u64 iStart = GetMonotonicNs();
+    std::vector<std::thread> vWorkers;
+
+    for (u32 iIdx = 0; iIdx < iThreads; ++iIdx)
+    {
+        vWorkers.push_back(std::thread(RunWorker, &xRun, iIdx));
+    }
+
+    for (u32 iIdx = 0; iIdx < iThreads; ++iIdx)
+    {
+        vWorkers[iIdx].join();
+    }
+
+    double nSeconds = (GetMonotonicNs() - iStart) / 1000000000.0;
+    u64 iSteals = 0;
+
+    for (u32 iIdx = 0; iIdx < iThreads; ++iIdx)
+    {
+        iSteals += xRun.mvSteals[iIdx];
+        delete xRun.mvQueues[iIdx];
+    }
+
+    printf("set,id,horde_reset,fire_cooldown,enemy_fire_odds,ufo_odds,lives,games,wins,capped,win_rate,mean_ticks,"
+           "p50_ticks,max_ticks,mean_score,p10_score,p50_score,p90_score,max_score\n");
+
+    for (u32 iIdx = 0; iIdx < iSets; ++iIdx)
+    {
+        ReportSet(&xRun, iIdx, iGames);
+    }
+
+    fprintf(stderr, "Board: %ux%u    Sets: %u    Games: %u    Threads: %u    Steals: %llu    Time: %.3fs    "
+            "Games/s: %.0f\n", xRun.miWidth, xRun.miHeight, iSets, iJobs, iThreads, iSteals, nSeconds,
+            (0 == nSeconds) ? 0.0 : (iJobs / nSeconds));
+
+    return 0;
+}
@@ -0,0 +1,18 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    Batch runner for tuning the game. Plays thousands of headless games for every combination of the swept
+ *    GameParams, spread over every core. Each worker thread plays its games in its own World, keeps a deque of jobs,
+ *    and steals from the other end of someone else's when it runs dry, so a few long games don't hold up a thread.
+ *
+ *    Results are CSV, one line per parameter set, with the win rate, game lengths and score distribution.
+ */
+#ifndef SHELL_INVADERS_BATCH_H
+#define SHELL_INVADERS_BATCH_H
+
+int RunBatch(int argc, char **argv); //!< Runs the parameter sweep the command line describes, returns the exit code.
+
+#endif // SHELL_INVADERS_BATCH_H
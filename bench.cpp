@@ -0,0 +1,459 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    Microbenchmarks for the simulation's hot paths, on synthetic boards from 80x24 up to thousands of rows and
+ *    columns, and with up to 10k bullets in flight. Run it through the `bench` target.
+ *
+ *    Output is CSV, one "result" line per benchmark and size, then one "scaling" line per benchmark giving the
+ *    exponent k of a least-squares fit of cost ~ n^k (n being board cells or bullets). A benchmark scaling worse than
+ *    its limit is flagged as a REGRESSION and the exit code is non-zero.
+ *
+ *    Options:
+ *        --quick             Skip the largest size and shorten every run.
+ *        --filter NAME       Only run benchmarks whose name contains NAME.
+ *        --time-ms N         Time spent measuring each result (default 200).
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <new>
+
+#include "game.h"
+#include "scheduler.h"
+#include "framebuffer.h"
+#include "snapshot.h"
+
+// Every allocation the game makes goes through these, so they're counted.
+static u64 s_iAllocs = 0;
+
+void* operator new(size_t aiSize)
+{
+    ++s_iAllocs;
+
+    void *pMem = malloc((0 == aiSize) ? 1 : aiSize);
+    if (nullptr == pMem)
+    {
+        throw std::bad_alloc();
+    }
+
+    return pMem;
+}
+
+void* operator new[](size_t aiSize)
+{
+    return operator new(aiSize);
+}
+
+void operator delete(void *pMem) noexcept
+{
+    free(pMem);
+}
+
+void operator delete[](void *pMem) noexcept
+{
+    free(pMem);
+}
+
+// Accumulates time and allocations over the timed parts of a benchmark, setup in between isn't counted.
+struct BenchClock
+{
+    u64 miNs; //!< Time spent in timed sections.
+    u64 miOps; //!< Operations run in timed sections.
+    u64 miAllocs; //!< Allocations made in timed sections.
+    u64 miStartNs;
+    u64 miStartAllocs;
+
+    BenchClock() : miNs(0), miOps(0), miAllocs(0), miStartNs(0), miStartAllocs(0) {}
+
+    void Start()
+    {
+        miStartAllocs = s_iAllocs;
+        miStartNs = GetMonotonicNs();
+    }
+
+    void Stop(u64 aiOps)
+    {
+        miNs += GetMonotonicNs() - miStartNs;
+        miAllocs += s_iAllocs - miStartAllocs;
+        miOps += aiOps;
+    }
+};
+
+// One benchmark at one size. The function runs a batch (untimed setup, then a timed section) and is called until
+// enough time has been measured.
+typedef void (*BenchFunc)(u32 aiWidth, u32 aiHeight, u32 aiBullets, BenchClock *pClock);
+
+struct BenchCase
+{
+    const char *mpName;
+    BenchFunc mpFunc;
+    bool mbBulletScaled; //!< Scales with the bullet count rather than the board size.
+    double mnMaxExponent; //!< Worst scaling exponent that isn't a regression.
+};
+
+static GameObject s_xPlyr;
+static GameObject s_xScore;
+static Rng s_xRng;
+
+// Board sizes and bullet counts swept, the bullet benchmarks run on c_iBulletBoard.
+static const u32 c_iBoardSizes[][2] = { { 80, 24 }, { 320, 96 }, { 1280, 384 }, { 5120, 1536 } };
+static const u32 c_iNumBoardSizes = sizeof(c_iBoardSizes) / sizeof(c_iBoardSizes[0]);
+static const u32 c_iBulletCounts[] = { 1, 10, 100, 1000, 10000 };
+static const u32 c_iNumBulletCounts = sizeof(c_iBulletCounts) / sizeof(c_iBulletCounts[0]);
+static const u32 c_iBulletBoard[2] = { 1280, 384 };
+
+// Bullets checked per batch by the collision benchmarks.
+static const u32 c_iCollisionBatch = 1024;
+
+// What a fresh board looks like, so a benchmark can put it back without building it again.
+static Horde s_xHordeSnap;
+static BarrierTable s_xBarrierSnap;
+static std::vector<u16> s_vBarrierColumnSnap;
+
+// Sets up a fresh game on a board of the given size. The board is only built when the size changes, otherwise
+// whatever the last batch did to it is undone.
+static void SetupBoard(u32 aiWidth, u32 aiHeight)
+{
+    if (g_pWorld->miBoardWidth != static_cast<int>(aiWidth) || g_pWorld->miBoardHeight != static_cast<int>(aiHeight))
+    {
+        InitGame(aiWidth, aiHeight, &s_xPlyr, &s_xScore);
+        SeedGame(1);
+        NewGame(&s_xPlyr, &s_xScore);
+        g_pWorld->mbIsIntro = false;
+
+        s_xHordeSnap = g_pWorld->mxHorde;
+        s_xBarrierSnap = g_pWorld->mxBarriers;
+        s_vBarrierColumnSnap = g_pWorld->mvBarrierColumns;
+    }
+
+    g_pWorld->mxHorde = s_xHordeSnap;
+    g_pWorld->mxBarriers = s_xBarrierSnap;
+    g_pWorld->mvBarrierColumns = s_vBarrierColumnSnap;
+    g_pWorld->mxBullets.mxPlayer.Clear();
+    g_pWorld->mxBullets.mxEnemy.Clear();
+    g_pWorld->miHordeReset = g_pWorld->mxParams.miHordeReset;
+    g_pWorld->miLives = 3;
+    g_pWorld->mbGameOver = false;
+    g_pWorld->mbWin = false;
+    g_pWorld->mbMoveDown = false;
+    s_xScore.miValue = 0;
+}
+
+static void BenchCreateBoard(u32 aiWidth, u32 aiHeight, u32, BenchClock *pClock)
+{
+    SetupBoard(aiWidth, aiHeight);
+
+    pClock->Start();
+    CreateBoard(&s_xPlyr);
+    pClock->Stop(1);
+}
+
+static void BenchMoveHorde(u32 aiWidth, u32 aiHeight, u32, BenchClock *pClock)
+{
+    SetupBoard(aiWidth, aiHeight);
+
+    // Moves stop being representative once the horde lands, so the batch is kept short.
+    const u32 c_iMoves = 16;
+
+    pClock->Start();
+    for (u32 iIdx = 0; iIdx < c_iMoves; ++iIdx)
+    {
+        MoveHorde();
+    }
+    pClock->Stop(c_iMoves);
+}
+
+static void BenchEnemyCollision(u32 aiWidth, u32 aiHeight, u32, BenchClock *pClock)
+{
+    SetupBoard(aiWidth, aiHeight);
+
+    // Bullets spread over the formation, about half of them sitting on an enemy.
+    static int s_vBulletX[c_iCollisionBatch];
+    static int s_vBulletY[c_iCollisionBatch];
+    int iSpanX = (g_pWorld->mxHorde.miCols * c_iHordeXSpacing);
+    int iSpanY = (g_pWorld->mxHorde.miRows * c_iHordeYSpacing);
+
+    for (u32 iIdx = 0; iIdx < c_iCollisionBatch; ++iIdx)
+    {
+        s_vBulletX[iIdx] = g_pWorld->mxHorde.miOriginX + s_xRng.Below(iSpanX);
+        s_vBulletY[iIdx] = g_pWorld->mxHorde.miOriginY + s_xRng.Below(iSpanY);
+    }
+
+    pClock->Start();
+    for (u32 iIdx = 0; iIdx < c_iCollisionBatch; ++iIdx)
+    {
+        CheckEnemyCollision(s_vBulletX[iIdx], s_vBulletY[iIdx], &s_xScore);
+    }
+    pClock->Stop(c_iCollisionBatch);
+}
+
+static void BenchBarrierCollision(u32 aiWidth, u32 aiHeight, u32, BenchClock *pClock)
+{
+    SetupBoard(aiWidth, aiHeight);
+
+    // Bullets along the barrier line, hitting barriers and the gaps between them.
+    static int s_vBulletX[c_iCollisionBatch];
+
+    for (u32 iIdx = 0; iIdx < c_iCollisionBatch; ++iIdx)
+    {
+        s_vBulletX[iIdx] = s_xRng.Below(aiWidth);
+    }
+
+    pClock->Start();
+    for (u32 iIdx = 0; iIdx < c_iCollisionBatch; ++iIdx)
+    {
+        CheckBarrierCollision(s_vBulletX[iIdx], g_pWorld->miBarrierY);
+    }
+    pClock->Stop(c_iCollisionBatch);
+}
+
+// Fills both lanes with bullets spread between the horde and the player.
+static void SpawnBullets(u32 aiBullets)
+{
+    g_pWorld->mxBullets.mxPlayer.Clear();
+    g_pWorld->mxBullets.mxEnemy.Clear();
+
+    u32 iTop = g_pWorld->mxHorde.miOriginY;
+    u32 iSpan = static_cast<u32>(s_xPlyr.miYPos) - iTop;
+
+    for (u32 iIdx = 0; iIdx < aiBullets; ++iIdx)
+    {
+        BulletLane *pLane = (0 == (iIdx & 1)) ? &g_pWorld->mxBullets.mxPlayer : &g_pWorld->mxBullets.mxEnemy;
+        pLane->Spawn(s_xRng.Below(g_pWorld->miBoardWidth), iTop + s_xRng.Below(iSpan));
+    }
+}
+
+static void BenchUpdateBullets(u32 aiWidth, u32 aiHeight, u32 aiBullets, BenchClock *pClock)
+{
+    SetupBoard(aiWidth, aiHeight);
+    SpawnBullets(aiBullets);
+
+    pClock->Start();
+    UpdateBullets(&s_xPlyr, &s_xScore);
+    pClock->Stop(1);
+}
+
+static void BenchComposeFrame(u32 aiWidth, u32 aiHeight, u32 aiBullets, BenchClock *pClock)
+{
+    static FrameBuffer s_xFrame;
+
+    SetupBoard(aiWidth, aiHeight);
+    SpawnBullets(aiBullets);
+    SetViewport(aiWidth, aiHeight);
+    s_xFrame.Resize(aiWidth, aiHeight);
+
+    pClock->Start();
+    ComposeFrame(&s_xFrame, &s_xPlyr, &s_xScore);
+    pClock->Stop(1);
+}
+
+// A terminal's worth of an arena, which shouldn't cost more as the arena around it grows.
+static void BenchComposeView(u32 aiWidth, u32 aiHeight, u32 aiBullets, BenchClock *pClock)
+{
+    static FrameBuffer s_xFrame;
+
+    SetupBoard(aiWidth, aiHeight);
+    SpawnBullets(aiBullets);
+    SetViewport(c_iBoardSizes[0][0], c_iBoardSizes[0][1]);
+    FollowPlayer(&s_xPlyr);
+    s_xFrame.Resize(g_pWorld->mxView.miWidth, g_pWorld->mxView.miHeight);
+
+    pClock->Start();
+    ComposeFrame(&s_xFrame, &s_xPlyr, &s_xScore);
+    pClock->Stop(1);
+}
+
+// What the bot pays for every line of play it tries. The clone is reused, as the bot's are, so after the warm up run
+// this should never allocate. The horde's mask and the per row and column tables still grow with the board, but only
+// the occupancy grid's chunks in use get copied.
+static void BenchCloneWorld(u32 aiWidth, u32 aiHeight, u32 aiBullets, BenchClock *pClock)
+{
+    static World s_xClone;
+
+    SetupBoard(aiWidth, aiHeight);
+    SpawnBullets(aiBullets);
+
+    pClock->Start();
+    CloneWorld(&s_xClone, g_pWorld);
+    pClock->Stop(1);
+}
+
+// What the front-end pays for its rewind and crash dump snapshots. The buffer is reused, as theirs are, so after the
+// warm up run only a bigger snapshot than the last allocates.
+static void BenchSnapshotSave(u32 aiWidth, u32 aiHeight, u32 aiBullets, BenchClock *pClock)
+{
+    static std::vector<byte> s_vSnapshot;
+
+    SetupBoard(aiWidth, aiHeight);
+    SpawnBullets(aiBullets);
+
+    pClock->Start();
+    SnapshotSave(&s_vSnapshot, 0, &s_xPlyr, &s_xScore);
+    pClock->Stop(1);
+}
+
+// Rewinding. Restoring puts back what was just saved, so the board is the same every batch.
+static void BenchSnapshotRestore(u32 aiWidth, u32 aiHeight, u32 aiBullets, BenchClock *pClock)
+{
+    static std::vector<byte> s_vSnapshot;
+    u64 iTick = 0;
+
+    SetupBoard(aiWidth, aiHeight);
+    SpawnBullets(aiBullets);
+    SnapshotSave(&s_vSnapshot, 0, &s_xPlyr, &s_xScore);
+
+    pClock->Start();
+    SnapshotRestore(s_vSnapshot, &s_xPlyr, &s_xScore, &iTick);
+    pClock->Stop(1);
+}
+
+static const BenchCase c_vCases[] =
+{
+    { "create_board", BenchCreateBoard, false, 1.25 },
+    { "move_horde", BenchMoveHorde, false, 1.25 },
+    { "enemy_collision", BenchEnemyCollision, false, 0.5 },
+    { "barrier_collision", BenchBarrierCollision, false, 0.5 },
+    { "update_bullets", BenchUpdateBullets, true, 1.25 },
+    { "compose_frame", BenchComposeFrame, true, 1.25 },
+    { "compose_view", BenchComposeView, false, 0.5 },
+    { "clone_world", BenchCloneWorld, false, 1.0 },
+    { "snapshot_save", BenchSnapshotSave, false, 1.0 },
+    { "snapshot_restore", BenchSnapshotRestore, false, 1.0 }
+};
+
+// Runs a benchmark until enough time was measured, prints its result line and returns the ns per op.
+static double RunCase(const BenchCase *pCase, u32 aiWidth, u32 aiHeight, u32 aiBullets, u64 aiBudgetNs)
+{
+    BenchClock xClock;
+
+    // One run to warm up, then measure.
+    pCase->mpFunc(aiWidth, aiHeight, aiBullets, &xClock);
+    xClock = BenchClock();
+
+    // Setup isn't timed, but it still takes time, so give up on a slow one eventually.
+    u64 iGiveUp = GetMonotonicNs() + (aiBudgetNs * 10);
+
+    while (xClock.miNs < aiBudgetNs && GetMonotonicNs() < iGiveUp)
+    {
+        pCase->mpFunc(aiWidth, aiHeight, aiBullets, &xClock);
+    }
+
+    double nNsPerOp = static_cast<double>(xClock.miNs) / xClock.miOps;
+
+    printf("result,%s,%u,%u,%u,%llu,%.1f,%.3f\n", pCase->mpName, aiWidth, aiHeight, aiBullets, xClock.miOps, nNsPerOp,
+           static_cast<double>(xClock.miAllocs) / xClock.miOps);
+    fflush(stdout);
+
+    return nNsPerOp;
+}
+
+// Slope of log(cost) against log(n), i.e. k in cost ~ n^k.
+static double FitExponent(const double *pN, const double *pCost, u32 aiCount)
+{
+    double nMeanX = 0;
+    double nMeanY = 0;
+
+    for (u32 iIdx = 0; iIdx < aiCount; ++iIdx)
+    {
+        nMeanX += log(pN[iIdx]) / aiCount;
+        nMeanY += log(pCost[iIdx]) / aiCount;
+    }
+
+    double nCov = 0;
+    double nVar = 0;
+
+    for (u32 iIdx = 0; iIdx < aiCount; ++iIdx)
+    {
+        double nDX = log(pN[iIdx]) - nMeanX;
+        nCov += nDX * (log(pCost[iIdx]) - nMeanY);
+        nVar += nDX * nDX;
+    }
+
+    return (0 == nVar) ? 0 : (nCov / nVar);
+}
+
+int main(int argc, char **argv)
+{
+    bool bQuick = false;
+    const char *pFilter = nullptr;
+    u64 iBudgetMs = 200;
+
+    for (int iIdx = 1; iIdx < argc; ++iIdx)
+    {
+        if (0 == strcmp(argv[iIdx], "--quick"))
+        {
+            bQuick = true;
+        }
+        else if (0 == strcmp(argv[iIdx], "--filter") && (iIdx + 1) < argc)
+        {
+            pFilter = argv[++iIdx];
+        }
+        else if (0 == strcmp(argv[iIdx], "--time-ms") && (iIdx + 1) < argc)
+        {
+            iBudgetMs = strtoull(argv[++iIdx], nullptr, 10);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--quick] [--filter NAME] [--time-ms N]\n", argv[0]);
+            return -3;
+        }
+    }
+
+    if (bQuick)
+    {
+        iBudgetMs = (iBudgetMs < 20) ? iBudgetMs : 20;
+    }
+
+    u64 iBudgetNs = iBudgetMs * 1000000ULL;
+    u32 iBoardSizes = bQuick ? (c_iNumBoardSizes - 1) : c_iNumBoardSizes;
+    u32 iRegressions = 0;
+
+    printf("# result,benchmark,width,height,bullets,ops,ns_per_op,allocs_per_op\n");
+    printf("# scaling,benchmark,exponent,max_exponent,status\n");
+
+    for (u32 iCase = 0; iCase < (sizeof(c_vCases) / sizeof(c_vCases[0])); ++iCase)
+    {
+        const BenchCase *pCase = &c_vCases[iCase];
+
+        if (nullptr != pFilter && nullptr == strstr(pCase->mpName, pFilter))
+        {
+            continue;
+        }
+
+        double vN[8];
+        double vCost[8];
+        u32 iPoints = 0;
+
+        if (pCase->mbBulletScaled)
+        {
+            for (u32 iIdx = 0; iIdx < c_iNumBulletCounts; ++iIdx, ++iPoints)
+            {
+                vN[iPoints] = c_iBulletCounts[iIdx];
+                vCost[iPoints] = RunCase(pCase, c_iBulletBoard[0], c_iBulletBoard[1], c_iBulletCounts[iIdx], iBudgetNs);
+            }
+        }
+        else
+        {
+            for (u32 iIdx = 0; iIdx < iBoardSizes; ++iIdx, ++iPoints)
+            {
+                vN[iPoints] = static_cast<double>(c_iBoardSizes[iIdx][0]) * c_iBoardSizes[iIdx][1];
+                vCost[iPoints] = RunCase(pCase, c_iBoardSizes[iIdx][0], c_iBoardSizes[iIdx][1], 0, iBudgetNs);
+            }
+        }
+
+        double nExponent = FitExponent(vN, vCost, iPoints);
+        bool bRegressed = nExponent > pCase->mnMaxExponent;
+        iRegressions += bRegressed ? 1 : 0;
+
+        printf("scaling,%s,%.2f,%.2f,%s\n", pCase->mpName, nExponent, pCase->mnMaxExponent, bRegressed ? "REGRESSION" : "ok");
+        fflush(stdout);
+    }
+
+    ShutdownGame();
+
+    return (0 == iRegressions) ? 0 : 1;
+}
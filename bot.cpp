@@ -0,0 +1,222 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ */
+#include <cstdlib>
+#include <algorithm>
+
+#include "bot.h"
+#include "scheduler.h"
+#include "profiler.h"
+
+// In the order they're tried, which is also the order ties are broken in. Firing comes first so that a shot isn't put
+// off for a later step that looks just as good from here.
+static const EInput c_vBotMoves[c_iBotMoves] = { EInput_Fire, EInput_None, EInput_Left, EInput_Right };
+
+// What lines of play are scored on.
+static const double c_nBotLifeValue = 1000.0;
+static const double c_nBotEndValue = 100000.0; //!< Winning, or losing, outweighs everything else.
+static const double c_nBotShotUnder = 400.0; //!< A shot coming down on the player, divided by how far off it is.
+static const double c_nBotShotBeside = 100.0; //!< A shot coming down just beside the player.
+static const double c_nBotShotAimed = 60.0; //!< A shot on its way up a column with an enemy in the bottom row.
+
+// Ranks the lines at the next depth, best first. Equal lines keep the order they were tried in.
+struct BotNodeOrder
+{
+    const std::vector<BotNode> *mpNodes;
+
+    bool operator()(u32 aiLeft, u32 aiRight) const
+    {
+        double nLeft = (*mpNodes)[aiLeft].mnValue;
+        double nRight = (*mpNodes)[aiRight].mnValue;
+
+        return (nLeft != nRight) ? (nLeft > nRight) : (aiLeft < aiRight);
+    }
+};
+
+static double Evaluate(const BotNode *pNode)
+{
+    const World *pWorld = &pNode->mxWorld;
+    const GameObject *pPlayer = &pNode->mxPlayer;
+    double nValue = pNode->mxScore.miValue + (c_nBotLifeValue * pWorld->miLives);
+
+    if (pWorld->mbGameOver)
+    {
+        nValue -= c_nBotEndValue;
+    }
+    else if (pWorld->mbWin)
+    {
+        nValue += c_nBotEndValue;
+    }
+
+    // Shots still above the player, in or next to its columns.
+    const BulletLane *pEnemy = &pWorld->mxBullets.mxEnemy;
+
+    for (u32 iIdx = 0; iIdx < pEnemy->Size(); ++iIdx)
+    {
+        int iDX = abs(pEnemy->mvX[iIdx] - pPlayer->miXPos);
+        int iDY = pPlayer->miYPos - pEnemy->mvY[iIdx];
+
+        if (2 >= iDX && 0 <= iDY)
+        {
+            nValue -= ((1 >= iDX) ? c_nBotShotUnder : c_nBotShotBeside) / (1 + iDY);
+        }
+    }
+
+    // The game is lost when the bottom row of the horde gets down to the barriers, so keep under the nearest enemy in
+    // that row to have the shots clear it.
+    const Horde *pHorde = &pWorld->mxHorde;
+
+    if (0 < pHorde->miAlive)
+    {
+        const u64 *pBottom = pHorde->RowMask(pHorde->miMaxRow);
+        int iNearest = pWorld->miBoardWidth;
+
+        for (u32 iCol = pHorde->miMinCol; iCol <= pHorde->miMaxCol; ++iCol)
+        {
+            int iDX = abs(pHorde->ColumnX(iCol) - pPlayer->miXPos);
+
+            if (0 != (pBottom[iCol / 64] & (1ULL << (iCol % 64))) && iDX < iNearest)
+            {
+                iNearest = iDX;
+            }
+        }
+
+        nValue -= iNearest;
+
+        // Shots fired up one of those columns are worth something before they hit.
+        const std::vector<int> &vShotX = pWorld->mxBullets.mxPlayer.mvX;
+
+        for (u32 iIdx = 0; iIdx < vShotX.size(); ++iIdx)
+        {
+            int iDX = vShotX[iIdx] - pHorde->miOriginX;
+            u32 iCol = iDX / c_iHordeXSpacing;
+
+            if (0 <= iDX && 0 == (iDX % c_iHordeXSpacing) && iCol < pHorde->miCols &&
+                0 != (pBottom[iCol / 64] & (1ULL << (iCol % 64))))
+            {
+                nValue += c_nBotShotAimed;
+            }
+        }
+    }
+
+    return nValue;
+}
+
+static EInput Search(Bot *pBot, const GameObject *pPlayer, const GameObject *pScore)
+{
+    u64 iStart = GetMonotonicNs();
+    World *pReal = g_pWorld;
+
+    // The futures being tried aren't part of any frame.
+    bool bProfiling = g_xProfiler.mbEnabled;
+    g_xProfiler.mbEnabled = false;
+
+    std::vector<BotNode> *pCur = &pBot->mvNodes[0];
+    std::vector<BotNode> *pNext = &pBot->mvNodes[1];
+
+    BotNode *pRoot = &(*pCur)[0];
+    CloneWorld(&pRoot->mxWorld, pReal);
+    pRoot->mxPlayer = *pPlayer;
+    pRoot->mxScore = *pScore;
+    pRoot->meFirst = EInput_None;
+    ++pBot->miClones;
+
+    pBot->mvBeam.assign(1, 0);
+
+    for (u32 iDepth = 0; iDepth < pBot->mxParams.miDepth; ++iDepth)
+    {
+        u32 iCount = 0;
+
+        for (u32 iBeam = 0; iBeam < pBot->mvBeam.size(); ++iBeam)
+        {
+            const BotNode *pFrom = &(*pCur)[pBot->mvBeam[iBeam]];
+
+            for (u32 iMove = 0; iMove < c_iBotMoves; ++iMove)
+            {
+                BotNode *pTo = &(*pNext)[iCount++];
+                CloneWorld(&pTo->mxWorld, &pFrom->mxWorld);
+                pTo->mxPlayer = pFrom->mxPlayer;
+                pTo->mxScore = pFrom->mxScore;
+                pTo->meFirst = (0 == iDepth) ? c_vBotMoves[iMove] : pFrom->meFirst;
+                ++pBot->miClones;
+
+                // Inputs land before the step they're played on, as they do in the real game.
+                g_pWorld = &pTo->mxWorld;
+
+                for (u32 iTick = 0; iTick < pBot->mxParams.miHoldTicks; ++iTick)
+                {
+                    ApplyInput(c_vBotMoves[iMove], &pTo->mxPlayer, &pTo->mxScore);
+                    StepGame(&pTo->mxPlayer, &pTo->mxScore);
+                }
+
+                pBot->miSteps += pBot->mxParams.miHoldTicks;
+                pTo->mnValue = Evaluate(pTo);
+            }
+        }
+
+        // Keep the best of them.
+        BotNodeOrder xOrder;
+        xOrder.mpNodes = pNext;
+
+        pBot->mvOrder.resize(iCount);
+        for (u32 iIdx = 0; iIdx < iCount; ++iIdx)
+        {
+            pBot->mvOrder[iIdx] = iIdx;
+        }
+
+        u32 iKeep = std::min(pBot->mxParams.miBeamWidth, iCount);
+        std::partial_sort(pBot->mvOrder.begin(), pBot->mvOrder.begin() + iKeep, pBot->mvOrder.end(), xOrder);
+        pBot->mvBeam.assign(pBot->mvOrder.begin(), pBot->mvOrder.begin() + iKeep);
+
+        std::swap(pCur, pNext);
+    }
+
+    g_pWorld = pReal;
+    g_xProfiler.mbEnabled = bProfiling;
+
+    ++pBot->miSearches;
+    pBot->miSearchNs += GetMonotonicNs() - iStart;
+
+    return (0 == pBot->mxParams.miDepth) ? EInput_None : (*pCur)[pBot->mvBeam[0]].meFirst;
+}
+
+void BotInit(Bot *pBot, const BotParams &rParams)
+{
+    pBot->mxParams = rParams;
+    pBot->mxParams.miBeamWidth = std::max(1U, rParams.miBeamWidth);
+    pBot->mxParams.miHoldTicks = std::max(1U, rParams.miHoldTicks);
+
+    // Every line in the beam is tried with every input.
+    pBot->mvNodes[0].resize(pBot->mxParams.miBeamWidth * c_iBotMoves);
+    pBot->mvNodes[1].resize(pBot->mxParams.miBeamWidth * c_iBotMoves);
+    pBot->mvBeam.reserve(pBot->mxParams.miBeamWidth);
+    pBot->mvOrder.reserve(pBot->mxParams.miBeamWidth * c_iBotMoves);
+
+    pBot->meHeld = EInput_None;
+    pBot->miHeldFor = 0;
+}
+
+EInput BotChoose(Bot *pBot, const GameObject *pPlayer, const GameObject *pScore)
+{
+    // Keep playing what the last search picked until it's time for another.
+    if (0 < pBot->miHeldFor && pBot->miHeldFor < pBot->mxParams.miHoldTicks)
+    {
+        ++pBot->miHeldFor;
+        return pBot->meHeld;
+    }
+
+    pBot->meHeld = Search(pBot, pPlayer, pScore);
+    pBot->miHeldFor = 1;
+
+    return pBot->meHeld;
+}
+
+void BotReport(const Bot *pBot, FILE *pOut)
+{
+    fprintf(pOut, "Bot: beam %u x depth %u x %u ticks    Searches: %llu    Clones: %llu    Simulated ticks: %llu"
+            "    Mean search: %.1fus\n", pBot->mxParams.miBeamWidth, pBot->mxParams.miDepth, pBot->mxParams.miHoldTicks,
+            pBot->miSearches, pBot->miClones, pBot->miSteps,
+            (0 == pBot->miSearches) ? 0.0 : (pBot->miSearchNs / 1000.0 / pBot->miSearches));
+}
@@ -0,0 +1,69 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    Autoplayer. Every few ticks the bot clones the world it's playing and runs a beam search over what could happen
+ *    next: each line of play in the beam is tried with every input held for a few ticks, the results are scored, and
+ *    only the best few are taken on to the next depth. The input that started the best line is played until the next
+ *    search. The simulation's random streams live in the world, so the futures it looks at are the real ones.
+ *
+ *    Lines of play are scored on points, lives and winning, on staying out from under enemy shots about to land and on
+ *    keeping lined up with the horde's bottom row, which is what ends the game when it reaches the barriers. It rarely
+ *    loses a life and outlasts random play by half again, which is enough for a load generator and for soak testing.
+ *
+ *    Every world the search steps is a node it owns, cloned into again and again (see CloneWorld()), so after the
+ *    first search a bot doesn't allocate.
+ */
+#ifndef SHELL_INVADERS_BOT_H
+#define SHELL_INVADERS_BOT_H
+
+#include <cstdio>
+#include <vector>
+
+#include "game.h"
+
+// Inputs tried at every step of the search.
+const u32 c_iBotMoves = 4;
+
+struct BotParams
+{
+    u32 miBeamWidth; //!< Lines of play kept at each depth.
+    u32 miDepth; //!< Steps of the search, each one holding an input for miHoldTicks.
+    u32 miHoldTicks; //!< Ticks an input is held for, the bot searches again this often.
+
+    BotParams() : miBeamWidth(4), miDepth(4), miHoldTicks(3) {}
+};
+
+// One line of play in the search.
+struct BotNode
+{
+    World mxWorld;
+    GameObject mxPlayer;
+    GameObject mxScore;
+    EInput meFirst; //!< The input the line started with.
+    double mnValue; //!< How good the line looks where it got to.
+};
+
+struct Bot
+{
+    BotParams mxParams;
+    std::vector<BotNode> mvNodes[2]; //!< Lines at the current depth and the next, the two swap every depth.
+    std::vector<u32> mvBeam; //!< Lines kept at the current depth, indices into the current nodes.
+    std::vector<u32> mvOrder; //!< Scratch for ranking the next depth.
+    EInput meHeld; //!< Input being played until the next search.
+    u32 miHeldFor; //!< Ticks it has been played for.
+    u64 miSearches;
+    u64 miClones;
+    u64 miSteps; //!< Ticks simulated while searching.
+    u64 miSearchNs; //!< Time spent searching.
+
+    Bot() : meHeld(EInput_None), miHeldFor(0), miSearches(0), miClones(0), miSteps(0), miSearchNs(0) {}
+};
+
+void BotInit(Bot *pBot, const BotParams &rParams); //!< Sets the search up, the nodes' worlds grow on the first search.
+EInput BotChoose(Bot *pBot, const GameObject *pPlayer, const GameObject *pScore); //!< The input for this tick.
+void BotReport(const Bot *pBot, FILE *pOut);
+
+#endif // SHELL_INVADERS_BOT_H
@@ -0,0 +1,248 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ */
+#include <cstdarg>
+#include <cstring>
+#include <algorithm>
+
+#include "framebuffer.h"
+#include "profiler.h"
+
+void FrameBuffer::Resize(u32 aiWidth, u32 aiHeight)
+{
+    miWidth = aiWidth;
+    miHeight = aiHeight;
+    mvCells.resize(aiWidth * aiHeight);
+    Clear();
+}
+
+void FrameBuffer::Clear()
+{
+    Cell xBlank = { ' ', EColor_Default };
+    mvCells.assign(mvCells.size(), xBlank);
+}
+
+void FrameBuffer::Put(int aiX, int aiY, byte aiColor, char acGlyph)
+{
+    if (0 > aiX || 0 > aiY || static_cast<u32>(aiX) >= miWidth || static_cast<u32>(aiY) >= miHeight)
+    {
+        return;
+    }
+
+    Cell *pCell = &mvCells[(aiY * miWidth) + aiX];
+    pCell->mcGlyph = acGlyph;
+    pCell->miColor = aiColor;
+}
+
+void FrameBuffer::Print(int aiX, int aiY, byte aiColor, const char *pFmt, ...)
+{
+    char sLine[256];
+
+    va_list vArgs;
+    va_start(vArgs, pFmt);
+    vsnprintf(sLine, sizeof(sLine), pFmt, vArgs);
+    va_end(vArgs);
+
+    for (const char *pChar = sLine; '\0' != *pChar; ++pChar)
+    {
+        if ('\t' == *pChar)
+        {
+            // Tabs stop every 8 columns, same as a terminal.
+            int iStop = (aiX + 8) & ~7;
+
+            for (; aiX < iStop; ++aiX)
+            {
+                Put(aiX, aiY, aiColor, ' ');
+            }
+        }
+        else
+        {
+            Put(aiX++, aiY, aiColor, *pChar);
+        }
+    }
+}
+
+void FrameBuffer::PutSprite(int aiX, int aiY, ESprite aeSprite, byte aiColor)
+{
+    const Sprite &rSprite = SpriteOf(aeSprite);
+    int iLeft = aiX - rSprite.miCenter;
+
+    for (u32 iIdx = 0; iIdx < rSprite.miWidth; ++iIdx)
+    {
+        Put(iLeft + iIdx, aiY, aiColor, rSprite.msGlyphs[iIdx]);
+    }
+}
+
+static void ComposeBanner(FrameBuffer *pFrame, const char *pStr, byte aiColor)
+{
+    u32 iMidX = g_pWorld->mxView.miWidth / 2;
+    u32 iMidY = g_pWorld->mxView.miHeight / 2;
+    u32 iMidStr = strlen(pStr) / 2;
+
+    pFrame->Print(iMidX - iMidStr, iMidY, aiColor, pStr);
+}
+
+static void ComposeIntro(FrameBuffer *pFrame)
+{
+    // Determine the middle of the screen.
+    u32 iXMid = g_pWorld->mxView.miWidth / 2;
+    u32 iYMid = g_pWorld->mxView.miHeight / 2;
+    u32 iStrMid = strlen("Welcome to Shell Invaders!") / 2;
+
+    pFrame->Print((iXMid - iStrMid), (iYMid - 4), EColor_White, "Welcome to Shell Invaders!");
+    pFrame->Print((iXMid - iStrMid), (iYMid - 2), EColor_White, "Controls:");
+    pFrame->Print((iXMid - iStrMid), (iYMid - 1), EColor_White, "\tA/Left\t-\tMove Left");
+    pFrame->Print((iXMid - iStrMid), iYMid, EColor_White, "\tD/Right\t-\tMove right");
+    pFrame->Print((iXMid - iStrMid), (iYMid + 1), EColor_White, "\tW/Space\t-\tShoot");
+    pFrame->Print((iXMid - iStrMid), (iYMid + 2), EColor_White, "\tESC\t-\tQuit/Return to Menu");
+    pFrame->Print((iXMid - iStrMid), (iYMid + 4), EColor_White, "Press ENTER to begin!");
+}
+
+EError ComposeFrame(FrameBuffer *pFrame, const GameObject *pPlayer, const GameObject *pScore)
+{
+    if (nullptr == pFrame || nullptr == pPlayer || nullptr == pScore)
+    {
+        return EError_InvalidArg;
+    }
+
+    pFrame->Clear();
+
+    if (g_pWorld->mbIsIntro)
+    {
+        ComposeIntro(pFrame);
+        return EError_OK;
+    }
+
+    if (g_pWorld->mbGameOver)
+    {
+        ComposeBanner(pFrame, "Game Over!", EColor_Yellow);
+    }
+    else if (g_pWorld->mbWin)
+    {
+        ComposeBanner(pFrame, "You Win!", EColor_Green);
+    }
+    else
+    {
+        // Everything is drawn relative to the view, and anything off it is skipped.
+        const Viewport *pView = &g_pWorld->mxView;
+        int iOffX = pView->miX;
+        int iOffY = pView->miY;
+
+        // The UFO.
+        if (g_pWorld->mxUFO.mbActive && 0 < g_pWorld->mxUFO.miXPos)
+        {
+            pFrame->PutSprite(g_pWorld->mxUFO.miXPos - iOffX, g_pWorld->mxUFO.miYPos - iOffY, ESprite_UFO);
+        }
+
+        // The bullets, kept off the score line.
+        u64 iStart = ProfileBegin();
+        const BulletLane *pPlayerLane = &g_pWorld->mxBullets.mxPlayer;
+        const BulletLane *pEnemyLane = &g_pWorld->mxBullets.mxEnemy;
+
+        for (u32 iIdx = 0; iIdx < pPlayerLane->Size(); ++iIdx)
+        {
+            int iX = pPlayerLane->mvX[iIdx];
+            int iY = pPlayerLane->mvY[iIdx];
+
+            if (pView->Shows(iX, iY))
+            {
+                pFrame->PutSprite(iX - iOffX, iY - iOffY, ESprite_PlayerShot);
+            }
+        }
+
+        for (u32 iIdx = 0; iIdx < pEnemyLane->Size(); ++iIdx)
+        {
+            int iX = pEnemyLane->mvX[iIdx];
+            int iY = pEnemyLane->mvY[iIdx];
+
+            if (pView->Shows(iX, iY))
+            {
+                pFrame->PutSprite(iX - iOffX, iY - iOffY, ESprite_EnemyShot);
+            }
+        }
+
+        ProfileEnd(EPhase_DrawBullets, iStart);
+
+        // The barriers that are still standing.
+        iStart = ProfileBegin();
+
+        if (pView->Shows(iOffX, g_pWorld->miBarrierY))
+        {
+            const BarrierTable *pBarriers = &g_pWorld->mxBarriers;
+
+            for (u32 iIdx = 0; iIdx < pBarriers->Size(); ++iIdx)
+            {
+                u32 iHealth = pBarriers->mvHealth[iIdx];
+
+                if (0 == iHealth || pBarriers->Right(iIdx) < iOffX ||
+                    pBarriers->mvLeft[iIdx] >= (iOffX + static_cast<int>(pView->miWidth)))
+                {
+                    continue;
+                }
+
+                // The health shows in the middle.
+                int iCenter = pBarriers->mvLeft[iIdx] + SpriteOf(ESprite_Barrier).miCenter - iOffX;
+                int iY = g_pWorld->miBarrierY - iOffY;
+                byte iClr = BarrierColor(iHealth);
+
+                pFrame->PutSprite(iCenter, iY, ESprite_Barrier, iClr);
+                pFrame->Put(iCenter, iY, iClr, '0' + iHealth);
+            }
+        }
+
+        ProfileEnd(EPhase_DrawBarriers, iStart);
+
+        // The horde, only the rows and words of the formation that are on screen.
+        iStart = ProfileBegin();
+        const Horde *pHorde = &g_pWorld->mxHorde;
+        int iTopRow = (iOffY - pHorde->miOriginY + c_iHordeYSpacing - 1) / c_iHordeYSpacing;
+        int iEndRow = (iOffY + pView->HudRow() - pHorde->miOriginY + c_iHordeYSpacing - 1) / c_iHordeYSpacing;
+        int iFirstWord = ((iOffX - pHorde->miOriginX) / c_iHordeXSpacing) / 64;
+        int iEndWord = ((iOffX + static_cast<int>(pView->miWidth) - pHorde->miOriginX) / c_iHordeXSpacing) / 64 + 1;
+
+        iTopRow = std::max(0, iTopRow);
+        iEndRow = std::min(static_cast<int>(pHorde->miRows), iEndRow);
+        iFirstWord = std::max(0, iFirstWord);
+        iEndWord = std::min(static_cast<int>(pHorde->miWords), iEndWord);
+
+        for (int iRow = iTopRow; iRow < iEndRow; ++iRow)
+        {
+            const u64 *pMask = pHorde->RowMask(iRow);
+            int iY = pHorde->RowY(iRow) - iOffY;
+            const Sprite &rSprite = SpriteOf(static_cast<ESprite>(pHorde->mvRowSprite[iRow]));
+
+            for (int iWord = iFirstWord; iWord < iEndWord; ++iWord)
+            {
+                for (u64 iBits = pMask[iWord]; 0 != iBits; iBits &= (iBits - 1))
+                {
+                    int iX = pHorde->ColumnX((iWord * 64) + __builtin_ctzll(iBits)) - iOffX;
+                    pFrame->Put(iX, iY, rSprite.meColor, rSprite.msGlyphs[0]);
+                }
+            }
+        }
+
+        ProfileEnd(EPhase_DrawHorde, iStart);
+
+        // The character.
+        pFrame->PutSprite(pPlayer->miXPos - iOffX, pPlayer->miYPos - iOffY, ESprite_Player);
+    }
+
+    // Lastly, the score.
+    u64 iStart = ProfileBegin();
+    pFrame->Print(GetScoreXPosition(g_pWorld->mxView.miWidth, pScore->msCharStr), g_pWorld->mxView.HudRow(),
+                  EColor_White, pScore->msCharStr, pScore->miValue, g_iHiScore, g_pWorld->miLives);
+    ProfileEnd(EPhase_DrawHud, iStart);
+
+    return EError_OK;
+}
+
+void ReportOutputStats(const char *pName, const OutputStats *pStats, FILE *pOut)
+{
+    u64 iFrames = (0 == pStats->miFrames) ? 1 : pStats->miFrames;
+
+    fprintf(pOut, "Renderer: %s    Frames: %llu    Bytes/frame: %.1f    Max bytes/frame: %llu    write()/frame: %.2f\n",
+            pName, pStats->miFrames, static_cast<double>(pStats->miBytes) / iFrames, pStats->miMaxFrameBytes,
+            static_cast<double>(pStats->miWrites) / iFrames);
+}
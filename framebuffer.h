@@ -0,0 +1,59 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    A plain grid of character cells, and the code that lays a frame of the game out into one. Anything that wants
+ *    the screen as data rather than as terminal output (the ANSI renderer, for one) goes through here.
+ */
+#ifndef SHELL_INVADERS_FRAMEBUFFER_H
+#define SHELL_INVADERS_FRAMEBUFFER_H
+
+#include <cstdio>
+#include <vector>
+
+#include "game.h"
+
+struct Cell
+{
+    char mcGlyph; //!< Character shown in the cell.
+    byte miColor; //!< One of EColor.
+
+    bool operator==(const Cell &rOther) const { return mcGlyph == rOther.mcGlyph && miColor == rOther.miColor; }
+    bool operator!=(const Cell &rOther) const { return !(*this == rOther); }
+};
+
+struct FrameBuffer
+{
+    u32 miWidth; //!< Columns in the buffer.
+    u32 miHeight; //!< Rows in the buffer.
+    std::vector<Cell> mvCells; //!< Row major cells.
+
+    FrameBuffer() : miWidth(0), miHeight(0) {}
+
+    void Resize(u32 aiWidth, u32 aiHeight);
+    void Clear();
+    void Put(int aiX, int aiY, byte aiColor, char acGlyph);
+    void Print(int aiX, int aiY, byte aiColor, const char *pFmt, ...);
+    void PutSprite(int aiX, int aiY, ESprite aeSprite, byte aiColor); //!< Draws a sprite centered on a position.
+    void PutSprite(int aiX, int aiY, ESprite aeSprite) { PutSprite(aiX, aiY, aeSprite, SpriteOf(aeSprite).meColor); }
+
+    const Cell& At(u32 aiX, u32 aiY) const { return mvCells[(aiY * miWidth) + aiX]; }
+};
+
+// How much a renderer pushed out to the terminal.
+struct OutputStats
+{
+    u64 miFrames; //!< Frames presented.
+    u64 miBytes; //!< Bytes written to the terminal.
+    u64 miWrites; //!< write() calls made.
+    u64 miMaxFrameBytes; //!< Most bytes written for a single frame.
+
+    OutputStats() : miFrames(0), miBytes(0), miWrites(0), miMaxFrameBytes(0) {}
+};
+
+EError ComposeFrame(FrameBuffer *pFrame, const GameObject *pPlayer, const GameObject *pScore); //!< Lays the view out into a frame.
+void ReportOutputStats(const char *pName, const OutputStats *pStats, FILE *pOut);
+
+#endif // SHELL_INVADERS_FRAMEBUFFER_H
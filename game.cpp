@@ -0,0 +1,958 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    The simulation half of the game. Every function in here only updates the game state, drawing it is left to
+ *    whichever front-end is running.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "game.h"
+#include "profiler.h"
+
+// Global objects.
+static World s_xMainWorld; //!< The world used by a thread that never picked one.
+thread_local World *g_pWorld = &s_xMainWorld;
+u32 g_iHiScore = 0;
+
+// Local helpers.
+static void UpdateUFO();
+static void ClearHorde();
+static void BuildHorde(int aiOriginX, int aiOriginY, u32 aiCols, u32 aiRows, u32 aiMaxEnemies);
+static void KillEnemy(u32 aiRow, u32 aiCol);
+static void MarkHordeDirty();
+static void PlaceOnGrid(int aiX, int aiY, u32 aiWidth, EEntity aeKind);
+static void LiftFromGrid(int aiX, int aiY, u32 aiWidth);
+
+// Widths of the things the grid tracks.
+const u32 c_iPlayerWidth = SpriteOf(ESprite_Player).miWidth;
+const u32 c_iUFOWidth = SpriteOf(ESprite_UFO).miWidth;
+
+EError InitGame(u32 aiWidth, u32 aiHeight, GameObject *pPlyr, GameObject *pScore)
+{
+    if (c_iMinBoardWidth > aiWidth || c_iMinBoardHeight > aiHeight || c_iMaxBoardWidth < aiWidth ||
+        c_iMaxBoardHeight < aiHeight || nullptr == pPlyr || nullptr == pScore)
+    {
+        return EError_InvalidArg;
+    }
+
+    g_pWorld->miBoardWidth = aiWidth;
+    g_pWorld->miBoardHeight = aiHeight;
+    g_pWorld->mxGrid.Resize(aiWidth, aiHeight);
+    g_pWorld->mxDirty.Resize(aiWidth, aiHeight);
+    SetViewport(aiWidth, aiHeight);
+
+    pPlyr->miXPos = (g_pWorld->miBoardWidth / 2) - 1;
+    pPlyr->miYPos = (g_pWorld->miBoardHeight * 7) / 8;
+
+    pScore->miXPos = GetScoreXPosition(g_pWorld->miBoardWidth, "Score: %ld    Hi-Score: %ld    Lives: %d");
+    pScore->miYPos = g_pWorld->miBoardHeight - 1;
+    pScore->msCharStr = "Score: %ld    Hi-Score: %ld    Lives: %d";
+
+    // Lastly, the UFO.
+    g_pWorld->mxUFO.miXPos = g_pWorld->miBoardWidth - 2;
+    g_pWorld->mxUFO.miYPos = 1;
+
+    // Reserve all the room the bullets will ever get now, so the game never allocates for a shot.
+    g_pWorld->mxBullets.mxPlayer.Reserve(c_iBulletLaneCapacity);
+    g_pWorld->mxBullets.mxEnemy.Reserve(c_iBulletLaneCapacity);
+
+    g_pWorld->mbRunning = true;
+    g_pWorld->mbIsIntro = true;
+    g_pWorld->mbGameOver = false;
+    g_pWorld->mbWin = false;
+
+    return EError_OK;
+}
+
+void SeedGame(u64 aiSeed)
+{
+    g_pWorld->mxUFORng.Seed(aiSeed, ERngStream_UFO);
+    g_pWorld->mxFireRng.Seed(aiSeed, ERngStream_EnemyFire);
+    g_pWorld->miFireSkip = g_pWorld->mxFireRng.Geometric(g_pWorld->mxParams.miEnemyFireOdds);
+}
+
+// Everything in a world is a value, so a copy is a snapshot that steps exactly like the original would. Copying into a
+// world that has been cloned into before reuses its storage, and the lanes get their full room on the first clone, so
+// neither cloning nor stepping the clone allocates after that. Clones never record dirty cells, nobody draws them.
+void CloneWorld(World *pDst, const World *pSrc)
+{
+    *pDst = *pSrc;
+    pDst->mxDirty.mbEnabled = false;
+
+    pDst->mxBullets.mxPlayer.Reserve(pDst->mxBullets.mxPlayer.miCapacity);
+    pDst->mxBullets.mxEnemy.Reserve(pDst->mxBullets.mxEnemy.miCapacity);
+}
+
+void SetViewport(u32 aiWidth, u32 aiHeight)
+{
+    Viewport *pView = &g_pWorld->mxView;
+
+    pView->miX = 0;
+    pView->miY = 0;
+    pView->miWidth = std::min(aiWidth, static_cast<u32>(g_pWorld->miBoardWidth));
+    pView->miHeight = std::min(aiHeight, static_cast<u32>(g_pWorld->miBoardHeight));
+    g_pWorld->mxDirty.mbFullRedraw = true;
+}
+
+bool FollowPlayer(const GameObject *pPlayer)
+{
+    Viewport *pView = &g_pWorld->mxView;
+    int iWidth = pView->miWidth;
+
+    // The player can wander the middle half of the screen before it scrolls.
+    int iMargin = iWidth / 4;
+    int iX = pView->miX;
+
+    if (pPlayer->miXPos < (iX + iMargin))
+    {
+        iX = pPlayer->miXPos - iMargin;
+    }
+    else if (pPlayer->miXPos > (iX + iWidth - 1 - iMargin))
+    {
+        iX = pPlayer->miXPos - (iWidth - 1 - iMargin);
+    }
+
+    // The player sits as far down the screen as it would on a board the screen's size, with the horde above it.
+    int iY = pPlayer->miYPos - ((pView->miHeight * 7) / 8);
+
+    iX = std::max(0, std::min(iX, g_pWorld->miBoardWidth - iWidth));
+    iY = std::max(0, std::min(iY, g_pWorld->miBoardHeight - static_cast<int>(pView->miHeight)));
+
+    if (iX == pView->miX && iY == pView->miY)
+    {
+        return false;
+    }
+
+    // Everything on screen moved.
+    pView->miX = iX;
+    pView->miY = iY;
+    g_pWorld->mxDirty.mbFullRedraw = true;
+
+    return true;
+}
+
+void ShutdownGame()
+{
+    g_pWorld->mxBullets.mxPlayer.Clear();
+    g_pWorld->mxBullets.mxEnemy.Clear();
+    g_pWorld->mxBarriers.Clear();
+    g_pWorld->mvBarrierColumns.clear();
+    ClearHorde();
+}
+
+EError NewGame(GameObject *pPlyr, GameObject *pScore)
+{
+    // Put everything back the way it was at the start.
+    pPlyr->miXPos = (g_pWorld->miBoardWidth / 2) - 1;
+    pPlyr->miYPos = (g_pWorld->miBoardHeight * 7) / 8;
+    pScore->miValue = 0;
+
+    g_pWorld->mxGrid.Clear();
+    PlaceOnGrid(pPlyr->miXPos, pPlyr->miYPos, c_iPlayerWidth, EEntity_Player);
+    g_pWorld->mxDirty.mbFullRedraw = true;
+
+    g_pWorld->mxUFO.miXPos = g_pWorld->miBoardWidth - 2;
+    g_pWorld->mxUFO.miYPos = 1;
+    g_pWorld->mxUFO.mbActive = false;
+    g_pWorld->mxUFO.miMoveWait = 0;
+
+    g_pWorld->mbHordeMoveRight = false;
+    g_pWorld->mbGameOver = false;
+    g_pWorld->mbWin = false;
+    g_pWorld->mbMoveDown = false;
+    g_pWorld->miLives = g_pWorld->mxParams.miLives;
+    g_pWorld->miHordeReset = g_pWorld->mxParams.miHordeReset;
+
+    g_pWorld->mxBullets.mxPlayer.Clear();
+    g_pWorld->mxBullets.mxEnemy.Clear();
+
+    // The horde moves on the first tick.
+    g_pWorld->mxTimers.Clear();
+    g_pWorld->mxTimers.Arm(ETimer_HordeStep, 0);
+
+    return CreateBoard(pPlyr);
+}
+
+EError StepGame(GameObject *pPlayer, GameObject *pScore)
+{
+    if (nullptr == pPlayer || nullptr == pScore)
+    {
+        return EError_InvalidArg;
+    }
+
+    // The UFO has a 1 in miUFOSpawnOdds chance of turning up every tick it isn't already out.
+    Ufo *pUFO = &g_pWorld->mxUFO;
+
+    if (!pUFO->mbActive && 0 == g_pWorld->mxUFORng.Below(g_pWorld->mxParams.miUFOSpawnOdds))
+    {
+        // Spawn the UFO!
+        pUFO->mbActive = true;
+        ++pUFO->miGeneration;
+        PlaceOnGrid(pUFO->miXPos, pUFO->miYPos, c_iUFOWidth, EEntity_UFO);
+        g_pWorld->mxTimers.Arm(ETimer_UFOStep, pUFO->miMoveWait);
+    }
+
+    // Nothing moves while on the intro.
+    if (g_pWorld->mbIsIntro)
+    {
+        return EError_OK;
+    }
+
+    u64 iStepStart = ProfileBegin();
+
+    // Whatever is timed and due this tick, handled in a fixed order. The bullets move every tick. The fire cooldown
+    // running out needs nothing doing, it only has to be disarmed.
+    u32 iDue = g_pWorld->mxTimers.Advance();
+    u64 iStart = ProfileBegin();
+
+    if (0 != (iDue & (1U << ETimer_UFOStep)))
+    {
+        UpdateUFO();
+    }
+
+    ProfileEnd(EPhase_UFO, iStart);
+
+    iStart = ProfileBegin();
+    UpdateBullets(pPlayer, pScore);
+    ProfileEnd(EPhase_Bullets, iStart);
+
+    // A horde that's won or lost stops where it is, until the next game arms it again.
+    if (0 != (iDue & (1U << ETimer_HordeStep)) && !g_pWorld->mbGameOver && !g_pWorld->mbWin)
+    {
+        iStart = ProfileBegin();
+        MoveHorde();
+        ProfileEnd(EPhase_Horde, iStart);
+    }
+
+    ProfileEnd(EPhase_Step, iStepStart);
+
+    return EError_OK;
+}
+
+EError ApplyInput(EInput aeInput, GameObject *pPlayer, GameObject *pScore)
+{
+    switch (aeInput)
+    {
+        case EInput_Fire:
+        {
+            if (!g_pWorld->mbIsIntro && !g_pWorld->mbGameOver && !g_pWorld->mbWin)
+            {
+                if (!g_pWorld->mxTimers.Armed(ETimer_FireCooldown))
+                {
+                    // Place a new bullet in the player's lane so it can be drawn.
+                    EntityHandle hShot = g_pWorld->mxBullets.mxPlayer.Spawn(pPlayer->miXPos, pPlayer->miYPos - 1);
+
+                    if (EEntity_None != HandleKind(hShot))
+                    {
+                        g_pWorld->mxDirty.Mark(pPlayer->miXPos, pPlayer->miYPos - 1, 1);
+                    }
+
+                    // The cooldown is up after miFireCooldown ticks, the tick it runs out on included.
+                    if (0 < g_pWorld->mxParams.miFireCooldown)
+                    {
+                        g_pWorld->mxTimers.Arm(ETimer_FireCooldown, g_pWorld->mxParams.miFireCooldown - 1);
+                    }
+                }
+            }
+            break;
+        }
+        case EInput_Left:
+        {
+            if (!g_pWorld->mbIsIntro && !g_pWorld->mbGameOver && !g_pWorld->mbWin)
+            {
+                // Check to make sure we're not at the borders.
+                if (0 < (pPlayer->miXPos - 1))
+                {
+                    // We're not, move the character left.
+                    LiftFromGrid(pPlayer->miXPos, pPlayer->miYPos, c_iPlayerWidth);
+                    --pPlayer->miXPos;
+                    PlaceOnGrid(pPlayer->miXPos, pPlayer->miYPos, c_iPlayerWidth, EEntity_Player);
+                }
+            }
+            break;
+        }
+        case EInput_Right:
+        {
+            if (!g_pWorld->mbIsIntro && !g_pWorld->mbGameOver && !g_pWorld->mbWin)
+            {
+                // Check to make sure we're not at the borders.
+                if (g_pWorld->miBoardWidth > (pPlayer->miXPos + 1))
+                {
+                    // We're not, move the character right.
+                    LiftFromGrid(pPlayer->miXPos, pPlayer->miYPos, c_iPlayerWidth);
+                    ++pPlayer->miXPos;
+                    PlaceOnGrid(pPlayer->miXPos, pPlayer->miYPos, c_iPlayerWidth, EEntity_Player);
+                }
+            }
+            break;
+        }
+        case EInput_Back:
+        {
+            if (g_pWorld->mbIsIntro)
+            {
+                // Exit out.
+                g_pWorld->mbRunning = false;
+            }
+            else
+            {
+                g_pWorld->mbIsIntro = true;
+            }
+            break;
+        }
+        case EInput_Quit:
+        {
+            // Exit out.
+            g_pWorld->mbRunning = false;
+            break;
+        }
+        case EInput_Start:
+        {
+            if (g_pWorld->mbIsIntro)
+            {
+                g_pWorld->mbIsIntro = false;
+
+                // Clear the horde and remake it.
+                return NewGame(pPlayer, pScore);
+            }
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    return EError_OK;
+}
+
+EInput CharToInput(int acChar)
+{
+    switch (acChar)
+    {
+        case 'w':
+        case ' ':
+            return EInput_Fire;
+        case 'a':
+            return EInput_Left;
+        case 'd':
+            return EInput_Right;
+        case 27: // ESC
+            return EInput_Back;
+        case 3: // CTRL+C
+            return EInput_Quit;
+        case 13: // ENTER
+            return EInput_Start;
+        case 'p':
+            return EInput_Overlay;
+        case 'r':
+            return EInput_Rewind;
+        default:
+            return EInput_None;
+    }
+}
+
+EError MoveHorde()
+{
+    if (!g_pWorld->mbMoveDown)
+    {
+        if (0 < g_pWorld->mxHorde.miAlive)
+        {
+            // Only the outer-most columns can touch the sides.
+            if (g_pWorld->mxHorde.ColumnX(g_pWorld->mxHorde.miMaxCol) >= (g_pWorld->miBoardWidth - 1))
+            {
+                // Move down instead.
+                g_pWorld->mbMoveDown = true;
+                g_pWorld->mbHordeMoveRight = false;
+            }
+            else if (0 >= g_pWorld->mxHorde.ColumnX(g_pWorld->mxHorde.miMinCol))
+            {
+                g_pWorld->mbMoveDown = true;
+                g_pWorld->mbHordeMoveRight = true;
+            }
+        }
+
+        // Are we gonna fire a bullet? Every enemy still alive gets a roll, but rather than rolling for each of them
+        // we jump straight to the next roll that succeeds. The count carries over between moves.
+        u32 iSkip = g_pWorld->miFireSkip;
+
+        for (u32 iRow = 0; iRow < g_pWorld->mxHorde.miRows; ++iRow)
+        {
+            if (iSkip >= g_pWorld->mxHorde.mvRowAlive[iRow])
+            {
+                iSkip -= g_pWorld->mxHorde.mvRowAlive[iRow];
+                continue;
+            }
+
+            const u64 *pMask = g_pWorld->mxHorde.RowMask(iRow);
+
+            for (u32 iWord = 0; iWord < g_pWorld->mxHorde.miWords; ++iWord)
+            {
+                u64 iBits = pMask[iWord];
+                u32 iCount = __builtin_popcountll(iBits);
+
+                while (iSkip < iCount)
+                {
+                    // Drop the enemies that missed their roll, the lowest one left fires.
+                    for (u32 iIdx = 0; iIdx < iSkip; ++iIdx)
+                    {
+                        iBits &= (iBits - 1);
+                    }
+
+                    u32 iCol = (iWord * 64) + __builtin_ctzll(iBits);
+                    iBits &= (iBits - 1);
+                    iCount -= iSkip + 1;
+                    iSkip = g_pWorld->mxFireRng.Geometric(g_pWorld->mxParams.miEnemyFireOdds);
+
+                    // Place a new bullet in the enemy lane so it can be drawn.
+                    int iShotX = g_pWorld->mxHorde.ColumnX(iCol);
+                    int iShotY = g_pWorld->mxHorde.RowY(iRow) + 1;
+
+                    if (EEntity_None != HandleKind(g_pWorld->mxBullets.mxEnemy.Spawn(iShotX, iShotY)))
+                    {
+                        g_pWorld->mxDirty.Mark(iShotX, iShotY, 1);
+                    }
+                }
+
+                iSkip -= iCount;
+            }
+        }
+
+        g_pWorld->miFireSkip = iSkip;
+    }
+    else
+    {
+        g_pWorld->mbMoveDown = false;
+    }
+
+    // Move the horde, either down a line or one column along. Both where it was and where it ends up need redrawing.
+    MarkHordeDirty();
+
+    if (g_pWorld->mbMoveDown)
+    {
+        ++g_pWorld->mxHorde.miOriginY;
+    }
+    else if (g_pWorld->mbHordeMoveRight)
+    {
+        ++g_pWorld->mxHorde.miOriginX;
+    }
+    else
+    {
+        --g_pWorld->mxHorde.miOriginX;
+    }
+
+    MarkHordeDirty();
+
+    // Check for game over.
+    if (0 < g_pWorld->mxHorde.miAlive &&
+        static_cast<int>(g_pWorld->miBarrierY) <= g_pWorld->mxHorde.RowY(g_pWorld->mxHorde.miMaxRow))
+    {
+        g_pWorld->mbGameOver = true;
+    }
+
+    // Go again in however long the horde's size calls for.
+    g_pWorld->mxTimers.Arm(ETimer_HordeStep, g_pWorld->miHordeReset >> c_iHordeResetShift);
+
+    return EError_OK;
+}
+
+bool HordeEnemyAt(int aiX, int aiY, u32 *pRow, u32 *pCol)
+{
+    int iDX = aiX - g_pWorld->mxHorde.miOriginX;
+    int iDY = aiY - g_pWorld->mxHorde.miOriginY;
+
+    // Off the lattice entirely, or in the gap between two slots.
+    if (0 > iDX || 0 > iDY || 0 != (iDX % c_iHordeXSpacing) || 0 != (iDY % c_iHordeYSpacing))
+    {
+        return false;
+    }
+
+    u32 iCol = iDX / c_iHordeXSpacing;
+    u32 iRow = iDY / c_iHordeYSpacing;
+
+    if (iCol >= g_pWorld->mxHorde.miCols || iRow >= g_pWorld->mxHorde.miRows)
+    {
+        return false;
+    }
+
+    if (!g_pWorld->mxHorde.Alive(iRow, iCol))
+    {
+        return false;
+    }
+
+    *pRow = iRow;
+    *pCol = iCol;
+    return true;
+}
+
+static void UpdateUFO()
+{
+    Ufo *pUFO = &g_pWorld->mxUFO;
+
+    LiftFromGrid(pUFO->miXPos, pUFO->miYPos, c_iUFOWidth);
+
+    if (0 >= pUFO->miXPos)
+    {
+        // Off the board, it's gone until it turns up again.
+        pUFO->mbActive = false;
+        pUFO->miXPos = g_pWorld->miBoardWidth + 2;
+        pUFO->miMoveWait = 2;
+    }
+    else
+    {
+        // Move the UFO.
+        --pUFO->miXPos;
+        PlaceOnGrid(pUFO->miXPos, pUFO->miYPos, c_iUFOWidth, EEntity_UFO);
+        g_pWorld->mxTimers.Arm(ETimer_UFOStep, 2);
+    }
+}
+
+// Each lane is moved in one pass over its position arrays, then a second pass resolves what the bullets hit. Nothing a
+// bullet hits changes where another bullet is, so this plays out just as moving and checking them one at a time would.
+void UpdateBullets(GameObject *pPlayer, GameObject *pScore)
+{
+    DirtyTracker *pDirty = &g_pWorld->mxDirty;
+
+    // The player's bullets go up a row every tick.
+    BulletLane *pLane = &g_pWorld->mxBullets.mxPlayer;
+    u32 iCount = pLane->Size();
+    int *pX = pLane->mvX.data();
+    int *pY = pLane->mvY.data();
+
+    if (pDirty->mbEnabled)
+    {
+        for (u32 iIdx = 0; iIdx < iCount; ++iIdx)
+        {
+            pDirty->Mark(pX[iIdx], pY[iIdx], 1);
+            pDirty->Mark(pX[iIdx], pY[iIdx] - 1, 1);
+        }
+    }
+
+    for (u32 iIdx = 0; iIdx < iCount; ++iIdx)
+    {
+        --pY[iIdx];
+    }
+
+    // Walking backwards means a removed bullet gets replaced by one that has already been checked.
+    for (int iIdx = (iCount - 1); iIdx >= 0; --iIdx)
+    {
+        // Check to make sure the bullet is still on the board, then check for collisions.
+        if (0 >= pY[iIdx] || CheckBarrierCollision(pX[iIdx], pY[iIdx]) ||
+            CheckEnemyCollision(pX[iIdx], pY[iIdx], pScore))
+        {
+            // Pop the bullet out of the lane.
+            pLane->Remove(iIdx);
+        }
+    }
+
+    // Now the enemy bullets, these fall slower and only change row every few ticks.
+    pLane = &g_pWorld->mxBullets.mxEnemy;
+    iCount = pLane->Size();
+    pX = pLane->mvX.data();
+    pY = pLane->mvY.data();
+    int *pSubY = pLane->mvSubY.data();
+
+    if (pDirty->mbEnabled)
+    {
+        for (u32 iIdx = 0; iIdx < iCount; ++iIdx)
+        {
+            if (c_iSubCells <= (pSubY[iIdx] + c_iEnemyBulletSpeed))
+            {
+                pDirty->Mark(pX[iIdx], pY[iIdx], 1);
+                pDirty->Mark(pX[iIdx], pY[iIdx] + 1, 1);
+            }
+        }
+    }
+
+    for (u32 iIdx = 0; iIdx < iCount; ++iIdx)
+    {
+        int iSubY = pSubY[iIdx] + c_iEnemyBulletSpeed;
+        int iStep = (c_iSubCells <= iSubY) ? 1 : 0;
+
+        pSubY[iIdx] = iSubY - (iStep * c_iSubCells);
+        pY[iIdx] += iStep;
+    }
+
+    for (int iIdx = (iCount - 1); iIdx >= 0; --iIdx)
+    {
+        // Check to make sure the bullet is still on the board.
+        if (g_pWorld->miBoardHeight <= pY[iIdx] || CheckBarrierCollision(pX[iIdx], pY[iIdx]))
+        {
+            // Pop the bullet out of the lane.
+            pLane->Remove(iIdx);
+        }
+        else if (!g_pWorld->mbGameOver && EEntity_Player == g_pWorld->mxGrid.At(pX[iIdx], pY[iIdx]))
+        {
+            // Pop the bullet out of the lane.
+            pLane->Remove(iIdx);
+
+            // Kill the player!
+            --g_pWorld->miLives;
+            LiftFromGrid(pPlayer->miXPos, pPlayer->miYPos, c_iPlayerWidth);
+            pPlayer->miXPos = (g_pWorld->miBoardWidth / 2) - 1;
+            pPlayer->miYPos = (g_pWorld->miBoardHeight * 7) / 8;
+            PlaceOnGrid(pPlayer->miXPos, pPlayer->miYPos, c_iPlayerWidth, EEntity_Player);
+
+            // Out of lives, that's the game.
+            if (0 == g_pWorld->miLives)
+            {
+                g_pWorld->mbGameOver = true;
+            }
+        }
+    }
+}
+
+bool CheckBarrierCollision(int aiX, int aiY)
+{
+    if (static_cast<int>(g_pWorld->miBarrierY) != aiY)
+    {
+        return false;
+    }
+
+    // Look the bullet's column up to see if there's a barrier standing in it.
+    if (0 > aiX || static_cast<u32>(aiX) >= g_pWorld->mvBarrierColumns.size() ||
+        c_iNoBarrier == g_pWorld->mvBarrierColumns[aiX])
+    {
+        return false;
+    }
+
+    // HIT!
+    BarrierTable *pBarriers = &g_pWorld->mxBarriers;
+    u32 iBarrier = g_pWorld->mvBarrierColumns[aiX];
+    --pBarriers->mvHealth[iBarrier];
+    g_pWorld->mxDirty.Mark(pBarriers->mvLeft[iBarrier], g_pWorld->miBarrierY, c_iBarrierWidth);
+
+    // Check to see if the barrier is done for, if so take it out of the column table.
+    if (0 == pBarriers->mvHealth[iBarrier])
+    {
+        for (int iCol = pBarriers->mvLeft[iBarrier]; iCol <= pBarriers->Right(iBarrier); ++iCol)
+        {
+            g_pWorld->mvBarrierColumns[iCol] = c_iNoBarrier;
+        }
+    }
+
+    return true;
+}
+
+bool CheckEnemyCollision(int aiX, int aiY, GameObject* apScore)
+{
+    EntityHandle hHit = QueryCell(aiX, aiY);
+
+    if (EEntity_Enemy == HandleKind(hHit))
+    {
+        u32 iRow = HandleIndex(hHit) / g_pWorld->mxHorde.miCols;
+        u32 iCol = HandleIndex(hHit) % g_pWorld->mxHorde.miCols;
+
+        // HIT!
+        apScore->miValue += g_pWorld->mxHorde.mvRowValue[iRow];
+
+        // Cut the enemy from the formation and return true to remove the bullet.
+        KillEnemy(iRow, iCol);
+
+        // Calculate the new horde timer reset amount. It's only ever above the minimum here when the game started
+        // above it, so the difference can't wrap. The last few kills can take it under the minimum, but never under 0.
+        u32 iResetMin = g_pWorld->mxParams.miHordeResetMin;
+
+        if (iResetMin < g_pWorld->miHordeReset && 1 < g_pWorld->mxHorde.miAlive)
+        {
+            u32 iSpeedDiff = g_pWorld->mxParams.miHordeReset - iResetMin;
+            u32 iStep = iSpeedDiff / (g_pWorld->mxHorde.miAlive - 1);
+            g_pWorld->miHordeReset -= std::min(iStep, g_pWorld->miHordeReset);
+        }
+
+        return true;
+    }
+
+    // Check for UFO collision.
+    if (EEntity_UFO == HandleKind(hHit))
+    {
+        Ufo *pUFO = &g_pWorld->mxUFO;
+
+        apScore->miValue += c_iUFOValue;
+        LiftFromGrid(pUFO->miXPos, pUFO->miYPos, c_iUFOWidth);
+        pUFO->miXPos = g_pWorld->miBoardWidth - 2;
+        pUFO->miYPos = 1;
+        pUFO->mbActive = false;
+        pUFO->miMoveWait = g_pWorld->mxTimers.Remaining(ETimer_UFOStep);
+        g_pWorld->mxTimers.Cancel(ETimer_UFOStep);
+        return true;
+    }
+
+    // Check if we dun won.
+    if (0 >= g_pWorld->mxHorde.miAlive)
+    {
+        g_pWorld->mbWin = true;
+    }
+
+    return false;
+}
+
+u32 GetScoreXPosition(u32 aiXTermWidth, const char *apStr)
+{
+    u32 iRtnVal = 1; // We start at one that way if the function fails, the text isn't against the side of the term.
+    u32 iStrLen = strlen(apStr);
+    iRtnVal = (aiXTermWidth / 2) - (iStrLen / 2);
+    return iRtnVal;
+}
+
+EError CreateBoard(GameObject *pPlyr)
+{
+    // First clear out the old crap.
+    ClearHorde();
+    g_pWorld->mxBarriers.Clear();
+    g_pWorld->mvBarrierColumns.assign(static_cast<u32>(g_pWorld->miBoardWidth), c_iNoBarrier);
+
+    // Determine the amount of barriers to make.
+    u32 iNumBarriers = (g_pWorld->miBoardWidth / c_iBarrierWidth) / 2;
+    u32 iBarrierXScale = g_pWorld->miBoardWidth / iNumBarriers;
+    u32 iLastX = iBarrierXScale / 2;
+
+    g_pWorld->miBarrierY = pPlyr->miYPos - 2;
+
+    for (u32 iIdx = 0; iIdx < iNumBarriers; ++iIdx)
+    {
+        // Lay the barrier out around its center, and claim its columns in the table.
+        u32 iBarrier = HandleIndex(g_pWorld->mxBarriers.Add(iLastX - ((c_iBarrierWidth - 1) / 2)));
+
+        for (int iCol = g_pWorld->mxBarriers.mvLeft[iBarrier]; iCol <= g_pWorld->mxBarriers.Right(iBarrier); ++iCol)
+        {
+            if (0 <= iCol && iCol < static_cast<int>(g_pWorld->mvBarrierColumns.size()))
+            {
+                g_pWorld->mvBarrierColumns[iCol] = iBarrier;
+            }
+        }
+
+        // Setup the next X position.
+        iLastX += iBarrierXScale;
+    }
+
+    // Create the horde of enemies.
+    u32 iBarrierY = g_pWorld->miBarrierY;
+    u32 iAmntHoriz = (g_pWorld->miBoardWidth - (iBarrierXScale * 2)) / 2; //!< Calculate the amount of horizontal enemies.
+    u32 iAmntVert = (iBarrierY - 8); //!< Calculate the ammount of vertical lines in use. Subtract '8' as the lines start @ 3 and stop at 5 above barrier Y.
+    u32 iEnemyX = iBarrierXScale; // Enemies start at X position of the first barrier.
+    u32 iEnemyY = 3; // Vertical lines start @ 3.
+    u32 iCols = 0;
+    u32 iRows = 0;
+
+    // Enemies run every other column up to the last barrier's X position, and every other line down to 5 above the barriers.
+    if (iEnemyX <= (g_pWorld->miBoardWidth - iBarrierXScale))
+    {
+        iCols = ((static_cast<u32>(g_pWorld->miBoardWidth - iBarrierXScale) - iEnemyX) / c_iHordeXSpacing) + 1;
+    }
+
+    if (iEnemyY <= (iBarrierY - 5))
+    {
+        iRows = (((iBarrierY - 5) - iEnemyY) / c_iHordeYSpacing) + 1;
+    }
+
+    BuildHorde(iEnemyX, iEnemyY, iCols, iRows, iAmntHoriz * iAmntVert);
+
+    return EError_OK;
+}
+
+EntityHandle QueryCell(int aiX, int aiY)
+{
+    switch (g_pWorld->mxGrid.At(aiX, aiY))
+    {
+        case EEntity_UFO:
+        {
+            return g_pWorld->mxUFO.Handle();
+        }
+        case EEntity_Player:
+        {
+            return MakeHandle(EEntity_Player, 0);
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    u32 iRow = 0;
+    u32 iCol = 0;
+
+    if (HordeEnemyAt(aiX, aiY, &iRow, &iCol))
+    {
+        return g_pWorld->mxHorde.Handle(iRow, iCol);
+    }
+
+    return MakeHandle(EEntity_None, 0);
+}
+
+bool EntityAlive(EntityHandle ahHandle)
+{
+    u32 iIdx = HandleIndex(ahHandle);
+    u32 iGeneration = HandleGeneration(ahHandle);
+
+    switch (HandleKind(ahHandle))
+    {
+        case EEntity_Enemy:
+        {
+            const Horde *pHorde = &g_pWorld->mxHorde;
+
+            return (pHorde->miGeneration & c_iGenerationMask) == iGeneration &&
+                   iIdx < (pHorde->miCols * pHorde->miRows) &&
+                   pHorde->Alive(iIdx / pHorde->miCols, iIdx % pHorde->miCols);
+        }
+        case EEntity_UFO:
+        {
+            return g_pWorld->mxUFO.mbActive && (g_pWorld->mxUFO.miGeneration & c_iGenerationMask) == iGeneration;
+        }
+        case EEntity_Player:
+        {
+            return !g_pWorld->mbGameOver;
+        }
+        case EEntity_PlayerShot:
+        {
+            return g_pWorld->mxBullets.mxPlayer.Find(ahHandle, &iIdx);
+        }
+        case EEntity_EnemyShot:
+        {
+            return g_pWorld->mxBullets.mxEnemy.Find(ahHandle, &iIdx);
+        }
+        case EEntity_Barrier:
+        {
+            const BarrierTable *pBarriers = &g_pWorld->mxBarriers;
+
+            return (pBarriers->miGeneration & c_iGenerationMask) == iGeneration && iIdx < pBarriers->Size() &&
+                   0 < pBarriers->mvHealth[iIdx];
+        }
+        default:
+        {
+            return false;
+        }
+    }
+}
+
+// Anything placed on or lifted off the grid has moved, so its cells are marked dirty as well.
+static void PlaceOnGrid(int aiX, int aiY, u32 aiWidth, EEntity aeKind)
+{
+    int iLeft = aiX - static_cast<int>(aiWidth / 2);
+    g_pWorld->mxGrid.Fill(iLeft, aiY, aiWidth, aeKind);
+    g_pWorld->mxDirty.Mark(iLeft, aiY, aiWidth);
+}
+
+static void LiftFromGrid(int aiX, int aiY, u32 aiWidth)
+{
+    int iLeft = aiX - static_cast<int>(aiWidth / 2);
+    g_pWorld->mxGrid.Fill(iLeft, aiY, aiWidth, EEntity_None);
+    g_pWorld->mxDirty.Mark(iLeft, aiY, aiWidth);
+}
+
+// The generation carries on past the old horde, so its handles don't name anyone in the next one.
+static void ClearHorde()
+{
+    Horde xEmpty;
+    xEmpty.miGeneration = g_pWorld->mxHorde.miGeneration + 1;
+    std::swap(g_pWorld->mxHorde, xEmpty);
+}
+
+static void BuildHorde(int aiOriginX, int aiOriginY, u32 aiCols, u32 aiRows, u32 aiMaxEnemies)
+{
+    g_pWorld->mxHorde.miOriginX = aiOriginX;
+    g_pWorld->mxHorde.miOriginY = aiOriginY;
+    g_pWorld->mxHorde.miCols = aiCols;
+    g_pWorld->mxHorde.miRows = aiRows;
+    g_pWorld->mxHorde.miWords = (aiCols + 63) / 64;
+    g_pWorld->mxHorde.mvAlive.assign(g_pWorld->mxHorde.miWords * aiRows, 0);
+    g_pWorld->mxHorde.mvColAlive.assign(aiCols, 0);
+    g_pWorld->mxHorde.mvRowAlive.assign(aiRows, 0);
+    g_pWorld->mxHorde.mvRowSprite.assign(aiRows, ESprite_Enemy1);
+    g_pWorld->mxHorde.mvRowValue.assign(aiRows, 5);
+
+    for (u32 iRow = 0; iRow < aiRows; ++iRow)
+    {
+        // Determin the enemy stats (string and value) for the row, class 1 unless one of these.
+        int iEnemyY = g_pWorld->mxHorde.RowY(iRow);
+
+        if (iEnemyY >= 3 && iEnemyY <= 5)
+        {
+            // Setup class 3.
+            g_pWorld->mxHorde.mvRowSprite[iRow] = ESprite_Enemy3;
+            g_pWorld->mxHorde.mvRowValue[iRow] = 15;
+        }
+        else if (iEnemyY >= 7 && iEnemyY <= 9)
+        {
+            // Setup class 2.
+            g_pWorld->mxHorde.mvRowSprite[iRow] = ESprite_Enemy2;
+            g_pWorld->mxHorde.mvRowValue[iRow] = 10;
+        }
+
+        // Fill the row, the last one may be cut short if the horde hits its size limit.
+        u32 iFill = aiCols;
+
+        if (aiMaxEnemies < (g_pWorld->mxHorde.miAlive + iFill))
+        {
+            iFill = aiMaxEnemies - g_pWorld->mxHorde.miAlive;
+        }
+
+        u64 *pMask = &g_pWorld->mxHorde.mvAlive[iRow * g_pWorld->mxHorde.miWords];
+
+        for (u32 iWord = 0; (iWord * 64) < iFill; ++iWord)
+        {
+            u32 iBits = iFill - (iWord * 64);
+            pMask[iWord] = (64 <= iBits) ? ~0ULL : ((1ULL << iBits) - 1);
+        }
+
+        for (u32 iCol = 0; iCol < iFill; ++iCol)
+        {
+            ++g_pWorld->mxHorde.mvColAlive[iCol];
+        }
+
+        g_pWorld->mxHorde.mvRowAlive[iRow] = iFill;
+        g_pWorld->mxHorde.miAlive += iFill;
+
+        if (0 < iFill)
+        {
+            g_pWorld->mxHorde.miMaxRow = iRow;
+            Horde *pHorde = &g_pWorld->mxHorde;
+            pHorde->miMaxCol = ((iFill - 1) > pHorde->miMaxCol) ? (iFill - 1) : pHorde->miMaxCol;
+        }
+    }
+}
+
+static void KillEnemy(u32 aiRow, u32 aiCol)
+{
+    g_pWorld->mxHorde.mvAlive[(aiRow * g_pWorld->mxHorde.miWords) + (aiCol / 64)] &= ~(1ULL << (aiCol % 64));
+    g_pWorld->mxDirty.Mark(g_pWorld->mxHorde.ColumnX(aiCol), g_pWorld->mxHorde.RowY(aiRow), 1);
+    --g_pWorld->mxHorde.mvColAlive[aiCol];
+    --g_pWorld->mxHorde.mvRowAlive[aiRow];
+    --g_pWorld->mxHorde.miAlive;
+
+    if (0 == g_pWorld->mxHorde.miAlive)
+    {
+        return;
+    }
+
+    // Pull the cached extents in past any columns or rows that just emptied out.
+    while (0 == g_pWorld->mxHorde.mvColAlive[g_pWorld->mxHorde.miMinCol])
+    {
+        ++g_pWorld->mxHorde.miMinCol;
+    }
+
+    while (0 == g_pWorld->mxHorde.mvColAlive[g_pWorld->mxHorde.miMaxCol])
+    {
+        --g_pWorld->mxHorde.miMaxCol;
+    }
+
+    while (0 == g_pWorld->mxHorde.mvRowAlive[g_pWorld->mxHorde.miMaxRow])
+    {
+        --g_pWorld->mxHorde.miMaxRow;
+    }
+}
+
+static void MarkHordeDirty()
+{
+    if (0 < g_pWorld->mxHorde.miAlive)
+    {
+        const Horde *pHorde = &g_pWorld->mxHorde;
+        g_pWorld->mxDirty.MarkRect(pHorde->ColumnX(pHorde->miMinCol), pHorde->RowY(0),
+                                   pHorde->ColumnX(pHorde->miMaxCol), pHorde->RowY(pHorde->miMaxRow));
+    }
+}
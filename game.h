@@ -0,0 +1,885 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    Game state and simulation. Nothing in here touches the terminal, so the game can be stepped by the NCurses
+ *    front-end (main.cpp) just as well as by the headless runner (headless.cpp).
+ */
+#ifndef SHELL_INVADERS_GAME_H
+#define SHELL_INVADERS_GAME_H
+
+#include <vector>
+#include <cmath>
+
+#include "sprites.h"
+
+// Custom datatypes used by the game for generic type usage.
+typedef unsigned char byte;
+typedef unsigned short u16;
+typedef unsigned int u32;
+typedef unsigned long long u64;
+typedef float real; //!< Here we use the Mathematical term "real" instead of "number" to help prevent confusion.
+
+// This data structure is used to for the various objects in the game.
+struct GameObject
+{
+    int miXPos; //!< X-Position (column) of the object's center character.
+    int miYPos; //!< Y-Position (row) of the object's center character.
+    const char* msCharStr; //!< The actual string that represents the object.
+    u32 miValue; //!< Point value assigned to this entity.
+
+    GameObject() : miXPos(0), miYPos(0), msCharStr(nullptr), miValue(0) {}
+};
+
+// Kinds of entity there are. Each kind is stored in its own table (see Horde, Ufo, BarrierTable and BulletLane), laid
+// out as an array per field so a pass over one kind only touches what it reads.
+enum EEntity
+{
+    EEntity_None, //!< Empty cell.
+    EEntity_Enemy, //!< A member of the horde, the index is (row * columns) + column in the formation.
+    EEntity_UFO, //!< The UFO.
+    EEntity_Player, //!< The player.
+    EEntity_PlayerShot, //!< A bullet in the player's lane, the index is its slot.
+    EEntity_EnemyShot, //!< A bullet in the enemy lane, the index is its slot.
+    EEntity_Barrier //!< A barrier, the index is its place in the barrier table.
+};
+
+// Handles pack the entity kind into the top byte, a generation into the next three and the index into the low half.
+// Whatever a handle names counts its generations (a bullet slot every time it's emptied, the horde, barriers and UFO
+// every time they're made anew), so a handle kept past the end of what it named no longer resolves (see EntityAlive()).
+typedef u64 EntityHandle;
+
+const u32 c_iGenerationMask = 0xFFFFFF;
+
+inline EntityHandle MakeHandle(EEntity aeKind, u32 aiIndex, u32 aiGeneration = 0)
+{
+    return (static_cast<u64>(aeKind) << 56) | (static_cast<u64>(aiGeneration & c_iGenerationMask) << 32) | aiIndex;
+}
+
+inline EEntity HandleKind(EntityHandle ahHandle) { return static_cast<EEntity>(ahHandle >> 56); }
+inline u32 HandleGeneration(EntityHandle ahHandle) { return static_cast<u32>(ahHandle >> 32) & c_iGenerationMask; }
+inline u32 HandleIndex(EntityHandle ahHandle) { return static_cast<u32>(ahHandle); }
+
+// Board sized map from every cell to the kind of entity sitting on it, so a collision check is one lookup. The horde
+// isn't written into it; its formation already is a grid (see Horde), and rewriting every enemy's cell on each horde
+// step would cost what the formation saves. QueryCell() looks in both and makes the handle. Only the player and the UFO
+// are in it, and there's one of each, so the kind is all a cell needs to hold.
+//
+// With only those two in it, nearly all of a large board is always empty, so the cells are kept in chunks that are
+// only allocated once something is put in one. A lookup in a chunk that never was is simply empty, so an arena many
+// times the size of the screen costs a table of chunk offsets rather than a byte per cell.
+const u32 c_iGridChunkWidth = 32;
+const u32 c_iGridChunkHeight = 8;
+const u32 c_iGridChunkCells = c_iGridChunkWidth * c_iGridChunkHeight;
+const u32 c_iNoChunk = 0xFFFFFFFF; //!< Chunk table entry for a chunk with nothing in it yet.
+
+struct OccupancyGrid
+{
+    u32 miWidth; //!< Columns in the grid.
+    u32 miHeight; //!< Rows in the grid.
+    u32 miChunkCols; //!< Chunks across the grid.
+    std::vector<u32> mvChunkAt; //!< Where each chunk's cells start in mvCells, row major, c_iNoChunk if nowhere.
+    std::vector<u32> mvUsed; //!< Chunks that have cells, in the order they got them.
+    std::vector<byte> mvCells; //!< The EEntity in each cell of the chunks in use, each chunk row major.
+
+    OccupancyGrid() : miWidth(0), miHeight(0), miChunkCols(0) {}
+
+    void Resize(u32 aiWidth, u32 aiHeight)
+    {
+        miWidth = aiWidth;
+        miHeight = aiHeight;
+        miChunkCols = (aiWidth + c_iGridChunkWidth - 1) / c_iGridChunkWidth;
+        mvChunkAt.assign(miChunkCols * ((aiHeight + c_iGridChunkHeight - 1) / c_iGridChunkHeight), c_iNoChunk);
+        mvUsed.clear();
+        mvCells.clear();
+    }
+
+    // Hands every chunk back, the storage is kept for the next board.
+    void Clear()
+    {
+        for (u32 iIdx = 0; iIdx < mvUsed.size(); ++iIdx)
+        {
+            mvChunkAt[mvUsed[iIdx]] = c_iNoChunk;
+        }
+
+        mvUsed.clear();
+        mvCells.clear();
+    }
+
+    EEntity At(int aiX, int aiY) const
+    {
+        if (0 > aiX || 0 > aiY || static_cast<u32>(aiX) >= miWidth || static_cast<u32>(aiY) >= miHeight)
+        {
+            return EEntity_None;
+        }
+
+        u32 iChunk = mvChunkAt[((aiY / c_iGridChunkHeight) * miChunkCols) + (aiX / c_iGridChunkWidth)];
+
+        if (c_iNoChunk == iChunk)
+        {
+            return EEntity_None;
+        }
+
+        return static_cast<EEntity>(mvCells[iChunk + ((aiY % c_iGridChunkHeight) * c_iGridChunkWidth) +
+                                            (aiX % c_iGridChunkWidth)]);
+    }
+
+    // Writes a kind across a run of cells on one row, clipped to the board. Clearing cells never allocates a chunk.
+    void Fill(int aiX, int aiY, u32 aiLength, EEntity aeKind)
+    {
+        if (0 > aiY || static_cast<u32>(aiY) >= miHeight)
+        {
+            return;
+        }
+
+        int iEnd = aiX + static_cast<int>(aiLength);
+        aiX = (0 > aiX) ? 0 : aiX;
+        iEnd = (iEnd > static_cast<int>(miWidth)) ? miWidth : iEnd;
+
+        u32 *pRow = &mvChunkAt[(aiY / c_iGridChunkHeight) * miChunkCols];
+        u32 iInChunkY = (aiY % c_iGridChunkHeight) * c_iGridChunkWidth;
+
+        for (int iX = aiX; iX < iEnd; ++iX)
+        {
+            u32 *pChunk = &pRow[iX / c_iGridChunkWidth];
+
+            if (c_iNoChunk == *pChunk)
+            {
+                if (EEntity_None == aeKind)
+                {
+                    continue;
+                }
+
+                *pChunk = mvCells.size();
+                mvUsed.push_back(pChunk - &mvChunkAt[0]);
+                mvCells.resize(mvCells.size() + c_iGridChunkCells, EEntity_None);
+            }
+
+            mvCells[*pChunk + iInChunkY + (iX % c_iGridChunkWidth)] = aeKind;
+        }
+    }
+};
+
+// The part of the board on screen. A board can be far bigger than the terminal (an arena), in which case the view
+// follows the player around it (see FollowPlayer()). Board cell (x, y) is shown at screen cell (x - miX, y - miY),
+// except on the screen's bottom row, which always holds the score line.
+struct Viewport
+{
+    int miX; //!< Board column at the screen's left edge.
+    int miY; //!< Board row at the screen's top edge.
+    u32 miWidth; //!< Screen columns.
+    u32 miHeight; //!< Screen rows, the score line included.
+
+    Viewport() : miX(0), miY(0), miWidth(0), miHeight(0) {}
+
+    int HudRow() const { return static_cast<int>(miHeight) - 1; } //!< Screen row of the score line.
+
+    // Whether a board cell lands on the screen above the score line.
+    bool Shows(int aiX, int aiY) const
+    {
+        return miX <= aiX && aiX < (miX + static_cast<int>(miWidth)) && miY <= aiY && aiY < (miY + HudRow());
+    }
+};
+
+// Records which cells changed since the last frame, so a front-end only has to redraw those. Every row keeps one
+// span covering all the changes made on it. Marking does nothing unless the tracker is enabled, the headless runner
+// leaves it off.
+struct DirtyTracker
+{
+    bool mbEnabled; //!< Should changes be recorded at all?
+    bool mbFullRedraw; //!< The whole board changed (e.g. a new board was built).
+    u32 miWidth; //!< Columns tracked.
+    u32 miHeight; //!< Rows tracked.
+    std::vector<int> mvMinX; //!< Left edge of each row's span, past the right edge when the row is clean.
+    std::vector<int> mvMaxX; //!< Right edge of each row's span.
+    std::vector<u32> mvRows; //!< Rows with a span, in the order they were first marked.
+
+    DirtyTracker() : mbEnabled(false), mbFullRedraw(true), miWidth(0), miHeight(0) {}
+
+    void Resize(u32 aiWidth, u32 aiHeight)
+    {
+        miWidth = aiWidth;
+        miHeight = aiHeight;
+        mvMinX.assign(aiHeight, aiWidth);
+        mvMaxX.assign(aiHeight, -1);
+        mvRows.clear();
+        mvRows.reserve(aiHeight);
+        mbFullRedraw = true;
+    }
+
+    void Mark(int aiX, int aiY, u32 aiLength)
+    {
+        if (!mbEnabled || 0 > aiY || static_cast<u32>(aiY) >= miHeight || 0 == aiLength)
+        {
+            return;
+        }
+
+        int iEnd = aiX + static_cast<int>(aiLength) - 1;
+        aiX = (0 > aiX) ? 0 : aiX;
+        iEnd = (iEnd >= static_cast<int>(miWidth)) ? (miWidth - 1) : iEnd;
+
+        if (aiX > iEnd)
+        {
+            return;
+        }
+
+        if (mvMinX[aiY] > mvMaxX[aiY])
+        {
+            mvRows.push_back(aiY);
+            mvMinX[aiY] = aiX;
+            mvMaxX[aiY] = iEnd;
+        }
+        else
+        {
+            mvMinX[aiY] = (aiX < mvMinX[aiY]) ? aiX : mvMinX[aiY];
+            mvMaxX[aiY] = (iEnd > mvMaxX[aiY]) ? iEnd : mvMaxX[aiY];
+        }
+    }
+
+    void MarkRect(int aiLeft, int aiTop, int aiRight, int aiBottom)
+    {
+        for (int iY = aiTop; iY <= aiBottom; ++iY)
+        {
+            Mark(aiLeft, iY, aiRight - aiLeft + 1);
+        }
+    }
+
+    bool IsDirty(int aiX, int aiY) const
+    {
+        return 0 <= aiY && static_cast<u32>(aiY) < miHeight && mvMinX[aiY] <= aiX && aiX <= mvMaxX[aiY];
+    }
+
+    void Clear()
+    {
+        for (u32 iIdx = 0; iIdx < mvRows.size(); ++iIdx)
+        {
+            mvMinX[mvRows[iIdx]] = miWidth;
+            mvMaxX[mvRows[iIdx]] = -1;
+        }
+
+        mvRows.clear();
+        mbFullRedraw = false;
+    }
+};
+
+const u32 c_iBarrierWidth = SpriteOf(ESprite_Barrier).miWidth;
+const u32 c_iBarrierHealth = 9;
+const u16 c_iNoBarrier = 0xFFFF; //!< Column table entry for a column without a barrier.
+
+// Barriers all sit on the one row (g_iBarrierY), so they're found through a per-column table instead of by searching.
+// Destroyed barriers stay in the table with no health left, which keeps the ids in the column table stable; only a new
+// board replaces them, and it bumps the generation.
+struct BarrierTable
+{
+    std::vector<int> mvLeft; //!< Column of each barrier's left edge.
+    std::vector<u32> mvHealth; //!< Hits each has left before it's gone.
+    u32 miGeneration;
+
+    BarrierTable() : miGeneration(0) {}
+
+    u32 Size() const { return mvLeft.size(); }
+    int Right(u32 aiIdx) const { return mvLeft[aiIdx] + static_cast<int>(c_iBarrierWidth - 1); }
+    EntityHandle Handle(u32 aiIdx) const { return MakeHandle(EEntity_Barrier, aiIdx, miGeneration); }
+
+    void Clear()
+    {
+        mvLeft.clear();
+        mvHealth.clear();
+        ++miGeneration;
+    }
+
+    EntityHandle Add(int aiLeft)
+    {
+        mvLeft.push_back(aiLeft);
+        mvHealth.push_back(c_iBarrierHealth);
+        return Handle(mvLeft.size() - 1);
+    }
+};
+
+// Everything sits on whole cells. Anything slower than a cell a tick keeps how far it has got towards the next cell in
+// steps of 1/c_iSubCells, so every position stays an integer (60 divides evenly by any speed we're likely to want).
+const int c_iSubCells = 60;
+const int c_iEnemyBulletSpeed = c_iSubCells / 5; //!< Enemy bullets fall a fifth of a row each tick.
+
+// A fixed capacity table of bullets, one array per field. Live bullets are packed at the front of every array, so a
+// pass over them is a straight run through each one, and removing a bullet moves the last one into its place. Which
+// way a bullet travels is given by the lane it sits in.
+//
+// A bullet's place in the arrays changes as others are removed, so its handle names a slot instead, which stays put.
+// A slot's generation goes up whenever its bullet is removed, so the handle goes stale with it. The slots are all let
+// go whenever the lane empties, which keeps copying a lane (see CloneWorld()) cheap after a burst of fire; new slots
+// start past every generation handed out before, so old handles stay stale.
+const u32 c_iNoSlot = 0xFFFFFFFF;
+
+struct BulletSlot
+{
+    u32 miIndex; //!< Where the slot's bullet is in the arrays, or the next free slot when it hasn't got one.
+    u32 miGeneration;
+};
+
+struct BulletLane
+{
+    std::vector<int> mvX; //!< Column of each live bullet.
+    std::vector<int> mvY; //!< Row of each live bullet.
+    std::vector<int> mvSubY; //!< How far each has got towards the next row, in 1/c_iSubCells of a row.
+    std::vector<u32> mvSlot; //!< The slot each live bullet's handle names.
+    std::vector<BulletSlot> mvSlots;
+    u32 miFreeSlot; //!< First of the slots without a bullet, c_iNoSlot when every slot has one.
+    u32 miNextGeneration; //!< Past every generation handed out, new slots start on it.
+    u32 miCapacity; //!< Most bullets the lane will hold, shots past this are dropped.
+    EEntity meKind; //!< The kind its handles carry.
+
+    explicit BulletLane(EEntity aeKind) : miFreeSlot(c_iNoSlot), miNextGeneration(0), miCapacity(0), meKind(aeKind) {}
+
+    // Takes all the room the lane will ever use, so spawning never allocates.
+    void Reserve(u32 aiCapacity)
+    {
+        miCapacity = aiCapacity;
+        mvX.reserve(aiCapacity);
+        mvY.reserve(aiCapacity);
+        mvSubY.reserve(aiCapacity);
+        mvSlot.reserve(aiCapacity);
+        mvSlots.reserve(aiCapacity);
+    }
+
+    u32 Size() const { return mvX.size(); }
+
+    EntityHandle Handle(u32 aiIdx) const
+    {
+        return MakeHandle(meKind, mvSlot[aiIdx], mvSlots[mvSlot[aiIdx]].miGeneration);
+    }
+
+    void Clear()
+    {
+        for (u32 iIdx = 0; iIdx < mvSlot.size(); ++iIdx)
+        {
+            FreeSlot(mvSlot[iIdx]);
+        }
+
+        mvX.clear();
+        mvY.clear();
+        mvSubY.clear();
+        mvSlot.clear();
+        DropSlots();
+    }
+
+    // Returns the new bullet's handle, or an EEntity_None one when the lane is full.
+    EntityHandle Spawn(int aiXPos, int aiYPos)
+    {
+        if (mvX.size() >= miCapacity)
+        {
+            return MakeHandle(EEntity_None, 0);
+        }
+
+        u32 iSlot = miFreeSlot;
+
+        if (c_iNoSlot == iSlot)
+        {
+            BulletSlot xSlot = { 0, miNextGeneration };
+            iSlot = mvSlots.size();
+            mvSlots.push_back(xSlot);
+        }
+        else
+        {
+            miFreeSlot = mvSlots[iSlot].miIndex;
+        }
+
+        mvSlots[iSlot].miIndex = mvX.size();
+        mvX.push_back(aiXPos);
+        mvY.push_back(aiYPos);
+        mvSubY.push_back(0);
+        mvSlot.push_back(iSlot);
+
+        return MakeHandle(meKind, iSlot, mvSlots[iSlot].miGeneration);
+    }
+
+    void Remove(u32 aiIdx)
+    {
+        FreeSlot(mvSlot[aiIdx]);
+
+        if ((aiIdx + 1) < mvX.size())
+        {
+            mvX[aiIdx] = mvX.back();
+            mvY[aiIdx] = mvY.back();
+            mvSubY[aiIdx] = mvSubY.back();
+            mvSlot[aiIdx] = mvSlot.back();
+            mvSlots[mvSlot[aiIdx]].miIndex = aiIdx;
+        }
+
+        mvX.pop_back();
+        mvY.pop_back();
+        mvSubY.pop_back();
+        mvSlot.pop_back();
+
+        if (mvX.empty())
+        {
+            DropSlots();
+        }
+    }
+
+    // Where a handle's bullet is in the arrays, false when it's been removed since.
+    bool Find(EntityHandle ahHandle, u32 *pIdx) const
+    {
+        u32 iSlot = HandleIndex(ahHandle);
+
+        if (meKind != HandleKind(ahHandle) || iSlot >= mvSlots.size() ||
+            (mvSlots[iSlot].miGeneration & c_iGenerationMask) != HandleGeneration(ahHandle))
+        {
+            return false;
+        }
+
+        *pIdx = mvSlots[iSlot].miIndex;
+        return true;
+    }
+
+    void FreeSlot(u32 aiSlot)
+    {
+        u32 iGeneration = ++mvSlots[aiSlot].miGeneration;
+        miNextGeneration = (iGeneration > miNextGeneration) ? iGeneration : miNextGeneration;
+        mvSlots[aiSlot].miIndex = miFreeSlot;
+        miFreeSlot = aiSlot;
+    }
+
+    // Only once every slot is free.
+    void DropSlots()
+    {
+        mvSlots.clear();
+        miFreeSlot = c_iNoSlot;
+    }
+};
+
+// Player bullets travel up, enemy bullets travel down.
+struct BulletPool
+{
+    BulletLane mxPlayer;
+    BulletLane mxEnemy;
+
+    BulletPool() : mxPlayer(EEntity_PlayerShot), mxEnemy(EEntity_EnemyShot) {}
+};
+
+const u32 c_iBulletLaneCapacity = 16384; //!< Bullets each lane reserves room for.
+
+// The horde is kept as a formation rather than as separate objects. Every enemy sits on a lattice that is
+// c_iHordeXSpacing columns by c_iHordeYSpacing rows apart, so moving the whole horde is just moving the origin.
+const int c_iHordeXSpacing = 2;
+const int c_iHordeYSpacing = 2;
+
+struct Horde
+{
+    int miOriginX; //!< Column of the left-most lattice slot.
+    int miOriginY; //!< Row of the top lattice slot.
+    u32 miCols; //!< Lattice slots per row.
+    u32 miRows; //!< Lattice rows.
+    u32 miWords; //!< 64-bit words per row in the alive mask.
+    u32 miAlive; //!< Enemies left alive.
+    u32 miMinCol; //!< Left-most lattice column with an enemy alive in it.
+    u32 miMaxCol; //!< Right-most lattice column with an enemy alive in it.
+    u32 miMaxRow; //!< Bottom lattice row with an enemy alive in it.
+    std::vector<u64> mvAlive; //!< Alive bitmask, miWords words per row.
+    std::vector<u32> mvColAlive; //!< Enemies alive in each lattice column.
+    std::vector<u32> mvRowAlive; //!< Enemies alive in each lattice row.
+    std::vector<byte> mvRowSprite; //!< The ESprite drawn for every enemy in a row (their class).
+    std::vector<u32> mvRowValue; //!< Point value of every enemy in a row.
+    u32 miGeneration; //!< Bumped for every new horde, enemy handles carry it.
+
+    Horde() : miOriginX(0), miOriginY(0), miCols(0), miRows(0), miWords(0), miAlive(0), miMinCol(0), miMaxCol(0),
+              miMaxRow(0), miGeneration(0) {}
+
+    // Board position of a lattice slot.
+    int ColumnX(u32 aiCol) const { return miOriginX + (static_cast<int>(aiCol) * c_iHordeXSpacing); }
+    int RowY(u32 aiRow) const { return miOriginY + (static_cast<int>(aiRow) * c_iHordeYSpacing); }
+
+    const u64* RowMask(u32 aiRow) const { return &mvAlive[aiRow * miWords]; }
+    bool Alive(u32 aiRow, u32 aiCol) const { return 0 != (RowMask(aiRow)[aiCol / 64] & (1ULL << (aiCol % 64))); }
+
+    EntityHandle Handle(u32 aiRow, u32 aiCol) const
+    {
+        return MakeHandle(EEntity_Enemy, (aiRow * miCols) + aiCol, miGeneration);
+    }
+};
+
+// There's only ever the one UFO, flying right to left along the top of the board.
+struct Ufo
+{
+    int miXPos; //!< X-Position (column) of the UFO's center character.
+    int miYPos; //!< Y-Position (row) of the UFO.
+    bool mbActive; //!< Whether it's out, it's left off the board and the grid when it isn't.
+    u32 miMoveWait; //!< What was left of its move countdown (ETimer_UFOStep) when it went, it carries on from there.
+    u32 miGeneration; //!< Bumped every time it turns up, so a handle doesn't outlive one flight.
+
+    Ufo() : miXPos(0), miYPos(0), mbActive(false), miMoveWait(0), miGeneration(0) {}
+
+    EntityHandle Handle() const { return MakeHandle(EEntity_UFO, 0, miGeneration); }
+};
+
+const u32 c_iUFOValue = 200; //!< Points for shooting the UFO down.
+
+// Things in the game that happen on a countdown. Each has one timer on the wheel, armed or not; a new timed mechanic
+// is a new entry here and a case where StepGame() handles it.
+enum ETimer
+{
+    ETimer_HordeStep, //!< The horde moves.
+    ETimer_UFOStep, //!< The UFO moves, only armed while it's out.
+    ETimer_FireCooldown, //!< The player can't shoot until it runs out.
+    ETimer_Count
+};
+
+// Hierarchical timer wheel counting in played ticks. Level 0 has a slot for each of the next 64 ticks, and each level
+// above covers 64 of the level below's spans. A timer sits on the lowest level whose span holds both now and its
+// deadline, and moves down a level each time the wheel enters that span, so a tick only ever touches the timers that
+// expire on it or move down at it, however many are armed.
+//
+// The timers are a fixed set (ETimer) kept in per-slot lists linked by index, so a wheel is a plain value and cloning
+// a world copies it with everything else.
+const u32 c_iWheelBits = 6;
+const u32 c_iWheelSlots = 1 << c_iWheelBits;
+const u32 c_iWheelLevels = 4;
+const u64 c_iWheelRange = (1ULL << (c_iWheelBits * c_iWheelLevels)) - 1; //!< Longest delay, longer ones are cut to it.
+const byte c_iNoTimer = 0xFF;
+const u16 c_iNoWheelSlot = 0xFFFF;
+
+struct TimerWheel
+{
+    u64 miNow; //!< The next tick Advance() expires.
+    u64 mvDeadline[ETimer_Count]; //!< Tick each armed timer goes off on.
+    byte mvNext[ETimer_Count]; //!< Next timer in the same slot.
+    byte mvPrev[ETimer_Count]; //!< Previous timer in the same slot, c_iNoTimer for the first.
+    u16 mvSlotOf[ETimer_Count]; //!< Slot (level * c_iWheelSlots + index) of each timer, c_iNoWheelSlot if disarmed.
+    byte mvHead[c_iWheelLevels * c_iWheelSlots]; //!< First timer in each slot.
+
+    TimerWheel() : miNow(0)
+    {
+        for (u32 iIdx = 0; iIdx < ETimer_Count; ++iIdx)
+        {
+            mvSlotOf[iIdx] = c_iNoWheelSlot;
+        }
+
+        for (u32 iIdx = 0; iIdx < (c_iWheelLevels * c_iWheelSlots); ++iIdx)
+        {
+            mvHead[iIdx] = c_iNoTimer;
+        }
+    }
+
+    bool Armed(ETimer aeTimer) const { return c_iNoWheelSlot != mvSlotOf[aeTimer]; }
+
+    // Ticks left before an armed timer goes off, 0 when it goes off on the next one.
+    u64 Remaining(ETimer aeTimer) const { return mvDeadline[aeTimer] - miNow; }
+
+    // Sets a timer to go off aiDelay ticks after the next one, whether or not it was already armed.
+    void Arm(ETimer aeTimer, u64 aiDelay)
+    {
+        Cancel(aeTimer);
+        mvDeadline[aeTimer] = miNow + ((aiDelay > c_iWheelRange) ? c_iWheelRange : aiDelay);
+        Insert(aeTimer);
+    }
+
+    void Cancel(ETimer aeTimer)
+    {
+        u16 iSlot = mvSlotOf[aeTimer];
+
+        if (c_iNoWheelSlot == iSlot)
+        {
+            return;
+        }
+
+        if (c_iNoTimer == mvPrev[aeTimer])
+        {
+            mvHead[iSlot] = mvNext[aeTimer];
+        }
+        else
+        {
+            mvNext[mvPrev[aeTimer]] = mvNext[aeTimer];
+        }
+
+        if (c_iNoTimer != mvNext[aeTimer])
+        {
+            mvPrev[mvNext[aeTimer]] = mvPrev[aeTimer];
+        }
+
+        mvSlotOf[aeTimer] = c_iNoWheelSlot;
+    }
+
+    // Disarms everything, the clock keeps going.
+    void Clear()
+    {
+        for (u32 iIdx = 0; iIdx < ETimer_Count; ++iIdx)
+        {
+            Cancel(static_cast<ETimer>(iIdx));
+        }
+    }
+
+    // Runs the clock on a tick and returns the timers that went off on it, a bit per ETimer. They're disarmed, and
+    // whoever handles them re-arms them if they repeat.
+    u32 Advance()
+    {
+        // Entering a new span on a level brings its timers down, the highest level first so they can keep falling.
+        u32 iLevel = 1;
+
+        while (iLevel < c_iWheelLevels && 0 == (miNow & ((1ULL << (c_iWheelBits * iLevel)) - 1)))
+        {
+            ++iLevel;
+        }
+
+        while (1 < iLevel--)
+        {
+            u32 iSlot = (iLevel * c_iWheelSlots) + ((miNow >> (c_iWheelBits * iLevel)) & (c_iWheelSlots - 1));
+            byte iTimer = mvHead[iSlot];
+
+            mvHead[iSlot] = c_iNoTimer;
+
+            while (c_iNoTimer != iTimer)
+            {
+                byte iNext = mvNext[iTimer];
+                Insert(static_cast<ETimer>(iTimer));
+                iTimer = iNext;
+            }
+        }
+
+        // Everything in the level 0 slot goes off now.
+        u32 iDue = 0;
+        u32 iSlot = miNow & (c_iWheelSlots - 1);
+
+        for (byte iTimer = mvHead[iSlot]; c_iNoTimer != iTimer; iTimer = mvNext[iTimer])
+        {
+            iDue |= 1U << iTimer;
+            mvSlotOf[iTimer] = c_iNoWheelSlot;
+        }
+
+        mvHead[iSlot] = c_iNoTimer;
+        ++miNow;
+
+        return iDue;
+    }
+
+    // Ticks that can go by before the next timer goes off, c_iWheelRange when none is armed. Nothing timed happens
+    // in between, so a runner can skip them.
+    u64 Idle() const
+    {
+        u64 iIdle = c_iWheelRange;
+
+        for (u32 iIdx = 0; iIdx < ETimer_Count; ++iIdx)
+        {
+            if (c_iNoWheelSlot != mvSlotOf[iIdx] && (mvDeadline[iIdx] - miNow) < iIdle)
+            {
+                iIdle = mvDeadline[iIdx] - miNow;
+            }
+        }
+
+        return iIdle;
+    }
+
+    void Insert(ETimer aeTimer)
+    {
+        u64 iDeadline = (mvDeadline[aeTimer] < miNow) ? miNow : mvDeadline[aeTimer];
+        u32 iLevel = 0;
+
+        while ((iLevel + 1) < c_iWheelLevels &&
+               (iDeadline >> (c_iWheelBits * (iLevel + 1))) != (miNow >> (c_iWheelBits * (iLevel + 1))))
+        {
+            ++iLevel;
+        }
+
+        u16 iSlot = (iLevel * c_iWheelSlots) + ((iDeadline >> (c_iWheelBits * iLevel)) & (c_iWheelSlots - 1));
+
+        mvDeadline[aeTimer] = iDeadline;
+        mvSlotOf[aeTimer] = iSlot;
+        mvPrev[aeTimer] = c_iNoTimer;
+        mvNext[aeTimer] = mvHead[iSlot];
+
+        if (c_iNoTimer != mvHead[iSlot])
+        {
+            mvPrev[mvHead[iSlot]] = aeTimer;
+        }
+
+        mvHead[iSlot] = aeTimer;
+    }
+};
+
+// Small, fast, seedable random number generator (PCG32, XSH-RR). Each subsystem that needs randomness gets its own
+// stream so that, say, how often the UFO turns up can't change which enemies fire.
+struct Rng
+{
+    u64 miState; //!< Internal state, advanced every draw.
+    u64 miInc; //!< Stream selector, always odd.
+
+    Rng() { Seed(1, 0); }
+
+    void Seed(u64 aiSeed, u64 aiStream)
+    {
+        miState = 0;
+        miInc = (aiStream << 1) | 1;
+        Next();
+        miState += aiSeed;
+        Next();
+    }
+
+    u32 Next()
+    {
+        u64 iOld = miState;
+        miState = (iOld * 6364136223846793005ULL) + miInc;
+
+        u32 iShifted = static_cast<u32>(((iOld >> 18) ^ iOld) >> 27);
+        u32 iRot = static_cast<u32>(iOld >> 59);
+
+        return (iShifted >> iRot) | (iShifted << ((32 - iRot) & 31));
+    }
+
+    // Uniform in [0, aiBound), without the bias of a plain modulo (Lemire's method).
+    u32 Below(u32 aiBound)
+    {
+        u64 iProduct = static_cast<u64>(Next()) * aiBound;
+        u32 iLow = static_cast<u32>(iProduct);
+
+        if (iLow < aiBound)
+        {
+            u32 iThreshold = (0U - aiBound) % aiBound;
+
+            while (iLow < iThreshold)
+            {
+                iProduct = static_cast<u64>(Next()) * aiBound;
+                iLow = static_cast<u32>(iProduct);
+            }
+        }
+
+        return static_cast<u32>(iProduct >> 32);
+    }
+
+    // Failed trials before the first success when each succeeds with a 1 in aiOdds chance. One draw stands in for a
+    // whole run of per-trial rolls.
+    u32 Geometric(u32 aiOdds)
+    {
+        if (1 >= aiOdds)
+        {
+            return 0;
+        }
+
+        // Uniform in (0, 1], so the log is always finite.
+        double nUniform = (static_cast<double>(Next()) + 1.0) / 4294967296.0;
+        double nSkip = std::floor(std::log(nUniform) / std::log1p(-1.0 / aiOdds));
+
+        return (4294967295.0 <= nSkip) ? 0xFFFFFFFFU : static_cast<u32>(nSkip);
+    }
+};
+
+// The random streams the simulation draws from.
+enum ERngStream
+{
+    ERngStream_UFO = 1, //!< UFO spawns.
+    ERngStream_EnemyFire, //!< Which enemies shoot.
+    ERngStream_Input //!< Reserved for front-ends that make up input (the headless runner).
+};
+
+// Errors that are thrown during runtime.
+enum EError
+{
+    EError_OK, //!< No error occurred.
+    EError_Unknown, //!< An unknown error occurred.
+    EError_SegFault, //!< A segmentation fault (read-access violation) occurred.
+    EError_MemCorrupt, //!< Memory corruption (write-access violation) occurred.
+    EError_AssertPop, //!< A psuedo-assert popped (non-terminating assert).
+    EError_InvalidArg //!< An invalid argument was passed.
+};
+
+// Inputs the simulation understands, front-ends translate their keys into these.
+enum EInput
+{
+    EInput_None, //!< Nothing was pressed.
+    EInput_Left, //!< Move the player left.
+    EInput_Right, //!< Move the player right.
+    EInput_Fire, //!< Shoot a bullet.
+    EInput_Back, //!< Return to the menu (or quit when already on it).
+    EInput_Quit, //!< Quit the game outright.
+    EInput_Start, //!< Start a new game from the menu.
+    EInput_Overlay, //!< Toggle the front-end's timing overlay, the simulation ignores it.
+    EInput_Rewind //!< Go back a second, the front-end does it from its snapshots (see snapshot.h).
+};
+
+// Smallest and largest boards the game can be laid out on. Past the largest, the barriers wouldn't fit in the column
+// table.
+const u32 c_iMinBoardWidth = 60;
+const u32 c_iMinBoardHeight = 16;
+const u32 c_iMaxBoardWidth = 16384;
+const u32 c_iMaxBoardHeight = 4096;
+
+// The horde's move interval is kept in fixed point, this many bits of it are fractions of a tick. It speeds up by a
+// fraction of a tick per kill, and whole ticks are what the timer gets armed with.
+const u32 c_iHordeResetShift = 16;
+
+// Gameplay constants. A game takes them from its world, so they can be tuned per game (the batch runner sweeps them).
+struct GameParams
+{
+    u32 miHordeReset; //!< Ticks between horde moves at the start of a game, fixed point (see c_iHordeResetShift).
+    u32 miHordeResetMin; //!< Fewest ticks between horde moves, reached as the horde is thinned out, fixed point.
+    u32 miFireCooldown; //!< Ticks the player has to wait between shots.
+    u32 miEnemyFireOdds; //!< Each enemy has a 1 in N chance of firing when the horde moves.
+    u32 miUFOSpawnOdds; //!< The UFO has a 1 in N chance of turning up each tick.
+    u32 miLives; //!< Lives at the start of a game.
+
+    GameParams() : miHordeReset(30 << c_iHordeResetShift), miHordeResetMin(5 << c_iHordeResetShift), miFireCooldown(15),
+                   miEnemyFireOdds(1000), miUFOSpawnOdds(1000), miLives(3) {}
+};
+
+// Everything a game changes as it's played. Worlds are plain values (no pointers), so they can be copied, and every
+// thread can step its own.
+struct World
+{
+    GameParams mxParams;
+    int miBoardWidth; //!< Columns on the board.
+    int miBoardHeight; //!< Rows on the board.
+    Viewport mxView; //!< The part of the board on screen, all of it unless the board is bigger than the terminal.
+    GameObject mxPlayer; //!< Player and score for runners that don't keep their own (the batch runner).
+    GameObject mxScore;
+    Ufo mxUFO;
+    bool mbRunning;
+    bool mbHordeMoveRight;
+    bool mbGameOver;
+    bool mbWin;
+    bool mbMoveDown;
+    bool mbIsIntro;
+    BulletPool mxBullets;
+    BarrierTable mxBarriers;
+    std::vector<u16> mvBarrierColumns; //!< Barrier index standing in each column, c_iNoBarrier where there's none.
+    Horde mxHorde;
+    OccupancyGrid mxGrid;
+    DirtyTracker mxDirty;
+    TimerWheel mxTimers;
+    u32 miBarrierY;
+    u32 miLives;
+    u32 miHordeReset; //!< Ticks between horde moves now, fixed point (see c_iHordeResetShift).
+    Rng mxUFORng;
+    Rng mxFireRng;
+    u32 miFireSkip; //!< Enemy fire rolls left to fail before the next one succeeds.
+
+    World() : miBoardWidth(0), miBoardHeight(0), mbRunning(true), mbHordeMoveRight(false), mbGameOver(false),
+              mbWin(false), mbMoveDown(false), mbIsIntro(true), miBarrierY(0),
+              miLives(3), miHordeReset(30 << c_iHordeResetShift), miFireSkip(0) {}
+};
+
+// Function prototyping.
+EError InitGame(u32 aiWidth, u32 aiHeight, GameObject *pPlyr, GameObject *pScore); //!< Lays out a board of the given size.
+void ShutdownGame(); //!< Frees everything allocated by the game.
+void SetViewport(u32 aiWidth, u32 aiHeight); //!< Sizes the view of the board to a screen, clipped to the board.
+bool FollowPlayer(const GameObject *pPlayer); //!< Scrolls the view to keep the player on screen, true if it moved.
+void SeedGame(u64 aiSeed); //!< Reseeds every random stream the simulation uses.
+void CloneWorld(World *pDst, const World *pSrc); //!< Copies a world for looking ahead, see game.cpp.
+EError NewGame(GameObject *pPlyr, GameObject *pScore); //!< Resets the score, lives and timers and builds a fresh board.
+EError StepGame(GameObject *pPlayer, GameObject *pScore); //!< Advances the simulation by one tick.
+EError ApplyInput(EInput aeInput, GameObject *pPlayer, GameObject *pScore); //!< Applies a single input to the game.
+EInput CharToInput(int acChar); //!< Translates a plain key code into a game input.
+EError MoveHorde(); //!< This moves the horde of enemies.
+void UpdateBullets(GameObject *pPlayer, GameObject *pScore); //!< Moves every bullet a tick and resolves what they hit.
+bool HordeEnemyAt(int aiX, int aiY, u32 *pRow, u32 *pCol); //!< Looks up the live enemy on a board cell, if there is one.
+EntityHandle QueryCell(int aiX, int aiY); //!< Returns the entity on a board cell, enemies included.
+bool EntityAlive(EntityHandle ahHandle); //!< Whether what a handle names is still in the game.
+EError CreateBoard(GameObject *pPlyr);
+bool CheckEnemyCollision(int aiX, int aiY, GameObject* apScore); //!< Resolves a player shot landing on a cell.
+bool CheckBarrierCollision(int aiX, int aiY); //!< Resolves a shot landing on a cell, true if a barrier took it.
+u32 GetScoreXPosition(u32 aiXTermWidth, const char* apStr);
+
+// Global objects.
+extern thread_local World *g_pWorld; //!< The world the game functions act on, each thread points it at its own.
+extern u32 g_iHiScore;
+
+#endif // SHELL_INVADERS_GAME_H
@@ -0,0 +1,306 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    Headless runner. Games are played back-to-back on a virtual board with either scripted or random input, as fast
+ *    as the simulation will go. Nothing is rendered.
+ *
+ *    Script keys (one per tick, the script loops):
+ *        a / d           Move Left / Right
+ *        w / (space)     Shoot bullet
+ *        .               Do nothing
+ *
+ *    --bot plays with the autoplayer instead (see bot.h), --bot-beam and --bot-depth set how wide and how far ahead it
+ *    searches. --record writes every input to a log (see replay.h), --replay plays one back as fast as it will go, on
+ *    the board and seed it was recorded with. --profile times every phase of every tick and writes the histograms out.
+ *    --batch hands the whole command line to the sweep runner (see batch.cpp).
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "headless.h"
+#include "game.h"
+#include "scheduler.h"
+#include "replay.h"
+#include "profiler.h"
+#include "batch.h"
+#include "bot.h"
+
+EInput RandomInput(Rng *pRng)
+{
+    switch (pRng->Below(8))
+    {
+        case 0:
+            return EInput_Left;
+        case 1:
+            return EInput_Right;
+        case 2:
+        case 3:
+            return EInput_Fire;
+        default:
+            return EInput_None;
+    }
+}
+
+int RunHeadless(int argc, char **argv)
+{
+    u32 iWidth = 80;
+    u32 iHeight = 24;
+    u64 iMaxTicks = 1000000;
+    u64 iSeed = 1;
+    const char *pScript = nullptr;
+    const char *pRecordPath = nullptr;
+    const char *pReplayPath = nullptr;
+    const char *pProfilePath = nullptr;
+    bool bBot = false;
+    BotParams xBotParams;
+
+    // Sweeps have a command line of their own.
+    for (int iIdx = 1; iIdx < argc; ++iIdx)
+    {
+        if (0 == strcmp(argv[iIdx], "--batch"))
+        {
+            return RunBatch(argc, argv);
+        }
+    }
+
+    for (int iIdx = 1; iIdx < argc; ++iIdx)
+    {
+        if (0 == strcmp(argv[iIdx], "--headless"))
+        {
+            // Already here.
+        }
+        else if (0 == strcmp(argv[iIdx], "--size") && (iIdx + 1) < argc)
+        {
+            if (2 != sscanf(argv[++iIdx], "%ux%u", &iWidth, &iHeight))
+            {
+                fprintf(stderr, "Board size must be given as WIDTHxHEIGHT!\n");
+                return -3;
+            }
+        }
+        else if (0 == strcmp(argv[iIdx], "--ticks") && (iIdx + 1) < argc)
+        {
+            iMaxTicks = strtoull(argv[++iIdx], nullptr, 10);
+        }
+        else if (0 == strcmp(argv[iIdx], "--seed") && (iIdx + 1) < argc)
+        {
+            iSeed = strtoull(argv[++iIdx], nullptr, 10);
+        }
+        else if (0 == strcmp(argv[iIdx], "--script") && (iIdx + 1) < argc)
+        {
+            pScript = argv[++iIdx];
+        }
+        else if (0 == strcmp(argv[iIdx], "--record") && (iIdx + 1) < argc)
+        {
+            pRecordPath = argv[++iIdx];
+        }
+        else if (0 == strcmp(argv[iIdx], "--replay") && (iIdx + 1) < argc)
+        {
+            pReplayPath = argv[++iIdx];
+        }
+        else if (0 == strcmp(argv[iIdx], "--profile") && (iIdx + 1) < argc)
+        {
+            pProfilePath = argv[++iIdx];
+        }
+        else if (0 == strcmp(argv[iIdx], "--bot"))
+        {
+            bBot = true;
+        }
+        else if (0 == strcmp(argv[iIdx], "--bot-beam") && (iIdx + 1) < argc)
+        {
+            xBotParams.miBeamWidth = atoi(argv[++iIdx]);
+        }
+        else if (0 == strcmp(argv[iIdx], "--bot-depth") && (iIdx + 1) < argc)
+        {
+            xBotParams.miDepth = atoi(argv[++iIdx]);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s --headless [--size WxH] [--ticks N] [--seed N] [--script KEYS | --bot"
+                    " [--bot-beam N] [--bot-depth N]] [--record FILE] | --replay FILE [--profile FILE] | --batch ...\n",
+                    argv[0]);
+            return -3;
+        }
+    }
+
+    // A replay brings its own board and seed, and runs for as long as it was recorded.
+    ReplayReader xReplay;
+
+    if (nullptr != pReplayPath)
+    {
+        if (EError_OK != ReplayOpen(&xReplay, pReplayPath))
+        {
+            fprintf(stderr, "Was unable to read the replay %s!\n", pReplayPath);
+            return -1;
+        }
+
+        iWidth = xReplay.miWidth;
+        iHeight = xReplay.miHeight;
+        iSeed = xReplay.miSeed;
+        iMaxTicks = ~0ULL;
+    }
+
+    GameObject xPlyr;
+    GameObject xScore;
+
+    if (EError_OK != InitGame(iWidth, iHeight, &xPlyr, &xScore))
+    {
+        fprintf(stderr, "Board must be between %ux%u and %ux%u!\n", c_iMinBoardWidth, c_iMinBoardHeight,
+                c_iMaxBoardWidth, c_iMaxBoardHeight);
+        return -1;
+    }
+
+    // The same seed always plays out the same games.
+    SeedGame(iSeed);
+
+    Rng xInputRng;
+    xInputRng.Seed(iSeed, ERngStream_Input);
+
+    Bot xBot;
+    BotInit(&xBot, xBotParams);
+
+    ReplayRecorder xRecorder;
+
+    if (nullptr != pRecordPath && EError_OK != RecordOpen(&xRecorder, pRecordPath, iWidth, iHeight, iSeed))
+    {
+        fprintf(stderr, "Was unable to create the recording %s!\n", pRecordPath);
+        ShutdownGame();
+        return -1;
+    }
+
+    // Timing costs more than a tick does here, so it's only on when asked for.
+    ProfileReset(nullptr != pProfilePath);
+
+    u32 iScriptLen = (nullptr == pScript) ? 0 : strlen(pScript);
+    u64 iGames = 0;
+    u64 iWins = 0;
+    u64 iTotalScore = 0;
+    u64 iTick = 0;
+    bool bWasDone = false;
+    EInput eInput = EInput_None;
+    u64 iStart = GetMonotonicNs();
+
+    if (nullptr != pReplayPath)
+    {
+        while (ReplayNext(&xReplay, 0, &eInput))
+        {
+            ApplyInput(eInput, &xPlyr, &xScore);
+        }
+    }
+    else
+    {
+        RecordInput(&xRecorder, 0, EInput_Start);
+        ApplyInput(EInput_Start, &xPlyr, &xScore);
+    }
+
+    for (; iTick < iMaxTicks && g_pWorld->mbRunning; ++iTick)
+    {
+        if (nullptr != pReplayPath && ReplayFinished(&xReplay, iTick))
+        {
+            break;
+        }
+
+        if (EError_OK != StepGame(&xPlyr, &xScore))
+        {
+            fprintf(stderr, "An unknown error occurred! ABORTING!\n");
+            break;
+        }
+
+        if (g_xProfiler.mbEnabled)
+        {
+            ProfileFlush();
+        }
+
+        // Inputs are applied after the step, so they land on the tick after it.
+        u64 iInputTick = iTick + 1;
+
+        // Tally each game once, when it ends.
+        bool bDone = g_pWorld->mbGameOver || g_pWorld->mbWin;
+        if (bDone && !bWasDone)
+        {
+            ++iGames;
+            iWins += g_pWorld->mbWin ? 1 : 0;
+            iTotalScore += xScore.miValue;
+        }
+
+        bWasDone = bDone;
+
+        if (nullptr != pReplayPath)
+        {
+            while (ReplayNext(&xReplay, iInputTick, &eInput))
+            {
+                ApplyInput(eInput, &xPlyr, &xScore);
+            }
+
+            continue;
+        }
+
+        if (bDone)
+        {
+            // Go straight into the next game.
+            RecordInput(&xRecorder, iInputTick, EInput_Back);
+            ApplyInput(EInput_Back, &xPlyr, &xScore);
+            RecordInput(&xRecorder, iInputTick, EInput_Start);
+            ApplyInput(EInput_Start, &xPlyr, &xScore);
+            bWasDone = false;
+            continue;
+        }
+
+        if (bBot)
+        {
+            eInput = BotChoose(&xBot, &xPlyr, &xScore);
+        }
+        else
+        {
+            eInput = (0 == iScriptLen) ? RandomInput(&xInputRng) : CharToInput(pScript[iTick % iScriptLen]);
+        }
+
+        RecordInput(&xRecorder, iInputTick, eInput);
+        ApplyInput(eInput, &xPlyr, &xScore);
+    }
+
+    u64 iElapsed = GetMonotonicNs() - iStart;
+    double nSeconds = iElapsed / 1000000000.0;
+
+    printf("Board: %ux%u    Seed: %llu    Ticks: %llu    Time: %.3fs    Ticks/s: %.0f\n", iWidth, iHeight, iSeed, iTick,
+           nSeconds, (0 == iElapsed) ? 0.0 : (iTick / nSeconds));
+    printf("Games: %llu    Wins: %llu    Mean score: %.1f\n", iGames, iWins,
+           (0 == iGames) ? 0.0 : (static_cast<double>(iTotalScore) / iGames));
+
+    if (bBot)
+    {
+        BotReport(&xBot, stdout);
+    }
+
+    if (nullptr != pProfilePath && EError_OK != ProfileDump(pProfilePath))
+    {
+        fprintf(stderr, "Was unable to write the tick timings to %s!\n", pProfilePath);
+    }
+
+    if (nullptr != pRecordPath)
+    {
+        u64 iInputs = xRecorder.miInputs;
+
+        if (EError_OK != RecordClose(&xRecorder, iTick, xScore.miValue))
+        {
+            fprintf(stderr, "Was unable to write the recording %s!\n", pRecordPath);
+        }
+        else
+        {
+            printf("Recorded: %llu inputs over %llu ticks to %s\n", iInputs, iTick, pRecordPath);
+        }
+    }
+    else if (nullptr != pReplayPath)
+    {
+        // A replay that doesn't end on the recorded score has gone off script somewhere.
+        printf("Replay: %s    Final score: %u    Recorded: %u\n",
+               (xReplay.miFinalScore == xScore.miValue) ? "matched" : "DIVERGED", xScore.miValue, xReplay.miFinalScore);
+    }
+
+    ShutdownGame();
+
+    return 0;
+}
@@ -0,0 +1,18 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    Headless runner. Steps the simulation as fast as the CPU allows on a virtual board, with no terminal at all, and
+ *    reports how many ticks per second it managed.
+ */
+#ifndef SHELL_INVADERS_HEADLESS_H
+#define SHELL_INVADERS_HEADLESS_H
+
+#include "game.h"
+
+EInput RandomInput(Rng *pRng); //!< Picks the input for a tick when no script was given.
+int RunHeadless(int argc, char **argv); //!< Runs headless games as described by the command line, returns the exit code.
+
+#endif // SHELL_INVADERS_HEADLESS_H
@@ -0,0 +1,14 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    Entry point for the headless build, which doesn't link against NCurses at all.
+ */
+#include "headless.h"
+
+int main(int argc, char **argv)
+{
+    return RunHeadless(argc, argv);
+}
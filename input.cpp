@@ -0,0 +1,333 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ */
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+
+// Linux specific headers.
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include "input.h"
+#include "scheduler.h"
+
+// Hands a key to the game. Only the reader thread calls this.
+static void Push(InputReader *pReader, EInput aeInput, u64 aiArrivalNs)
+{
+    if (EInput_None == aeInput)
+    {
+        return;
+    }
+
+    u32 iHead = pReader->miHead.load(std::memory_order_relaxed);
+    u32 iTail = pReader->miTail.load(std::memory_order_acquire);
+
+    // The game takes everything every tick, so the ring only fills up if it has stopped taking.
+    if (c_iInputRingSize <= (iHead - iTail))
+    {
+        pReader->miDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    InputEvent *pEvent = &pReader->mvRing[iHead & (c_iInputRingSize - 1)];
+    pEvent->meInput = aeInput;
+    pEvent->miArrivalNs = aiArrivalNs;
+
+    pReader->miHead.store(iHead + 1, std::memory_order_release);
+}
+
+// Turns the whole keys at the front of the buffer into input and returns how many bytes that used. Anything left over
+// might be the start of an escape sequence, unless abFlush says no more is coming.
+static size_t DecodeKeys(InputReader *pReader, const byte *pBytes, size_t aiLen, u64 aiArrivalNs, bool abFlush)
+{
+    size_t iPos = 0;
+
+    while (iPos < aiLen)
+    {
+        if (27 != pBytes[iPos])
+        {
+            Push(pReader, CharToInput(pBytes[iPos]), aiArrivalNs);
+            ++iPos;
+            continue;
+        }
+
+        // An ESC on its own is the key, followed by '[' or 'O' it's an arrow key (or some other key we don't use).
+        if ((iPos + 1) >= aiLen && !abFlush)
+        {
+            break;
+        }
+
+        if ((iPos + 1) >= aiLen || ('[' != pBytes[iPos + 1] && 'O' != pBytes[iPos + 1]))
+        {
+            Push(pReader, EInput_Back, aiArrivalNs);
+            ++iPos;
+            continue;
+        }
+
+        // Skip the parameters to get to the final byte.
+        size_t iEnd = iPos + 2;
+
+        while (iEnd < aiLen && 0x20 <= pBytes[iEnd] && 0x40 > pBytes[iEnd])
+        {
+            ++iEnd;
+        }
+
+        if (iEnd >= aiLen)
+        {
+            if (!abFlush)
+            {
+                break;
+            }
+
+            // It was never finished, so it can't have been anything we know.
+            iPos = aiLen;
+            continue;
+        }
+
+        if ('D' == pBytes[iEnd])
+        {
+            Push(pReader, EInput_Left, aiArrivalNs);
+        }
+        else if ('C' == pBytes[iEnd])
+        {
+            Push(pReader, EInput_Right, aiArrivalNs);
+        }
+
+        iPos = iEnd + 1;
+    }
+
+    return iPos;
+}
+
+// Lets a game sleeping in poll() know there are keys to take. The pipe is never emptied while the game is running, so
+// it's non-blocking and a full one just means the game will see the keys anyway.
+static void Signal(InputReader *pReader)
+{
+    byte cReady = 0;
+    while (0 > write(pReader->mvReadyPipe[1], &cReady, 1) && EINTR == errno)
+    {
+        // Interrupted by a signal, try again.
+    }
+}
+
+static void ReadLoop(InputReader *pReader)
+{
+    std::vector<byte> vPending;
+    u64 iPendingNs = 0;
+
+    for (;;)
+    {
+        struct pollfd vPoll[2] = { { pReader->miFd, POLLIN, 0 }, { pReader->mvWakePipe[0], POLLIN, 0 } };
+
+        // An escape sequence that's been started only gets so long to finish.
+        int iReady = poll(vPoll, 2, vPending.empty() ? -1 : c_iEscapeWaitMs);
+
+        if (0 > iReady && EINTR == errno)
+        {
+            continue;
+        }
+
+        if (0 > iReady || 0 != vPoll[1].revents)
+        {
+            break;
+        }
+
+        if (0 == iReady)
+        {
+            DecodeKeys(pReader, vPending.data(), vPending.size(), iPendingNs, true);
+            vPending.clear();
+            Signal(pReader);
+            continue;
+        }
+
+        byte cBuf[256];
+        ssize_t iRead = read(pReader->miFd, cBuf, sizeof(cBuf));
+        u64 iNow = GetMonotonicNs();
+
+        if (0 > iRead && (EINTR == errno || EAGAIN == errno))
+        {
+            continue;
+        }
+
+        if (0 >= iRead)
+        {
+            // The terminal's gone.
+            break;
+        }
+
+        // Keys are stamped with when their first byte turned up.
+        iPendingNs = vPending.empty() ? iNow : iPendingNs;
+        vPending.insert(vPending.end(), cBuf, cBuf + iRead);
+
+        size_t iUsed = DecodeKeys(pReader, vPending.data(), vPending.size(), iPendingNs, false);
+        vPending.erase(vPending.begin(), vPending.begin() + iUsed);
+
+        iPendingNs = (0 < iUsed) ? iNow : iPendingNs;
+
+        if (0 < iUsed)
+        {
+            Signal(pReader);
+        }
+    }
+}
+
+EError InputStart(InputReader *pReader, int aiFd)
+{
+    if (nullptr == pReader || 0 > aiFd)
+    {
+        return EError_InvalidArg;
+    }
+
+    if (0 != pipe(pReader->mvWakePipe))
+    {
+        return EError_Unknown;
+    }
+
+    if (0 != pipe2(pReader->mvReadyPipe, O_NONBLOCK | O_CLOEXEC))
+    {
+        close(pReader->mvWakePipe[0]);
+        close(pReader->mvWakePipe[1]);
+        pReader->mvWakePipe[0] = -1;
+        pReader->mvWakePipe[1] = -1;
+        return EError_Unknown;
+    }
+
+    pReader->miFd = aiFd;
+    pReader->mxThread = std::thread(ReadLoop, pReader);
+
+    return EError_OK;
+}
+
+// Moves and shots that have come in since the last key that can't be folded into them.
+struct FoldedKeys
+{
+    int miNetMove; //!< Rights less lefts.
+    u64 miMoveNs; //!< Arrival of the first of the moves.
+    bool mbFire;
+    u64 miFireNs; //!< Arrival of the first of the shots.
+};
+
+// Hands over what's been folded so far: the moves that didn't cancel out, then the shot, so it leaves from where the
+// player ended up.
+static void FlushFolded(FoldedKeys *pFolded, InputEvent *pOut, u32 aiMax, u32 *pCount)
+{
+    for (int iIdx = 0; iIdx < abs(pFolded->miNetMove) && *pCount < aiMax; ++iIdx)
+    {
+        pOut[*pCount].meInput = (0 > pFolded->miNetMove) ? EInput_Left : EInput_Right;
+        pOut[*pCount].miArrivalNs = pFolded->miMoveNs;
+        ++(*pCount);
+    }
+
+    if (pFolded->mbFire && *pCount < aiMax)
+    {
+        pOut[*pCount].meInput = EInput_Fire;
+        pOut[*pCount].miArrivalNs = pFolded->miFireNs;
+        ++(*pCount);
+    }
+
+    memset(pFolded, 0, sizeof(FoldedKeys));
+}
+
+// Only runs of moves and shots are folded. Any other key first flushes the run before it, so nothing gets applied out
+// of the order it was typed in.
+u32 InputTake(InputReader *pReader, InputEvent *pOut, u32 aiMax)
+{
+    u32 iTail = pReader->miTail.load(std::memory_order_relaxed);
+    u32 iHead = pReader->miHead.load(std::memory_order_acquire);
+    u32 iCount = 0;
+    FoldedKeys xFolded;
+    memset(&xFolded, 0, sizeof(xFolded));
+
+    for (; iTail != iHead; ++iTail)
+    {
+        const InputEvent &xEvent = pReader->mvRing[iTail & (c_iInputRingSize - 1)];
+        ++pReader->miTaken;
+
+        switch (xEvent.meInput)
+        {
+            case EInput_Left:
+            case EInput_Right:
+            {
+                xFolded.miNetMove += (EInput_Left == xEvent.meInput) ? -1 : 1;
+                xFolded.miMoveNs = (0 == xFolded.miMoveNs) ? xEvent.miArrivalNs : xFolded.miMoveNs;
+                break;
+            }
+
+            case EInput_Fire:
+            {
+                // The cooldown would only throw away every shot after the first anyway.
+                xFolded.miFireNs = xFolded.mbFire ? xFolded.miFireNs : xEvent.miArrivalNs;
+                xFolded.mbFire = true;
+                break;
+            }
+
+            default:
+            {
+                FlushFolded(&xFolded, pOut, aiMax, &iCount);
+
+                if (iCount < aiMax)
+                {
+                    pOut[iCount++] = xEvent;
+                }
+
+                break;
+            }
+        }
+    }
+
+    pReader->miTail.store(iTail, std::memory_order_release);
+
+    FlushFolded(&xFolded, pOut, aiMax, &iCount);
+
+    pReader->miApplied += iCount;
+    return iCount;
+}
+
+bool InputPending(InputReader *pReader)
+{
+    // Emptied first, so a key that comes in after the check below still leaves the pipe readable.
+    byte cBuf[64];
+    while (0 < read(pReader->mvReadyPipe[0], cBuf, sizeof(cBuf)))
+    {
+        // Keep going till it's empty.
+    }
+
+    return pReader->miTail.load(std::memory_order_relaxed) != pReader->miHead.load(std::memory_order_acquire);
+}
+
+void InputStop(InputReader *pReader)
+{
+    if (!pReader->mxThread.joinable())
+    {
+        return;
+    }
+
+    byte cWake = 0;
+    while (0 > write(pReader->mvWakePipe[1], &cWake, 1) && EINTR == errno)
+    {
+        // Interrupted by a signal, try again.
+    }
+
+    pReader->mxThread.join();
+
+    close(pReader->mvWakePipe[0]);
+    close(pReader->mvWakePipe[1]);
+    pReader->mvWakePipe[0] = -1;
+    pReader->mvWakePipe[1] = -1;
+
+    close(pReader->mvReadyPipe[0]);
+    close(pReader->mvReadyPipe[1]);
+    pReader->mvReadyPipe[0] = -1;
+    pReader->mvReadyPipe[1] = -1;
+}
+
+void InputReport(const InputReader *pReader, FILE *pOut)
+{
+    fprintf(pOut, "Keys: %llu    Applied after coalescing: %llu    Dropped: %llu\n", pReader->miTaken,
+            pReader->miApplied, static_cast<u64>(pReader->miDropped.load()));
+}
@@ -0,0 +1,62 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    Keyboard input for the terminal front-end. A reader thread sits in poll() on the terminal, decodes keys the moment
+ *    they arrive, stamps each with its arrival time and hands it over through a lock-free ring. Every tick the game
+ *    takes everything that's queued at once, with each run of moves netted out and its shots folded into one, so keys
+ *    coming in faster than the tick rate never build up a backlog. Any other key ends a run and keeps its place in
+ *    the order. The game can also sleep until a key turns up by polling mvReadyPipe.
+ */
+#ifndef SHELL_INVADERS_INPUT_H
+#define SHELL_INVADERS_INPUT_H
+
+#include <cstdio>
+#include <atomic>
+#include <thread>
+
+#include "game.h"
+
+// Room for this many keys between two ticks, must be a power of two.
+const u32 c_iInputRingSize = 256;
+
+// How long a lone ESC waits for the rest of an arrow key before it counts as ESC on its own.
+const int c_iEscapeWaitMs = 25;
+
+struct InputEvent
+{
+    EInput meInput;
+    u64 miArrivalNs; //!< CLOCK_MONOTONIC time the key was read off the terminal.
+};
+
+struct InputReader
+{
+    int miFd; //!< Terminal the keys are read from.
+    int mvWakePipe[2]; //!< Written to when the reader thread should stop.
+    int mvReadyPipe[2]; //!< Written to whenever keys are queued, so the game can wait on it in poll().
+    std::thread mxThread;
+    InputEvent mvRing[c_iInputRingSize];
+    std::atomic<u32> miHead; //!< Next slot the reader thread fills, only it writes this.
+    std::atomic<u32> miTail; //!< Next slot the game takes, only the game writes this.
+    std::atomic<u64> miDropped; //!< Keys thrown away because the ring was full.
+    u64 miTaken; //!< Keys taken off the ring by the game.
+    u64 miApplied; //!< Inputs handed to the game after coalescing.
+
+    InputReader() : miFd(-1), miHead(0), miTail(0), miDropped(0), miTaken(0), miApplied(0)
+    {
+        mvWakePipe[0] = -1;
+        mvWakePipe[1] = -1;
+        mvReadyPipe[0] = -1;
+        mvReadyPipe[1] = -1;
+    }
+};
+
+EError InputStart(InputReader *pReader, int aiFd); //!< Starts reading keys from a terminal in raw mode.
+u32 InputTake(InputReader *pReader, InputEvent *pOut, u32 aiMax); //!< Takes every queued key, coalesced, in order.
+bool InputPending(InputReader *pReader); //!< Whether keys are queued, empties mvReadyPipe for the next wait.
+void InputStop(InputReader *pReader); //!< Stops the reader thread.
+void InputReport(const InputReader *pReader, FILE *pOut);
+
+#endif // SHELL_INVADERS_INPUT_H
@@ -22,6 +22,18 @@
  *        D               Move Right
  *        W               Shoot bullet
  *        ESC             Quit Game
+ *        P               Show/hide frame timings on the score line
+ *        R               Rewind a second
+ *
+ *    Pass --headless to step the game without a terminal (see headless.cpp), and --renderer ansi to draw without
+ *    NCurses (see ansi_renderer.cpp). --palette mono|8|256 overrides the colors worked out from the terminal (see
+ *    palette.h). --record and --replay log and play back every input (see replay.h). Keys are read off the terminal
+ *    by a thread of their own (see input.h), never through NCurses. --bot lets the autoplayer play (see bot.h).
+ *    --spectate PATH streams the game to anyone running --watch PATH (see spectate.h). --arena WxH plays on a board
+ *    bigger than the terminal, which shows the part of it around the player (see Viewport). The last --rewind seconds
+ *    are kept as snapshots to rewind through, --crash-dump FILE writes the latest one out if the game crashes and
+ *    --resume FILE carries on from one (see snapshot.h). The menu, game over and win screens are drawn once and then
+ *    the game sleeps in poll() until a key, a resize or a spectator turns up (see IdleWait()).
  *
  * Game Layout:
  *     Every game object, has a center, this center is where the position of the entity is drawn from. The game board coordinates are identical to those in use by the terminal (top-left == origin).
@@ -31,790 +43,1293 @@
 #include <cstdlib>
 #include <cassert>
 #include <cstring>
-#include <ctime>
-#include <cmath>
-#include <vector>
-#include <list>
+#include <cstdarg>
+#include <cerrno>
+#include <algorithm>
 
 // Linux specific headers.
 #include <sys/ioctl.h>
 #include <unistd.h>
 #include <termios.h>
 #include <sys/select.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
 #include <ncurses.h>
 
-// Custom datatypes used by the game for generic type usage.
-typedef unsigned char byte;
-typedef unsigned short u16;
-typedef unsigned int u32;
-typedef unsigned long long u64;
-typedef float real; //!< Here we use the Mathematical term "real" instead of "number" to help prevent confusion.
-
-// This data structure is used to for the various objects in the game.
-struct GameObject
-{
-    real miXPos; //!< X-Position (column) of the object's center character.
-    real miYPos; //!< Y-Position (row) of the object's center character.
-    const char* msCharStr; //!< The actual string that represents the object.
-    u32 miValue; //!< Point value assigned to this entity.
-
-    GameObject() : miXPos(0), miYPos(0), msCharStr(nullptr), miValue(0) {}
-};
-
-// Errors that are thrown during runtime.
-enum EError
+#include "game.h"
+#include "headless.h"
+#include "scheduler.h"
+#include "framebuffer.h"
+#include "ansi_renderer.h"
+#include "replay.h"
+#include "profiler.h"
+#include "input.h"
+#include "scores.h"
+#include "bot.h"
+#include "spectate.h"
+#include "snapshot.h"
+
+// Ways of getting a frame onto the terminal.
+enum ERenderer
 {
-    EError_OK, //!< No error occurred.
-    EError_Unknown, //!< An unknown error occurred.
-    EError_SegFault, //!< A segmentation fault (read-access violation) occurred.
-    EError_MemCorrupt, //!< Memory corruption (write-access violation) occurred.
-    EError_AssertPop, //!< A psuedo-assert popped (non-terminating assert).
-    EError_InvalidArg //!< An invalid argument was passed.
+    ERenderer_NCurses, //!< NCurses windows, redrawing only what's dirty.
+    ERenderer_Ansi //!< Our own cell buffers and escape codes.
 };
 
 // Function prototyping.
-EError MoveHorde(); //!< This moves the horde of enemies.
-EError DrawHorde(); //!< This draws the horde of enemies.
-EError DrawPlayer(GameObject *pPlayer); //!< This draws the player, bullets, and barriers
-EError DrawAll(GameObject *pPlayer, GameObject *pScore); //!< This draws all objects.
-EError GetKeyPress(GameObject *pPlayer);
-EError CreateBoard(GameObject *pPlyr);
-bool CheckEnemyCollision(GameObject *pBullet, GameObject* apScore);
-bool CheckBarrierCollision(GameObject *pBullet);
-u32 GetScoreXPosition(u32 aiXTermWidth, const char* apStr);
+WINDOW* WindowAt(int aiY, int *pLocalY); //!< Finds the window a board row lives in, and the row within it.
+template <typename TPalette>
+chtype ColorAttr(EColor aeColor); //!< What a color class is drawn with, in NCurses.
+template <typename TPalette>
+void PutStr(int aiY, int aiX, EColor aeColor, const char *pFmt, ...); //!< Prints at a board position.
+template <typename TPalette>
+void PutChar(int aiY, int aiX, EColor aeColor, char acChar); //!< Puts one character at a board position.
+template <typename TPalette>
+void PutSprite(int aiY, int aiX, ESprite aeSprite, EColor aeColor); //!< Puts a sprite centered on a board position.
+template <typename TPalette>
+EError DrawHorde(int aiY, int aiLeft, int aiRight); //!< This draws the enemies of the horde that fall on part of a row.
+template <typename TPalette>
+EError DrawPlayer(GameObject *pPlayer); //!< This draws the player.
+template <typename TPalette>
+EError DrawRow(GameObject *pPlayer, int aiY, int aiLeft, int aiRight); //!< Draws everything but bullets on part of a row.
+template <typename TPalette>
+EError DrawBullets(bool abDirtyOnly); //!< Draws the bullets, or just the ones sitting in dirty cells.
+template <typename TPalette>
+EError DrawHud(GameObject *pScore); //!< Draws the score line.
+int FormatHud(char *pBuf, u32 aiSize, const GameObject *pScore); //!< The score line, with the timing overlay if it's on.
+template <typename TPalette>
+EError DrawAll(GameObject *pPlayer, GameObject *pScore); //!< Draws whatever changed since the last frame.
+template <typename TPalette>
+void UseCursesPalette(); //!< Sets up NCurses' color pairs and the drawing for a palette.
+EError PresentFrame(); //!< Pushes the frame out to the terminal.
+EError GetKeyPress(GameObject *pPlayer, GameObject *pScore); //!< Applies this tick's input, from the keyboard or a replay.
+bool ParseCount(const char *pArg, u32 aiMin, u32 aiMax, u32 *pOut); //!< Reads a whole number within the bounds.
+bool ReadWriteCounters(u64 *pBytes, u64 *pWrites); //!< What the kernel has seen this thread write() so far.
 void ResetTerminalMode();
 void SetTerminalMode();
-void DelayExec(u64 iMilliseconds);
-EError SaveScore(u32 aiScore);
-u32 GetScore();
+void OnCrash(int aiSignal); //!< Writes the crash dump and puts the terminal back, then lets the crash go on.
+void OnResize(int aiSignal); //!< Flags the terminal for a repaint.
+bool CanIdle(u64 aiTickNs, u64 *pTimeoutNs); //!< Whether nothing can change on screen without a key, see IdleWait().
+bool IdleWait(u64 aiTimeoutNs); //!< Sleeps till there's something to act on, returns true if it timed out.
+EError SaveScore(u32 aiScore); //!< Hands a finished game's score to the leaderboard.
+u32 GetScore(); //!< Reads the single score file kept before the leaderboard.
+template <typename TPalette>
 EError DrawIntro();
+template <typename TPalette>
+EError DrawBanner(const char *pStr, EColor aeColor); //!< Draws a message in the middle of the screen.
 
 // Global objects.
-GameObject g_xTerm;
-GameObject *g_pUFO;
 struct termios g_sOrigTermios;
-bool g_bUpdateChar = true;
-bool g_bRunning = true;
-bool g_bHordeMoveRight = false;
-bool g_bUFOActive = false;
-bool g_bHasColors = true;
-bool g_bGameOver = false;
-bool g_bWin = false;
-bool g_bMoveDown = false;
 bool g_bScoreSaved = false;
-bool g_bIsIntro = true;
-std::vector<GameObject*> g_vBullets;
-std::vector<GameObject*> g_vBarriers;
-std::vector<GameObject*> g_vHorde;
-u32 g_iHordeMoveTimer = 0;
-u32 g_iUFOMoveTimer = 0;
-u32 g_iFireCooldown = 0;
-u32 g_iHiScore = 0;
-u32 g_iLives = 3;
-real g_nHordeReset = 30;
-
-int main(void)
+EError (*g_pDrawAll)(GameObject*, GameObject*) = nullptr; //!< DrawAll for the palette picked at startup.
+
+// The screen is split into the UFO lane, the playfield and the score line, so each gets refreshed on its own.
+const int c_iLaneRows = 2;
+WINDOW *g_pLaneWin = nullptr;
+WINDOW *g_pFieldWin = nullptr;
+WINDOW *g_pHudWin = nullptr;
+
+ERenderer g_eRenderer = ERenderer_NCurses;
+AnsiRenderer g_xAnsi;
+OutputStats g_xCursesStats; //!< NCurses writes to the terminal itself, so this is measured around each update.
+
+u64 g_iSimTick = 0; //!< Simulation ticks run so far.
+ReplayRecorder g_xRecorder;
+ReplayReader g_xReplay;
+bool g_bReplaying = false;
+bool g_bShowOverlay = false; //!< Frame timings are shown on the score line.
+InputReader g_xInput;
+ScoreStore g_xScores;
+Bot g_xBot;
+bool g_bBotPlaying = false; //!< The bot plays every game, see GetKeyPress().
+u32 g_iBotRestartTicks = 0; //!< Ticks the bot leaves a finished game on screen before starting the next one.
+u32 g_iBotWaited = 0;
+SpectatorServer g_xSpectators;
+FrameBuffer g_xSpectateFrame; //!< NCurses keeps no frame of its own, so spectators get one composed for them.
+RewindRing g_xRewind;
+bool g_bRewound = false; //!< The game on now has been rewound, so its score doesn't go on the leaderboard.
+CrashDump g_xCrashDump;
+volatile sig_atomic_t g_bResized = 0; //!< The terminal's been resized since it was last repainted.
+
+int main(int argc, char **argv)
 {
-    // Clear the xterm.
-    fprintf(stdout, "\e[H\e[J");
+    // The headless runner has its own command line.
+    for (int iIdx = 1; iIdx < argc; ++iIdx)
+    {
+        if (0 == strcmp(argv[iIdx], "--headless"))
+        {
+            return RunHeadless(argc, argv);
+        }
+    }
 
-    // Set the cursor to be invisible!
-    fprintf(stdout, "\e[?25l");
+    // Parse the command line.
+    u32 iTickRate = 60;
+    u32 iRenderRate = 0;
+    u32 iMaxCatchUp = 5;
+    u64 iSeed = GetMonotonicNs();
+    EPalette ePalette = EPalette_8;
+    bool bPaletteSet = false;
+    const char *pRecordPath = nullptr;
+    const char *pScoresPath = "scores.log";
+    const char *pReplayPath = nullptr;
+    const char *pProfilePath = "profile.log";
+    const char *pSpectatePath = nullptr;
+    const char *pWatchPath = nullptr;
+    u32 iArenaWidth = 0;
+    u32 iArenaHeight = 0;
+    u32 iRewindSeconds = 10;
+    const char *pResumePath = nullptr;
+
+    for (int iIdx = 1; iIdx < argc; ++iIdx)
+    {
+        if (0 == strcmp(argv[iIdx], "--tick-rate") && (iIdx + 1) < argc &&
+            ParseCount(argv[iIdx + 1], 1, c_iMaxRate, &iTickRate))
+        {
+            ++iIdx;
+        }
+        else if (0 == strcmp(argv[iIdx], "--render-rate") && (iIdx + 1) < argc &&
+                 ParseCount(argv[iIdx + 1], 1, c_iMaxRate, &iRenderRate))
+        {
+            ++iIdx;
+        }
+        else if (0 == strcmp(argv[iIdx], "--catch-up") && (iIdx + 1) < argc &&
+                 ParseCount(argv[iIdx + 1], 0, ~0U, &iMaxCatchUp))
+        {
+            ++iIdx;
+        }
+        else if (0 == strcmp(argv[iIdx], "--seed") && (iIdx + 1) < argc)
+        {
+            iSeed = strtoull(argv[++iIdx], nullptr, 10);
+        }
+        else if (0 == strcmp(argv[iIdx], "--record") && (iIdx + 1) < argc)
+        {
+            pRecordPath = argv[++iIdx];
+        }
+        else if (0 == strcmp(argv[iIdx], "--replay") && (iIdx + 1) < argc)
+        {
+            pReplayPath = argv[++iIdx];
+        }
+        else if (0 == strcmp(argv[iIdx], "--profile") && (iIdx + 1) < argc)
+        {
+            pProfilePath = argv[++iIdx];
+        }
+        else if (0 == strcmp(argv[iIdx], "--scores") && (iIdx + 1) < argc)
+        {
+            pScoresPath = argv[++iIdx];
+        }
+        else if (0 == strcmp(argv[iIdx], "--bot"))
+        {
+            g_bBotPlaying = true;
+        }
+        else if (0 == strcmp(argv[iIdx], "--spectate") && (iIdx + 1) < argc)
+        {
+            pSpectatePath = argv[++iIdx];
+        }
+        else if (0 == strcmp(argv[iIdx], "--watch") && (iIdx + 1) < argc)
+        {
+            pWatchPath = argv[++iIdx];
+        }
+        else if (0 == strcmp(argv[iIdx], "--arena") && (iIdx + 1) < argc &&
+                 2 == sscanf(argv[iIdx + 1], "%ux%u", &iArenaWidth, &iArenaHeight))
+        {
+            ++iIdx;
+        }
+        else if (0 == strcmp(argv[iIdx], "--rewind") && (iIdx + 1) < argc)
+        {
+            iRewindSeconds = atoi(argv[++iIdx]);
+        }
+        else if (0 == strcmp(argv[iIdx], "--crash-dump") && (iIdx + 1) < argc)
+        {
+            g_xCrashDump.msPath = argv[++iIdx];
+        }
+        else if (0 == strcmp(argv[iIdx], "--resume") && (iIdx + 1) < argc)
+        {
+            pResumePath = argv[++iIdx];
+        }
+        else if (0 == strcmp(argv[iIdx], "--renderer") && (iIdx + 1) < argc && 0 == strcmp(argv[iIdx + 1], "ncurses"))
+        {
+            g_eRenderer = ERenderer_NCurses;
+            ++iIdx;
+        }
+        else if (0 == strcmp(argv[iIdx], "--renderer") && (iIdx + 1) < argc && 0 == strcmp(argv[iIdx + 1], "ansi"))
+        {
+            g_eRenderer = ERenderer_Ansi;
+            ++iIdx;
+        }
+        else if (0 == strcmp(argv[iIdx], "--palette") && (iIdx + 1) < argc &&
+                 PaletteFromName(argv[iIdx + 1], &ePalette))
+        {
+            bPaletteSet = true;
+            ++iIdx;
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--tick-rate HZ] [--render-rate HZ] [--catch-up TICKS] [--seed N]"
+                    " [--renderer ncurses|ansi] [--palette mono|8|256] [--record FILE | --replay FILE]"
+                    " [--profile FILE] [--scores FILE] [--bot] [--spectate SOCKET] [--arena WxH] [--rewind SECONDS]"
+                    " [--crash-dump FILE] [--resume FILE] | --watch SOCKET | --headless ...\n", argv[0]);
+            return -3;
+        }
+    }
+
+    // Watching draws someone else's game, there's no board of our own.
+    if (nullptr != pWatchPath)
+    {
+        return RunWatch(pWatchPath, bPaletteSet ? ePalette : PaletteFromEnv());
+    }
 
     // Get the window size in rows and columns.
     struct winsize wSize;
     ioctl(STDOUT_FILENO, TIOCGWINSZ, &wSize);
 
-    if (0 != wSize.ws_col && 0 != wSize.ws_row)
-    {
-        g_xTerm.miXPos = wSize.ws_col;
-        g_xTerm.miYPos = wSize.ws_row;
-    }
-    else
+    if (0 == wSize.ws_col || 0 == wSize.ws_row)
     {
         fprintf(stderr, "Was unable to get xTerm size!\n");
         return -1;
     }
 
-    // Set the terminal mode.
-    SetTerminalMode();
+    // The board is the terminal, unless there's an arena to play in.
+    u32 iWidth = (0 == iArenaWidth) ? wSize.ws_col : iArenaWidth;
+    u32 iHeight = (0 == iArenaHeight) ? wSize.ws_row : iArenaHeight;
 
-    GameObject *pPlyr = new GameObject();
-    pPlyr->miXPos = (g_xTerm.miXPos / 2) - 1;
-    pPlyr->miYPos = g_xTerm.miYPos * 0.875;
-    pPlyr->msCharStr = "<^>";
+    // A replay is played on the board and with the seed it was recorded with, the view takes care of the terminal.
+    if (nullptr != pReplayPath)
+    {
+        if (EError_OK != ReplayOpen(&g_xReplay, pReplayPath))
+        {
+            fprintf(stderr, "Was unable to read the replay %s!\n", pReplayPath);
+            return -1;
+        }
+
+        g_bReplaying = true;
+        iWidth = g_xReplay.miWidth;
+        iHeight = g_xReplay.miHeight;
+        iSeed = g_xReplay.miSeed;
+    }
+
+    // A resumed game carries on on the board it was saved from. Logs start from a new game, so it can't be in one.
+    std::vector<byte> vResume;
 
+    if (nullptr != pResumePath)
+    {
+        if (nullptr != pRecordPath || nullptr != pReplayPath)
+        {
+            fprintf(stderr, "A resumed game can't be recorded or replayed!\n");
+            return -3;
+        }
+
+        if (EError_OK != SnapshotRead(&vResume, pResumePath) || !SnapshotBoardSize(vResume, &iWidth, &iHeight))
+        {
+            fprintf(stderr, "Was unable to read the snapshot %s!\n", pResumePath);
+            return -1;
+        }
+    }
+
+    GameObject *pPlyr = new GameObject();
     GameObject *pScore = new GameObject();
-    pScore->miXPos = GetScoreXPosition(g_xTerm.miXPos, "Score: %ld    Hi-Score: %ld    Lives: %d");
-    pScore->miYPos = g_xTerm.miYPos - 1;
-    pScore->msCharStr = "Score: %ld    Hi-Score: %ld    Lives: %d";
-
-    // Lastly, allocate the UFO.
-    g_pUFO = new GameObject();
-    g_pUFO->miXPos = g_xTerm.miXPos - 2;
-    g_pUFO->miYPos = 1;
-    g_pUFO->miValue = 200;
-    g_pUFO->msCharStr = "<~~~>";
-
-    if (NULL == pPlyr)
+
+    if (EError_OK != InitGame(iWidth, iHeight, pPlyr, pScore))
     {
-        // Print an error.
-        fprintf(stderr, "Was unable to allocate player!\n");
+        fprintf(stderr, "The board must be between %ux%u and %ux%u!\n", c_iMinBoardWidth, c_iMinBoardHeight,
+                c_iMaxBoardWidth, c_iMaxBoardHeight);
+        delete pScore;
+        delete pPlyr;
         return -2;
     }
 
-    // Now we need to initialize NCURSES.
-    initscr();
-    raw();
-    noecho();
-    nonl();
-    keypad(stdscr, true);
-    nodelay(stdscr, true);
+    // The screen shows as much of the board as fits.
+    if (c_iMinBoardWidth > wSize.ws_col || c_iMinBoardHeight > wSize.ws_row)
+    {
+        fprintf(stderr, "The terminal must be at least %ux%u!\n", c_iMinBoardWidth, c_iMinBoardHeight);
+        ShutdownGame();
+        delete pScore;
+        delete pPlyr;
+        return -2;
+    }
+
+    SetViewport(wSize.ws_col, wSize.ws_row);
+    FollowPlayer(pPlyr);
 
-    g_bHasColors = has_colors();
-    g_bGameOver = false;
-    g_iHiScore = GetScore();
+    SeedGame(iSeed);
 
-    if (g_bHasColors)
+    if (nullptr != pResumePath)
     {
-        start_color();
-        init_pair(1, COLOR_RED, COLOR_BLACK);
-        init_pair(2, COLOR_GREEN, COLOR_BLACK);
-        init_pair(3, COLOR_YELLOW, COLOR_BLACK);
-        init_pair(4, COLOR_WHITE, COLOR_BLACK);
+        if (EError_OK != SnapshotRestore(vResume, pPlyr, pScore, &g_iSimTick))
+        {
+            fprintf(stderr, "The snapshot %s is damaged or from another build!\n", pResumePath);
+            ShutdownGame();
+            delete pScore;
+            delete pPlyr;
+            return -1;
+        }
+
+        FollowPlayer(pPlyr);
     }
 
-    // Run!
-    while (g_bRunning)
+    RewindInit(&g_xRewind, iRewindSeconds, iTickRate);
+
+    if (nullptr != pRecordPath && EError_OK != RecordOpen(&g_xRecorder, pRecordPath, iWidth, iHeight, iSeed))
     {
-        // Before Drawing, pick a random number and if it's within a range, spawn the UFO.
-        // The UFO has a >1% spawn chance, so we take a rand() % 100, and if the number is between 35-40, spawn the UFO. (30 and 40 picked arbitrarily).
-        u32 iSpawnUFO = (rand() % 1000) + 1;
+        fprintf(stderr, "Was unable to create the recording %s!\n", pRecordPath);
+        ShutdownGame();
+        delete pScore;
+        delete pPlyr;
+        return -1;
+    }
 
-        if (542 > iSpawnUFO && 540 < iSpawnUFO)
+    if (nullptr != pSpectatePath && EError_OK != SpectateListen(&g_xSpectators, pSpectatePath))
+    {
+        fprintf(stderr, "Was unable to take spectators on %s!\n", pSpectatePath);
+
+        if (nullptr != pRecordPath)
+        {
+            RecordClose(&g_xRecorder, 0, 0);
+        }
+
+        ShutdownGame();
+        delete pScore;
+        delete pPlyr;
+        return -1;
+    }
+
+    g_xSpectateFrame.Resize(g_pWorld->mxView.miWidth, g_pWorld->mxView.miHeight);
+
+    // Set the terminal mode.
+    SetTerminalMode();
+
+    // The terminal's settings are known now, so a crash can put them back.
+    if (nullptr != g_xCrashDump.msPath)
+    {
+        struct sigaction sAction;
+        memset(&sAction, 0, sizeof(sAction));
+        sAction.sa_handler = OnCrash;
+        sAction.sa_flags = SA_RESETHAND;
+        sigemptyset(&sAction.sa_mask);
+
+        sigaction(SIGSEGV, &sAction, nullptr);
+        sigaction(SIGBUS, &sAction, nullptr);
+        sigaction(SIGFPE, &sAction, nullptr);
+        sigaction(SIGILL, &sAction, nullptr);
+        sigaction(SIGABRT, &sAction, nullptr);
+    }
+
+    // Resizes are only let in while the game sits idle (see IdleWait()). They're held back before any thread starts, so
+    // every thread inherits that and none of them gets woken by one.
+    struct sigaction sResize;
+    memset(&sResize, 0, sizeof(sResize));
+    sResize.sa_handler = OnResize;
+    sigemptyset(&sResize.sa_mask);
+    sigaction(SIGWINCH, &sResize, nullptr);
+
+    sigset_t sHeld;
+    sigemptyset(&sHeld);
+    sigaddset(&sHeld, SIGWINCH);
+    pthread_sigmask(SIG_BLOCK, &sHeld, nullptr);
+
+    // A game still plays without the leaderboard, its scores just don't last.
+    if (EError_OK != ScoresOpen(&g_xScores, pScoresPath))
+    {
+        fprintf(stderr, "Was unable to open the leaderboard %s!\n", pScoresPath);
+    }
+    else if (0 == g_xScores.miLoaded)
+    {
+        u32 iOldBest = GetScore();
+
+        if (0 != iOldBest)
         {
-            // Spawn the UFO!
-            g_bUFOActive = true;
+            ScoresSubmit(&g_xScores, iOldBest);
         }
+    }
+
+    g_iHiScore = ScoresBest(&g_xScores);
 
-        // Draw!
-        if (EError_OK != DrawAll(pPlyr, pScore))
+    if (ERenderer_Ansi == g_eRenderer)
+    {
+        // There's no terminfo to ask, the environment will have to do.
+        if (!bPaletteSet)
         {
-            fprintf(stderr, "An unknown error occurred! ABORTING!\n");
-            break;
+            ePalette = PaletteFromEnv();
         }
 
-        DelayExec((1000/60));
+        const Viewport *pView = &g_pWorld->mxView;
+
+        if (EError_OK != AnsiInit(&g_xAnsi, STDOUT_FILENO, pView->miWidth, pView->miHeight, ePalette))
+        {
+            fprintf(stderr, "Was unable to write to the terminal!\n");
+            SpectateClose(&g_xSpectators);
+            ScoresClose(&g_xScores);
+            ShutdownGame();
+            delete pScore;
+            delete pPlyr;
+            return -1;
+        }
     }
-    endwin();
+    else
+    {
+        // Clear the xterm.
+        fprintf(stdout, "\e[H\e[J");
 
-    // Clean up.
-    delete pScore;
-    delete g_pUFO;
-    delete pPlyr;
+        // Set the cursor to be invisible!
+        fprintf(stdout, "\e[?25l");
 
-    // Reset the cursor and xterm.
-    fprintf(stdout, "\e[34h\e[?25h\e[0m");
+        // Now we need to initialize NCURSES.
+        initscr();
+        raw();
+        noecho();
+        nonl();
+        curs_set(0);
 
-    return 0;
-}
+        const Viewport *pView = &g_pWorld->mxView;
+        g_pLaneWin = newwin(c_iLaneRows, pView->miWidth, 0, 0);
+        g_pFieldWin = newwin(pView->HudRow() - c_iLaneRows, pView->miWidth, c_iLaneRows, 0);
+        g_pHudWin = newwin(1, pView->miWidth, pView->HudRow(), 0);
 
-EError MoveHorde()
-{
-    if (0 == g_iHordeMoveTimer)
+        // Only what changed gets redrawn.
+        g_pWorld->mxDirty.mbEnabled = true;
+
+        // Ask for what the terminal can't do and you get the next best thing.
+        if (!has_colors())
+        {
+            ePalette = EPalette_Mono;
+        }
+        else
+        {
+            start_color();
+
+            if (!bPaletteSet || EPalette_256 == ePalette)
+            {
+                ePalette = (256 <= COLORS) ? EPalette_256 : EPalette_8;
+            }
+        }
+
+        // The palette is settled here, once, drawing never checks again.
+        switch (ePalette)
+        {
+        case EPalette_Mono:
+            UseCursesPalette<MonoPalette>();
+            break;
+        case EPalette_8:
+            UseCursesPalette<Palette8>();
+            break;
+        case EPalette_256:
+            UseCursesPalette<Palette256>();
+            break;
+        }
+    }
+
+    // Keys are read on a thread of their own, neither renderer touches the terminal's input.
+    bool bInputStarted = (EError_OK == InputStart(&g_xInput, STDIN_FILENO));
+    g_pWorld->mbRunning = bInputStarted;
+
+    // The simulation runs at a fixed tick rate, the screen is only pushed out once per frame.
+    FrameScheduler sSched;
+    SchedulerInit(&sSched, iTickRate, (0 == iRenderRate) ? iTickRate : iRenderRate, iMaxCatchUp);
+
+    BotInit(&g_xBot, BotParams());
+    g_iBotRestartTicks = 2 * iTickRate;
+
+    // Timing a frame's phases costs next to nothing at these rates, so it's always on here.
+    ProfileReset(true);
+
+    // Logs recorded headless start their game before the first tick.
+    EInput eInput = EInput_None;
+
+    while (g_bReplaying && ReplayNext(&g_xReplay, 0, &eInput))
     {
-        if (!g_bMoveDown)
+        ApplyInput(eInput, pPlyr, pScore);
+    }
+
+    // Run! bShown is whether the screen shows the world as of the last tick.
+    bool bShown = false;
+
+    while (g_pWorld->mbRunning)
+    {
+        // The menu, the game over and the win screen are drawn once, then the game sleeps till there's a key, rather
+        // than ticking a world where nothing moves.
+        u64 iTimeoutNs = 0;
+
+        if (bShown && CanIdle(sSched.miTickNs, &iTimeoutNs))
         {
-            for (int iIdx = 0; iIdx < g_vHorde.size(); ++iIdx)
+            u64 iIdleSince = GetMonotonicNs();
+
+            if (IdleWait(iTimeoutNs) && g_bBotPlaying)
             {
-                if (g_vHorde.at(iIdx)->miXPos >= (g_xTerm.miXPos - 1))
+                // The bot's waited long enough, the next tick starts its next game.
+                g_iBotWaited = g_iBotRestartTicks - 1;
+            }
+
+            // Whoever resized the terminal has likely mangled what's on it.
+            if (g_bResized)
+            {
+                g_bResized = 0;
+                g_pWorld->mxDirty.mbFullRedraw = true;
+
+                if (ERenderer_Ansi == g_eRenderer)
                 {
-                    // Move down instead.
-                    g_bMoveDown = true;
-                    g_bHordeMoveRight = false;
+                    AnsiRepaint(&g_xAnsi);
                 }
-                else if (0 >= g_vHorde.at(iIdx)->miXPos)
+                else
                 {
-                    g_bMoveDown = true;
-                    g_bHordeMoveRight = true;
+                    clearok(curscr, TRUE);
                 }
+            }
 
-                // Are we gonna fire a bullet?
-                u32 iFire = (rand() % 1000) + 1;
+            SchedulerResume(&sSched, iIdleSince);
+        }
 
-                if (iFire == 543)
-                {
-                    // We need to alloc. a new bullet and place it in the bullet vector so it can be drawn.
-                    GameObject *pNewBull = new GameObject();
-                    pNewBull->miXPos = g_vHorde.at(iIdx)->miXPos;
-                    pNewBull->miYPos = g_vHorde.at(iIdx)->miYPos + 1;
-                    pNewBull->msCharStr = ".";
-                    pNewBull->miValue = 1;
-
-                    g_vBullets.push_back(pNewBull);
-                }
+        u32 iTicks = SchedulerWaitForTicks(&sSched);
+        bShown = bShown && (0 == iTicks);
+
+        for (u32 iTick = 0; iTick < iTicks && g_pWorld->mbRunning; ++iTick)
+        {
+            if (g_bReplaying && ReplayFinished(&g_xReplay, g_iSimTick))
+            {
+                g_pWorld->mbRunning = false;
+                break;
+            }
+
+            if (EError_OK != StepGame(pPlyr, pScore))
+            {
+                fprintf(stderr, "An unknown error occurred! ABORTING!\n");
+                g_pWorld->mbRunning = false;
+            }
+
+            ++g_iSimTick;
+
+            // Save the score as soon as the game is done, unless it's a replay of one that already was or it was
+            // rewound on the way.
+            if ((g_pWorld->mbGameOver || g_pWorld->mbWin) && !g_bReplaying && !g_bRewound)
+            {
+                SaveScore(pScore->miValue);
+            }
+            else
+            {
+                g_bScoreSaved = false;
+            }
+
+            // Lastly, check for keypresses.
+            u64 iInputStart = ProfileBegin();
+            GetKeyPress(pPlyr, pScore);
+            ProfileEnd(EPhase_Input, iInputStart);
+
+            // Rewinding only goes back within the game being played.
+            u64 iSnapshotStart = ProfileBegin();
+
+            if (g_pWorld->mbIsIntro)
+            {
+                RewindClear(&g_xRewind);
+                g_bRewound = false;
             }
+            else
+            {
+                RewindTake(&g_xRewind, g_iSimTick, pPlyr, pScore);
+            }
+
+            ProfileEnd(EPhase_Snapshot, iSnapshotStart);
         }
-        else
+
+        // The crash dump is kept as of the last tick of every frame.
+        if (0 < iTicks)
         {
-            g_bMoveDown = false;
+            u64 iSnapshotStart = ProfileBegin();
+            CrashDumpTake(&g_xCrashDump, g_iSimTick, pPlyr, pScore);
+            ProfileEnd(EPhase_Snapshot, iSnapshotStart);
         }
 
-        if (g_bHordeMoveRight)
+        if (g_pWorld->mbRunning && SchedulerRenderDue(&sSched))
         {
-            // Move the horde right.
-            for (int iIdx = 0; iIdx < g_vHorde.size(); ++iIdx)
+            u64 iDrawStart = ProfileBegin();
+
+            // On an arena the screen scrolls along with the player.
+            FollowPlayer(pPlyr);
+
+            if (ERenderer_Ansi == g_eRenderer)
             {
-                // Clear the position.
-                mvaddch(g_vHorde.at(iIdx)->miYPos, g_vHorde.at(iIdx)->miXPos, ' ');
+                ComposeFrame(&g_xAnsi.mxBack, pPlyr, pScore);
 
-                if (g_bMoveDown)
+                if (g_bShowOverlay && !g_pWorld->mbIsIntro)
                 {
-                    ++g_vHorde.at(iIdx)->miYPos;
+                    char sHud[256];
+                    FormatHud(sHud, sizeof(sHud), pScore);
+
+                    for (u32 iX = 0; iX < g_pWorld->mxView.miWidth; ++iX)
+                    {
+                        g_xAnsi.mxBack.Put(iX, g_pWorld->mxView.HudRow(), EColor_Default, ' ');
+                    }
+
+                    g_xAnsi.mxBack.Print(0, g_pWorld->mxView.HudRow(), EColor_White, "%s", sHud);
                 }
-                else if (!g_bMoveDown)
+
+                ProfileEnd(EPhase_Draw, iDrawStart);
+
+                u64 iPresentStart = ProfileBegin();
+                AnsiPresent(&g_xAnsi);
+                ProfileEnd(EPhase_Present, iPresentStart);
+            }
+            else
+            {
+                g_pDrawAll(pPlyr, pScore);
+                ProfileEnd(EPhase_Draw, iDrawStart);
+
+                u64 iPresentStart = ProfileBegin();
+                PresentFrame();
+                ProfileEnd(EPhase_Present, iPresentStart);
+            }
+
+            // Spectators are sent exactly what the terminal was.
+            if (SpectatePoll(&g_xSpectators))
+            {
+                u64 iSpectateStart = ProfileBegin();
+
+                if (ERenderer_Ansi == g_eRenderer)
                 {
-                    ++g_vHorde.at(iIdx)->miXPos;
+                    SpectatePublish(&g_xSpectators, &g_xAnsi.mxFront);
                 }
-
-                // Check for game over.
-                if (g_vBarriers.at(g_vBarriers.size()-1)->miYPos <= g_vHorde.at(iIdx)->miYPos)
+                else
                 {
-                    g_bGameOver = true;
+                    ComposeFrame(&g_xSpectateFrame, pPlyr, pScore);
+                    SpectatePublish(&g_xSpectators, &g_xSpectateFrame);
                 }
+
+                ProfileEnd(EPhase_Present, iSpectateStart);
             }
+
+            bShown = true;
         }
-        else
+
+        // Everything done since the last wake-up counts as one frame.
+        ProfileFlush();
+    }
+
+    InputStop(&g_xInput);
+
+    if (ERenderer_Ansi == g_eRenderer)
+    {
+        AnsiShutdown(&g_xAnsi);
+    }
+    else
+    {
+        delwin(g_pHudWin);
+        delwin(g_pFieldWin);
+        delwin(g_pLaneWin);
+        endwin();
+    }
+
+    if (!bInputStarted)
+    {
+        fprintf(stderr, "Was unable to start reading the keyboard!\n");
+    }
+
+    SchedulerReport(&sSched, stderr);
+    fprintf(stderr, "Seed: %llu\n", iSeed);
+
+    if (EError_OK != ProfileDump(pProfilePath))
+    {
+        fprintf(stderr, "Was unable to write the frame timings to %s!\n", pProfilePath);
+    }
+
+    if (nullptr != pRecordPath && EError_OK != RecordClose(&g_xRecorder, g_iSimTick, pScore->miValue))
+    {
+        fprintf(stderr, "Was unable to write the recording %s!\n", pRecordPath);
+    }
+
+    if (g_bReplaying && ReplayFinished(&g_xReplay, g_iSimTick))
+    {
+        // A replay that doesn't end on the recorded score has gone off script somewhere.
+        fprintf(stderr, "Replay: %s    Final score: %u    Recorded: %u\n",
+                (g_xReplay.miFinalScore == pScore->miValue) ? "matched" : "DIVERGED", pScore->miValue,
+                g_xReplay.miFinalScore);
+    }
+
+    if (ERenderer_Ansi == g_eRenderer)
+    {
+        ReportOutputStats("ansi", &g_xAnsi.mxStats, stderr);
+    }
+    else
+    {
+        ReportOutputStats("ncurses", &g_xCursesStats, stderr);
+    }
+
+    InputReport(&g_xInput, stderr);
+
+    if (g_bBotPlaying)
+    {
+        BotReport(&g_xBot, stderr);
+    }
+
+    if (nullptr != pSpectatePath)
+    {
+        SpectateClose(&g_xSpectators);
+        SpectateReport(&g_xSpectators, stderr);
+    }
+
+    if (0 < iRewindSeconds)
+    {
+        RewindReport(&g_xRewind, stderr);
+    }
+
+    if (nullptr != g_xCrashDump.msPath)
+    {
+        CrashDumpReport(&g_xCrashDump, stderr);
+    }
+
+    ScoresClose(&g_xScores);
+    ScoresReport(&g_xScores, stderr);
+
+    // Clean up.
+    ShutdownGame();
+    delete pScore;
+    delete pPlyr;
+
+    // Reset the cursor and xterm.
+    fprintf(stdout, "\e[34h\e[?25h\e[0m");
+
+    return 0;
+}
+
+WINDOW* WindowAt(int aiY, int *pLocalY)
+{
+    if (aiY < c_iLaneRows)
+    {
+        *pLocalY = aiY;
+        return g_pLaneWin;
+    }
+    else if (aiY < g_pWorld->mxView.HudRow())
+    {
+        *pLocalY = aiY - c_iLaneRows;
+        return g_pFieldWin;
+    }
+
+    *pLocalY = aiY - g_pWorld->mxView.HudRow();
+    return g_pHudWin;
+}
+
+// The color pairs are numbered after the color classes, a palette without color never sets one.
+template <typename TPalette> chtype ColorAttr(EColor aeColor)
+{
+    return TPalette::c_bColor ? COLOR_PAIR(aeColor) : A_NORMAL;
+}
+
+template <typename TPalette> void PutStr(int aiY, int aiX, EColor aeColor, const char *pFmt, ...)
+{
+    int iLocalY = 0;
+    WINDOW *pWin = WindowAt(aiY, &iLocalY);
+
+    wattron(pWin, ColorAttr<TPalette>(aeColor));
+
+    va_list vArgs;
+    va_start(vArgs, pFmt);
+    wmove(pWin, iLocalY, aiX);
+    vw_printw(pWin, pFmt, vArgs);
+    va_end(vArgs);
+
+    wattroff(pWin, ColorAttr<TPalette>(aeColor));
+}
+
+template <typename TPalette> void PutChar(int aiY, int aiX, EColor aeColor, char acChar)
+{
+    int iLocalY = 0;
+    WINDOW *pWin = WindowAt(aiY, &iLocalY);
+    mvwaddch(pWin, iLocalY, aiX, acChar | ColorAttr<TPalette>(aeColor));
+}
+
+template <typename TPalette> void PutSprite(int aiY, int aiX, ESprite aeSprite, EColor aeColor)
+{
+    const Sprite &rSprite = SpriteOf(aeSprite);
+    int iLocalY = 0;
+    WINDOW *pWin = WindowAt(aiY, &iLocalY);
+
+    // Cut down to the part on screen, NCurses would wrap the rest onto the next line.
+    int iLeft = aiX - rSprite.miCenter;
+    int iFirst = (0 > iLeft) ? -iLeft : 0;
+    int iEnd = std::min(static_cast<int>(rSprite.miWidth), static_cast<int>(g_pWorld->mxView.miWidth) - iLeft);
+
+    if (iFirst >= iEnd)
+    {
+        return;
+    }
+
+    wattron(pWin, ColorAttr<TPalette>(aeColor));
+    mvwaddnstr(pWin, iLocalY, iLeft + iFirst, rSprite.msGlyphs + iFirst, iEnd - iFirst);
+    wattroff(pWin, ColorAttr<TPalette>(aeColor));
+}
+
+template <typename TPalette> EError DrawHorde(int aiY, int aiLeft, int aiRight)
+{
+    // Only the formation's rows have enemies in them.
+    int iDY = aiY - g_pWorld->mxHorde.miOriginY;
+
+    if (0 > iDY || 0 != (iDY % c_iHordeYSpacing) ||
+        static_cast<u32>(iDY / c_iHordeYSpacing) >= g_pWorld->mxHorde.miRows)
+    {
+        return EError_OK;
+    }
+
+    u32 iRow = iDY / c_iHordeYSpacing;
+    const u64 *pMask = g_pWorld->mxHorde.RowMask(iRow);
+    const Sprite &rSprite = SpriteOf(static_cast<ESprite>(g_pWorld->mxHorde.mvRowSprite[iRow]));
+    const Viewport *pView = &g_pWorld->mxView;
+
+    // Draw the enemies still set in the formation, skipping whole words outside the span.
+    int iDX = aiLeft - g_pWorld->mxHorde.miOriginX;
+    u32 iFirstWord = (0 > iDX) ? 0 : ((iDX / c_iHordeXSpacing) / 64);
+
+    for (u32 iWord = iFirstWord; iWord < g_pWorld->mxHorde.miWords; ++iWord)
+    {
+        if (g_pWorld->mxHorde.ColumnX(iWord * 64) > aiRight)
+        {
+            break;
+        }
+
+        for (u64 iBits = pMask[iWord]; 0 != iBits; iBits &= (iBits - 1))
         {
-            // Move the horde left.
-            for (int iIdx = 0; iIdx < g_vHorde.size(); ++iIdx)
+            int iX = g_pWorld->mxHorde.ColumnX((iWord * 64) + __builtin_ctzll(iBits));
+
+            if (iX >= aiLeft && iX <= aiRight)
             {
-                // Clear the position.
-                mvaddch(g_vHorde.at(iIdx)->miYPos, g_vHorde.at(iIdx)->miXPos, ' ');
+                PutChar<TPalette>(aiY - pView->miY, iX - pView->miX, rSprite.meColor, rSprite.msGlyphs[0]);
+            }
+        }
+    }
 
-                if (g_bMoveDown)
-                {
-                    ++g_vHorde.at(iIdx)->miYPos;
-                }
-                else if (!g_bMoveDown)
-                {
-                    --g_vHorde.at(iIdx)->miXPos;
-                }
+    return EError_OK;
+}
 
-                // Check for game over.
-                if (g_vBarriers.at(g_vBarriers.size()-1)->miYPos <= g_vHorde.at(iIdx)->miYPos)
-                {
-                    g_bGameOver = true;
-                }
+template <typename TPalette> EError DrawPlayer(GameObject *pPlayer)
+{
+    if (NULL != pPlayer)
+    {
+        const Viewport *pView = &g_pWorld->mxView;
+        PutSprite<TPalette>(pPlayer->miYPos - pView->miY, pPlayer->miXPos - pView->miX, ESprite_Player,
+                            SpriteOf(ESprite_Player).meColor);
+        return EError_OK;
+    }
+    else
+    {
+        return EError_AssertPop;
+    }
+
+    return EError_Unknown;
+}
+
+template <typename TPalette> EError DrawBanner(const char *pStr, EColor aeColor)
+{
+    u32 iMidX = g_pWorld->mxView.miWidth / 2;
+    u32 iMidY = g_pWorld->mxView.miHeight / 2;
+    u32 iMidStr = strlen(pStr) / 2;
+
+    PutStr<TPalette>(iMidY, (iMidX - iMidStr), aeColor, pStr);
+
+    return EError_OK;
+}
+
+template <typename TPalette> EError DrawRow(GameObject *pPlayer, int aiY, int aiLeft, int aiRight)
+{
+    // The row and span are on the board, what's in them is drawn where the view puts it on screen.
+    const Viewport *pView = &g_pWorld->mxView;
+    int iScreenY = aiY - pView->miY;
+
+    // The UFO.
+    const Ufo *pUFO = &g_pWorld->mxUFO;
+
+    if (pUFO->mbActive && aiY == pUFO->miYPos && 0 < pUFO->miXPos &&
+        (pUFO->miXPos + 2) >= aiLeft && (pUFO->miXPos - 2) <= aiRight)
+    {
+        PutSprite<TPalette>(iScreenY, pUFO->miXPos - pView->miX, ESprite_UFO, SpriteOf(ESprite_UFO).meColor);
+    }
+
+    // The barriers that are still standing.
+    if (aiY == static_cast<int>(g_pWorld->miBarrierY))
+    {
+        u64 iStart = ProfileBegin();
+
+        const BarrierTable *pBarriers = &g_pWorld->mxBarriers;
+
+        for (u32 iIdx = 0; iIdx < pBarriers->Size(); ++iIdx)
+        {
+            u32 iHealth = pBarriers->mvHealth[iIdx];
+
+            if (0 == iHealth || pBarriers->Right(iIdx) < aiLeft || pBarriers->mvLeft[iIdx] > aiRight)
+            {
+                continue;
+            }
+
+            // The sprite goes down whole, then its center cell is overwritten with the health left.
+            EColor eColor = BarrierColor(iHealth);
+            int iCenterX = pBarriers->mvLeft[iIdx] + SpriteOf(ESprite_Barrier).miCenter - pView->miX;
+
+            PutSprite<TPalette>(iScreenY, iCenterX, ESprite_Barrier, eColor);
+
+            if (0 <= iCenterX && iCenterX < static_cast<int>(pView->miWidth))
+            {
+                PutChar<TPalette>(iScreenY, iCenterX, eColor, static_cast<char>('0' + iHealth));
             }
         }
 
-        // Reset the timer.
-        g_iHordeMoveTimer = g_nHordeReset;
+        ProfileEnd(EPhase_DrawBarriers, iStart);
     }
-    else
+
+    // The horde.
+    u64 iStart = ProfileBegin();
+    DrawHorde<TPalette>(aiY, aiLeft, aiRight);
+    ProfileEnd(EPhase_DrawHorde, iStart);
+
+    // The character.
+    if (aiY == pPlayer->miYPos && (pPlayer->miXPos + 1) >= aiLeft && (pPlayer->miXPos - 1) <= aiRight)
     {
-        --g_iHordeMoveTimer;
+        DrawPlayer<TPalette>(pPlayer);
     }
 
     return EError_OK;
 }
 
-EError DrawHorde()
+template <typename TPalette> EError DrawBullets(bool abDirtyOnly)
 {
-    // Draw the horde.
-    for (int iIdx = (g_vHorde.size() - 1); iIdx >= 0; --iIdx)
+    u64 iStart = ProfileBegin();
+    const BulletLane *pPlayerLane = &g_pWorld->mxBullets.mxPlayer;
+    const BulletLane *pEnemyLane = &g_pWorld->mxBullets.mxEnemy;
+
+    const EColor eShotColor = SpriteOf(ESprite_PlayerShot).meColor;
+    const EColor eEnemyShotColor = SpriteOf(ESprite_EnemyShot).meColor;
+
+    // Only bullets in view are drawn. Those can fall onto the score line too, they're left off it.
+    const Viewport *pView = &g_pWorld->mxView;
+
+    for (u32 iIdx = 0; iIdx < pPlayerLane->Size(); ++iIdx)
     {
-        if (nullptr != g_vHorde.at(iIdx))
+        int iX = pPlayerLane->mvX[iIdx];
+        int iY = pPlayerLane->mvY[iIdx];
+
+        if (pView->Shows(iX, iY) && (!abDirtyOnly || g_pWorld->mxDirty.IsDirty(iX, iY)))
         {
-            mvprintw(g_vHorde.at(iIdx)->miYPos, g_vHorde.at(iIdx)->miXPos, g_vHorde.at(iIdx)->msCharStr);
+            PutSprite<TPalette>(iY - pView->miY, iX - pView->miX, ESprite_PlayerShot, eShotColor);
         }
-        else
+    }
+
+    for (u32 iIdx = 0; iIdx < pEnemyLane->Size(); ++iIdx)
+    {
+        int iX = pEnemyLane->mvX[iIdx];
+        int iY = pEnemyLane->mvY[iIdx];
+
+        if (pView->Shows(iX, iY) && (!abDirtyOnly || g_pWorld->mxDirty.IsDirty(iX, iY)))
         {
-            return EError_AssertPop;
+            PutSprite<TPalette>(iY - pView->miY, iX - pView->miX, ESprite_EnemyShot, eEnemyShotColor);
         }
     }
+
+    ProfileEnd(EPhase_DrawBullets, iStart);
+
     return EError_OK;
 }
 
-EError DrawPlayer(GameObject *pPlayer)
+template <typename TPalette> EError DrawHud(GameObject *pScore)
 {
-    if (NULL != pPlayer)
-    {
-        move((pPlayer->miYPos), (pPlayer->miXPos - 1));
+    u64 iStart = ProfileBegin();
 
-        if (g_bHasColors)
-        {
-            attron(COLOR_PAIR(2));
-            printw(pPlayer->msCharStr);
-            attroff(COLOR_PAIR(2));
-        }
-        else
-        {
-            printw(pPlayer->msCharStr);
-        }
-        return EError_OK;
+    // Before the actual drawing happens, reposition the score to center it.
+    pScore->miXPos = GetScoreXPosition(g_pWorld->mxView.miWidth, pScore->msCharStr);
+
+    werase(g_pHudWin);
+
+    if (g_bShowOverlay)
+    {
+        // The timings need the room, so the score moves over to the left.
+        char sHud[256];
+        FormatHud(sHud, sizeof(sHud), pScore);
+        PutStr<TPalette>(g_pWorld->mxView.HudRow(), 0, EColor_White, "%s", sHud);
     }
     else
     {
-        return EError_AssertPop;
+        PutStr<TPalette>(g_pWorld->mxView.HudRow(), pScore->miXPos, EColor_White, pScore->msCharStr, pScore->miValue,
+                         g_iHiScore, g_pWorld->miLives);
     }
 
-    return EError_Unknown;
+    ProfileEnd(EPhase_DrawHud, iStart);
+
+    return EError_OK;
 }
 
-EError DrawAll(GameObject *pPlayer, GameObject *pScore)
+int FormatHud(char *pBuf, u32 aiSize, const GameObject *pScore)
 {
-    // FIRST, CHECK FOR INTRO!
-    if (g_bIsIntro)
+    int iLen = snprintf(pBuf, aiSize, pScore->msCharStr, pScore->miValue, g_iHiScore, g_pWorld->miLives);
+
+    if (g_bShowOverlay && iLen < static_cast<int>(aiSize))
     {
-        DrawIntro();
-        GetKeyPress(pPlayer);
-        return EError_OK;
+        iLen += snprintf(pBuf + iLen, aiSize - iLen, "  |  ");
+        iLen += ProfileSummary(pBuf + iLen, aiSize - iLen);
     }
 
-    // Next, Check for game over.
-    if (g_bGameOver)
+    // Keep off the last column, writing there scrolls some terminals.
+    int iWidth = g_pWorld->mxView.miWidth;
+    int iMax = (iWidth - 1 < static_cast<int>(aiSize)) ? (iWidth - 1) : (aiSize - 1);
+    if (iLen > iMax)
     {
-        const char *pStr = "Game Over!";
-        u32 iMidX = g_xTerm.miXPos / 2;
-        u32 iMidY = g_xTerm.miYPos / 2;
-        u32 iMidStr = strlen(pStr) / 2;
+        pBuf[iMax] = '\0';
+        iLen = iMax;
+    }
 
-        clear();
+    return iLen;
+}
+
+template <typename TPalette> EError DrawAll(GameObject *pPlayer, GameObject *pScore)
+{
+    // Anything that changes the whole screen (the menu, game over or a new board) means starting from scratch.
+    static bool s_bWasIntro = false;
+    static bool s_bWasGameOver = false;
+    static bool s_bWasWin = false;
+    static u32 s_iLastScore = ~0U;
+    static u32 s_iLastHiScore = ~0U;
+    static u32 s_iLastLives = ~0U;
+
+    bool bFull = g_pWorld->mxDirty.mbFullRedraw || s_bWasIntro != g_pWorld->mbIsIntro ||
+                 s_bWasGameOver != g_pWorld->mbGameOver || s_bWasWin != g_pWorld->mbWin;
+    s_bWasIntro = g_pWorld->mbIsIntro;
+    s_bWasGameOver = g_pWorld->mbGameOver;
+    s_bWasWin = g_pWorld->mbWin;
+
+    if (bFull)
+    {
+        werase(g_pLaneWin);
+        werase(g_pFieldWin);
 
-        if (g_bHasColors)
+        // FIRST, CHECK FOR INTRO!
+        if (g_pWorld->mbIsIntro)
         {
-            attron(COLOR_PAIR(3));
-            mvprintw(iMidY, (iMidX - iMidStr), pStr);
-            attroff(COLOR_PAIR(3));
+            DrawIntro<TPalette>();
         }
-        else
+        // Next, Check for game over.
+        else if (g_pWorld->mbGameOver)
         {
-            mvprintw(iMidY, (iMidX - iMidStr), pStr);
+            DrawBanner<TPalette>("Game Over!", EColor_Yellow);
         }
-
-        SaveScore(pScore->miValue);
-    }
-
-    if (g_bWin)
-    {
-        const char *pStr = "You Win!";
-        u32 iMidX = g_xTerm.miXPos / 2;
-        u32 iMidY = g_xTerm.miYPos / 2;
-        u32 iMidStr = strlen(pStr) / 2;
-
-        clear();
-
-        if (g_bHasColors)
+        else if (g_pWorld->mbWin)
         {
-            attron(COLOR_PAIR(2));
-            mvprintw(iMidY, (iMidX - iMidStr), pStr);
-            attroff(COLOR_PAIR(2));
+            DrawBanner<TPalette>("You Win!", EColor_Green);
         }
         else
         {
-            mvprintw(iMidY, (iMidX - iMidStr), pStr);
-        }
+            const Viewport *pView = &g_pWorld->mxView;
 
-        SaveScore(pScore->miValue);
-    }
-
-    // Draw the UFO.
-    if (g_bUFOActive)
-    {
-        if (0 == g_iUFOMoveTimer)
-        {
-            if (0 >= g_pUFO->miXPos)
+            for (int iY = pView->miY; iY < (pView->miY + pView->HudRow()); ++iY)
             {
-                g_bUFOActive = false;
-                g_pUFO->miXPos = g_xTerm.miXPos + 2;
-            }
-            else
-            {
-                // Move the UFO and draw it.
-                // Clear the old position first.
-                mvprintw(g_pUFO->miYPos, g_pUFO->miXPos - 2, "     ");
-
-                --g_pUFO->miXPos;
-
-                if (g_bHasColors)
-                {
-                    attron(COLOR_PAIR(1));
-                    mvprintw(g_pUFO->miYPos, g_pUFO->miXPos - 2, g_pUFO->msCharStr);
-                    attroff(COLOR_PAIR(1));
-                }
-                else
-                {
-                    mvprintw(g_pUFO->miYPos, g_pUFO->miXPos - 2, g_pUFO->msCharStr);
-                }
+                DrawRow<TPalette>(pPlayer, iY, pView->miX, pView->miX + pView->miWidth - 1);
             }
 
-            g_iUFOMoveTimer = 2;
-        }
-        else
-        {
-            --g_iUFOMoveTimer;
+            DrawBullets<TPalette>(false);
         }
     }
-
-    // Iterate through and draw + move the bullets.
-    for (int iIdx = (g_vBullets.size() - 1); iIdx >= 0; --iIdx)
+    else if (!g_pWorld->mbIsIntro && !g_pWorld->mbGameOver && !g_pWorld->mbWin)
     {
-        // Clear the bullet's old position first.
-        mvaddch(g_vBullets.at(iIdx)->miYPos, g_vBullets.at(iIdx)->miXPos, ' ');
+        // Blank out only the spans that changed and are in view, and put back whatever is in them now.
+        const Viewport *pView = &g_pWorld->mxView;
 
-        // Check the direction of the bullet and move accordingly.
-        if (0 == g_vBullets.at(iIdx)->miValue)
-        {
-            // Player bullet, move up.
-            g_vBullets.at(iIdx)->miYPos -= 1;
-        }
-        else
+        for (u32 iIdx = 0; iIdx < g_pWorld->mxDirty.mvRows.size(); ++iIdx)
         {
-            // Enemy bullet, move down.
-            g_vBullets.at(iIdx)->miYPos += 0.2;
-        }
+            int iY = g_pWorld->mxDirty.mvRows[iIdx];
+            const DirtyTracker *pDirty = &g_pWorld->mxDirty;
+            int iLeft = std::max(pDirty->mvMinX[iY], pView->miX);
+            int iRight = std::min(pDirty->mvMaxX[iY], pView->miX + static_cast<int>(pView->miWidth) - 1);
 
-        // Check to make sure the bullet is still on the board.
-        if (0 >= floor(g_vBullets.at(iIdx)->miYPos) || g_xTerm.miYPos <= floor(g_vBullets.at(iIdx)->miYPos))
-        {
-            // Pop the bullet off the vector.
-            delete g_vBullets.at(iIdx);
-            g_vBullets.erase(g_vBullets.begin()+iIdx);
-        }
-        else
-        {
-            // Draw the bullet.
-            if (g_bHasColors)
-            {
-                attron(COLOR_PAIR(3));
-                mvprintw(g_vBullets.at(iIdx)->miYPos, g_vBullets.at(iIdx)->miXPos, g_vBullets.at(iIdx)->msCharStr);
-                attroff(COLOR_PAIR(3));
-            }
-            else
+            if (!pView->Shows(pView->miX, iY) || iLeft > iRight)
             {
-                mvprintw(g_vBullets.at(iIdx)->miYPos, g_vBullets.at(iIdx)->miXPos, g_vBullets.at(iIdx)->msCharStr);
+                continue;
             }
 
-            // Check for Bullet collisions.
-            if (CheckBarrierCollision(g_vBullets.at(iIdx)))
-            {
-                // Pop the bullet off the vector.
-                mvaddch(g_vBullets.at(iIdx)->miYPos, g_vBullets.at(iIdx)->miXPos, ' ');
-                delete g_vBullets.at(iIdx);
-                g_vBullets.erase(g_vBullets.begin()+iIdx);
-            }
-            else
-            {
-                if (0 == g_vBullets.at(iIdx)->miValue)
-                {
-                    // Check for enemy collision.
-                    if (CheckEnemyCollision(g_vBullets.at(iIdx), pScore))
-                    {
-                        // Pop the bullet off the vector.
-                        mvaddch(g_vBullets.at(iIdx)->miYPos, g_vBullets.at(iIdx)->miXPos, ' ');
-                        delete g_vBullets.at(iIdx);
-                        g_vBullets.erase(g_vBullets.begin()+iIdx);
-                    }
-                }
-                else if (0 != g_vBullets.at(iIdx)->miValue)
-                {
-                    // Check for player collision.
-                    u32 iPlayerXMax = floor(pPlayer->miXPos + 1);
-                    u32 iPlayerXMin = floor(pPlayer->miXPos - 1);
-                    if ((iPlayerXMin <= floor(g_vBullets.at(iIdx)->miXPos) && floor(iPlayerXMax >= g_vBullets.at(iIdx)->miXPos)) && floor(pPlayer->miYPos) == floor(g_vBullets.at(iIdx)->miYPos))
-                    {
-                        // Pop the bullet off the vector.
-                        mvaddch(g_vBullets.at(iIdx)->miYPos, g_vBullets.at(iIdx)->miXPos, ' ');
-                        delete g_vBullets.at(iIdx);
-                        g_vBullets.erase(g_vBullets.begin()+iIdx);
-
-                        // Kill the player!
-                        --g_iLives;
-                        pPlayer->miXPos = (g_xTerm.miXPos / 2) - 1;
-                        pPlayer->miYPos = g_xTerm.miYPos * 0.875;
-                        clrtoeol();
-                    }
-                }
-            }
+            int iLocalY = 0;
+            WINDOW *pWin = WindowAt(iY - pView->miY, &iLocalY);
+
+            mvwhline(pWin, iLocalY, iLeft - pView->miX, ' ', (iRight - iLeft) + 1);
+
+            DrawRow<TPalette>(pPlayer, iY, iLeft, iRight);
         }
+
+        DrawBullets<TPalette>(true);
     }
 
-    // Draw the barriers.
-    for (int iIdx = (g_vBarriers.size() - 1); iIdx >= 0; --iIdx)
+    g_pWorld->mxDirty.Clear();
+
+    // Lastly, draw the score, but only when it says something new (the timings always do).
+    if (bFull || g_bShowOverlay || s_iLastScore != pScore->miValue || s_iLastHiScore != g_iHiScore ||
+        s_iLastLives != g_pWorld->miLives)
     {
-        // Grab the barrier offset (x / 2).
-        u32 miOffset = (strlen(g_vBarriers.at(iIdx)->msCharStr) - 1) / 2;
+        s_iLastScore = pScore->miValue;
+        s_iLastHiScore = g_iHiScore;
+        s_iLastLives = g_pWorld->miLives;
+        DrawHud<TPalette>(pScore);
+    }
 
-        // Print the barrier.
-        if (g_bHasColors)
-        {
-            u16 iClr = 2;
-            if (4 <= g_vBarriers.at(iIdx)->miValue && 7 > g_vBarriers.at(iIdx)->miValue)
-            {
-                iClr = 3;
-            }
-            else if (4 > g_vBarriers.at(iIdx)->miValue)
-            {
-                iClr = 1;
-            }
+    return EError_OK;
+}
 
-            attron(COLOR_PAIR(iClr));
-            mvprintw(g_vBarriers.at(iIdx)->miYPos, (g_vBarriers.at(iIdx)->miXPos - miOffset), g_vBarriers.at(iIdx)->msCharStr, g_vBarriers.at(iIdx)->miValue);
-            attroff(COLOR_PAIR(iClr));
-        }
-        else
+template <typename TPalette> void UseCursesPalette()
+{
+    if (TPalette::c_bColor)
+    {
+        for (int iColor = EColor_Red; iColor < EColor_Count; ++iColor)
         {
-            mvprintw(g_vBarriers.at(iIdx)->miYPos, (g_vBarriers.at(iIdx)->miXPos - miOffset), g_vBarriers.at(iIdx)->msCharStr, g_vBarriers.at(iIdx)->miValue);
+            init_pair(iColor, TPalette::Color(static_cast<EColor>(iColor)), COLOR_BLACK);
         }
     }
 
-    // Move and Draw the horde.
-    if (g_bHasColors)
-    {
-        attron(COLOR_PAIR(4));
-    }
+    g_pDrawAll = DrawAll<TPalette>;
+}
 
-    if (!g_bGameOver && !g_bWin)
-    {
-        MoveHorde();
-        DrawHorde();
-    }
+EError PresentFrame()
+{
+    u64 iBytesBefore = 0;
+    u64 iWritesBefore = 0;
+    bool bCounted = ReadWriteCounters(&iBytesBefore, &iWritesBefore);
 
-    if (g_bHasColors)
-    {
-        attroff(COLOR_PAIR(4));
-    }
+    // Every window is staged first so the terminal gets a single update.
+    wnoutrefresh(g_pLaneWin);
+    wnoutrefresh(g_pFieldWin);
+    wnoutrefresh(g_pHudWin);
+    doupdate();
 
-    if (g_bUpdateChar)
-    {
-        move(pPlayer->miYPos, 0);
-        clrtoeol();
-        g_bUpdateChar = false;
-    }
+    u64 iBytesAfter = 0;
+    u64 iWritesAfter = 0;
 
-    if (!g_bGameOver && !g_bWin)
+    if (bCounted && ReadWriteCounters(&iBytesAfter, &iWritesAfter))
     {
-        // Draw the character.
-        DrawPlayer(pPlayer);
+        ++g_xCursesStats.miFrames;
+        g_xCursesStats.miBytes += iBytesAfter - iBytesBefore;
+        g_xCursesStats.miWrites += iWritesAfter - iWritesBefore;
 
-        if (g_bHasColors)
+        if ((iBytesAfter - iBytesBefore) > g_xCursesStats.miMaxFrameBytes)
         {
-            attron(COLOR_PAIR(4));
+            g_xCursesStats.miMaxFrameBytes = iBytesAfter - iBytesBefore;
         }
     }
 
-    // Lastly, draw the score.
-    if (nullptr != pScore)
+    return EError_OK;
+}
+
+// Anything that isn't all digits is turned away, strtoul() on its own would take "-1" as the biggest number there is.
+bool ParseCount(const char *pArg, u32 aiMin, u32 aiMax, u32 *pOut)
+{
+    if ('0' > pArg[0] || '9' < pArg[0])
     {
-        // Before the actual drawing happens, reposition the score to center it.
-        pScore->miXPos = GetScoreXPosition(g_xTerm.miXPos, pScore->msCharStr);
-        move(pScore->miYPos, pScore->miXPos);
-        printw(pScore->msCharStr, pScore->miValue, g_iHiScore, g_iLives);
+        return false;
     }
 
-    if (g_bHasColors)
+    char *pEnd = nullptr;
+    errno = 0;
+    unsigned long iValue = strtoul(pArg, &pEnd, 10);
+
+    if ('\0' != *pEnd || ERANGE == errno || aiMin > iValue || aiMax < iValue)
     {
-        attroff(COLOR_PAIR(4));
+        return false;
     }
 
-    refresh();
+    *pOut = static_cast<u32>(iValue);
+    return true;
+}
 
-    // Decrement the cooldown timer on the fire.
-    g_iFireCooldown -= (0 >= g_iFireCooldown) ? 0 : 1;
+// Only the calling thread's counters: the input and score writer threads write() too, and NCurses mustn't be charged
+// for them. The file is opened by the first call, from the main thread, and stays that thread's.
+bool ReadWriteCounters(u64 *pBytes, u64 *pWrites)
+{
+    static int s_iFd = open("/proc/thread-self/io", O_RDONLY);
+    char sBuf[512];
 
-    // Lastly, check for keypresses.
-    GetKeyPress(pPlayer);
+    ssize_t iRead = (0 > s_iFd) ? -1 : pread(s_iFd, sBuf, sizeof(sBuf) - 1, 0);
+    if (0 >= iRead)
+    {
+        return false;
+    }
 
-    return EError_OK;
-}
+    sBuf[iRead] = '\0';
 
-EError GetKeyPress(GameObject *pPlayer)
-{    
-    int cChar = getch();
-    if (cChar < 0)
+    const char *pBytesAt = strstr(sBuf, "wchar:");
+    const char *pWritesAt = strstr(sBuf, "syscw:");
+    if (nullptr == pBytesAt || nullptr == pWritesAt)
     {
-        return EError_Unknown;
+        return false;
     }
-    else
-    {
-        // We have a character! Check and see if it's one we want, then discard.
-        if (119 == cChar || 32 == cChar)
-        {
-            if (!g_bGameOver && !g_bWin)
-            {
-                if (0 == g_iFireCooldown)
-                {
-                    // We need to alloc. a new bullet and place it in the bullet vector so it can be drawn.
-                    GameObject *pNewBull = new GameObject();
-                    pNewBull->miXPos = pPlayer->miXPos;
-                    pNewBull->miYPos = pPlayer->miYPos - 1;
-                    pNewBull->msCharStr = "*";
-                    pNewBull->miValue = 0;
 
-                    g_vBullets.push_back(pNewBull);
+    *pBytes = strtoull(pBytesAt + 6, nullptr, 10);
+    *pWrites = strtoull(pWritesAt + 6, nullptr, 10);
 
-                    g_iFireCooldown = 15;
-                }
-            }
-        }
-        else if (97 == cChar || KEY_LEFT == cChar)
+    return true;
+}
+
+EError GetKeyPress(GameObject *pPlayer, GameObject *pScore)
+{
+    // Everything that came in since the last tick, with the moves already netted out.
+    InputEvent vEvents[c_iInputRingSize];
+    u32 iEvents = InputTake(&g_xInput, vEvents, c_iInputRingSize);
+    EError eErr = EError_OK;
+
+    for (u32 iIdx = 0; iIdx < iEvents && EError_OK == eErr; ++iIdx)
+    {
+        EInput eInput = vEvents[iIdx].meInput;
+
+        // The overlay is the front-end's business, it never reaches the game or the log.
+        if (EInput_Overlay == eInput)
         {
-            if (!g_bGameOver && !g_bWin)
-            {
-                // Check to make sure we're not at the borders.
-                if (0 < (pPlayer->miXPos - 1))
-                {
-                    // We're not, move the character left.
-                    --pPlayer->miXPos;
-                    g_bUpdateChar = true;
-                }
-            }
+            g_bShowOverlay = !g_bShowOverlay;
+            g_pWorld->mxDirty.mbFullRedraw = true;
         }
-        else if (100 == cChar || KEY_RIGHT == cChar)
+        else if (EInput_Rewind == eInput)
         {
-            if (!g_bGameOver && !g_bWin)
+            // A log can't say where to rewind to, so there's no rewinding while one is being recorded or replayed.
+            if (!g_bReplaying && nullptr == g_xRecorder.mpFile && !g_pWorld->mbIsIntro &&
+                RewindBack(&g_xRewind, c_iRewindPerSecond * g_xRewind.miInterval, pPlayer, pScore, &g_iSimTick))
             {
-                // Check to make sure we're not at the borders.
-                if (g_xTerm.miXPos > (pPlayer->miXPos + 1))
-                {
-                    // We're not, move the character right.
-                    ++pPlayer->miXPos;
-                    g_bUpdateChar = true;
-                }
+                g_bRewound = true;
             }
         }
-        else if (27 == cChar)
+        else if (g_bReplaying)
         {
-            if (g_bIsIntro)
-            {
-                // Exit out.
-                g_bRunning = false;
-            }
-            else
+            // The log drives the game, the keyboard can only stop it.
+            if (EInput_Back == eInput || EInput_Quit == eInput)
             {
-                g_bIsIntro = true;
-                clear();
+                g_pWorld->mbRunning = false;
+                return EError_OK;
             }
         }
-        else if (3 == cChar)
+        else
         {
-            // Exit out.
-            g_bRunning = false;
+            RecordInput(&g_xRecorder, g_iSimTick, eInput);
+            eErr = ApplyInput(eInput, pPlayer, pScore);
         }
-        else if (13 == cChar) // ENTER
-        {
-            if (g_bIsIntro)
-            {
-                g_bIsIntro = false;
-                clear();
 
-                // Clear the horde and remake it.
-                g_vHorde.clear();
-                CreateBoard(pPlayer);
-            }
-        }
+        ProfileSample(EPhase_InputLag, GetMonotonicNs() - vEvents[iIdx].miArrivalNs);
     }
 
-    return EError_OK;
-}
-
-bool CheckBarrierCollision(GameObject *pBullet)
-{
-    if (nullptr != pBullet)
+    // The bot plays whatever game is on and starts the next one a couple of seconds after it ends. The menu is left to
+    // the player, so ESC still gets out. What it plays is recorded like any key.
+    if (g_bBotPlaying && !g_bReplaying && !g_pWorld->mbIsIntro && EError_OK == eErr)
     {
-        // Iterate through the barriers and check to see if one if hit.
-        for (int iIdx = (g_vBarriers.size() - 1); iIdx >= 0; --iIdx)
+        if (!g_pWorld->mbGameOver && !g_pWorld->mbWin)
         {
-            if (floor(pBullet->miYPos) <= floor(g_vBarriers.at(iIdx)->miYPos))
-            {
-                // Check to see if the bullet character is in the same position as one of the characters for the barrier.
-                u32 iStrLen = strlen(g_vBarriers.at(iIdx)->msCharStr) - 1;
-                u32 iSize = iStrLen / 2;
-                u32 iMax = (g_vBarriers.at(iIdx)->miXPos + iSize);
-                u32 iMin = (g_vBarriers.at(iIdx)->miXPos - iSize);
-
-                if (floor(pBullet->miXPos) <= floor(iMax) && floor(pBullet->miXPos) >= floor(iMin))
-                {
-                    // HIT!
-                    --g_vBarriers.at(iIdx)->miValue;
-
-                    // Check to see if the barrier is done for.
-                    if (0 >= g_vBarriers.at(iIdx)->miValue)
-                    {
-                        // Grab the barrier offset (x / 2).
-                        u32 miOffset = (strlen(g_vBarriers.at(iIdx)->msCharStr) - 1) / 2;
+            EInput eInput = BotChoose(&g_xBot, pPlayer, pScore);
+            g_iBotWaited = 0;
 
-                        // Print the barrier.
-                        mvprintw(g_vBarriers.at(iIdx)->miYPos, (g_vBarriers.at(iIdx)->miXPos - miOffset), "[!!!%d!!!]", 0);
-
-                        delete g_vBarriers.at(iIdx);
-                        g_vBarriers.erase(g_vBarriers.begin()+iIdx);
-                    }
-
-                    return true;
-                }
-            }
+            RecordInput(&g_xRecorder, g_iSimTick, eInput);
+            eErr = ApplyInput(eInput, pPlayer, pScore);
         }
-    }
-
-    return false;
-}
-
-bool CheckEnemyCollision(GameObject *pBullet, GameObject* apScore)
-{
-    if (nullptr != pBullet && !g_vHorde.empty())
-    {
-        // Iterate through the enemies and check for collision.
-        for (int iIdx = (g_vHorde.size() - 1); iIdx >= 0; --iIdx)
+        else if (++g_iBotWaited >= g_iBotRestartTicks)
         {
-            if (floor(g_vHorde.at(iIdx)->miXPos) == floor(pBullet->miXPos) && floor(g_vHorde.at(iIdx)->miYPos) == floor(pBullet->miYPos))
-            {
-                // HIT!
-                apScore->miValue += g_vHorde.at(iIdx)->miValue;
-
-                // Cut the enemy from the vector and return true to remove the bullet.
-                delete g_vHorde.at(iIdx);
-                g_vHorde.erase(g_vHorde.begin()+iIdx);
-
-                // Calculate the new horde timer reset amount.
-                if (5 < g_nHordeReset)
-                {
-                    real nSpeedDiff = (30.0 - 5.0);
-                    real nHordeSize = (g_vHorde.size() - 1.0);
-                    g_nHordeReset -= nSpeedDiff / nHordeSize;
-                }
-
-                return true;
-            }
+            RecordInput(&g_xRecorder, g_iSimTick, EInput_Back);
+            ApplyInput(EInput_Back, pPlayer, pScore);
+            RecordInput(&g_xRecorder, g_iSimTick, EInput_Start);
+            eErr = ApplyInput(EInput_Start, pPlayer, pScore);
         }
-    }    
+    }
 
-    // Check for UFO collision.
-    if (g_bUFOActive)
+    if (g_bReplaying)
     {
-        if (floor(pBullet->miXPos) >= floor(g_pUFO->miXPos - 2) && floor(pBullet->miXPos) <= floor(g_pUFO->miXPos + 2) && floor(pBullet->miYPos) == floor(g_pUFO->miYPos))
+        EInput eInput = EInput_None;
+
+        while (ReplayNext(&g_xReplay, g_iSimTick, &eInput) && EError_OK == eErr)
         {
-            apScore->miValue += g_pUFO->miValue;
-            g_pUFO->miXPos = g_xTerm.miXPos - 2;
-            g_pUFO->miYPos = 1;
-
-            // Erase the UFO from the screen.
-            move(1, 0);
-            clrtoeol();
-            g_bUFOActive = false;
-            return true;
+            eErr = ApplyInput(eInput, pPlayer, pScore);
         }
     }
 
-    // Check if we dun won.
-    if (0 >= g_vHorde.size())
-    {
-        g_bWin = true;
-    }
-
-    return false;
+    return eErr;
 }
 
 void ResetTerminalMode()
@@ -836,50 +1351,109 @@ void SetTerminalMode()
     tcsetattr(0, TCSANOW, &g_sNewTermios);
 }
 
-u32 GetScoreXPosition(u32 aiXTermWidth, const char *apStr)
+void OnCrash(int aiSignal)
+{
+    // Only what's safe in a signal handler: the dump is written with write(), and the terminal is put back the way it
+    // was found rather than through NCurses.
+    static const char c_sReset[] = "\e[?25h\e[0m\r\n";
+
+    CrashDumpWrite(&g_xCrashDump);
+    tcsetattr(0, TCSANOW, &g_sOrigTermios);
+    (void)!write(STDOUT_FILENO, c_sReset, sizeof(c_sReset) - 1);
+
+    // The handler was reset on the way in, so this goes down the way it would have.
+    raise(aiSignal);
+}
+
+void OnResize(int aiSignal)
 {
-    u32 iRtnVal = 1; // We start at one that way if the function fails, the text isn't against the side of the term.
-    u32 iStrLen = strlen(apStr);
-    iRtnVal = (aiXTermWidth / 2) - (iStrLen / 2);
-    return iRtnVal;
+    (void)aiSignal;
+    g_bResized = 1;
 }
 
-void DelayExec(u64 iMilliseconds)
+// Nothing moves on the menu, and the game over and win screens are just a banner, so only a key changes what's on
+// screen. The bot's restart is the one timed thing left, the wait ends when it's due. Replays and anyone spectating
+// keep the game ticking.
+bool CanIdle(u64 aiTickNs, u64 *pTimeoutNs)
 {
-    clock_t cStart = clock(); //!< Start the timer.
-    double iPassed; //!< Number of clocks passed.
-    bool bRun = true; //!< Should the loop run?
-    while(bRun)
+    *pTimeoutNs = 0;
+
+    if (g_bReplaying || !g_xSpectators.mvSpectators.empty() ||
+        (!g_pWorld->mbIsIntro && !g_pWorld->mbGameOver && !g_pWorld->mbWin))
+    {
+        return false;
+    }
+
+    if (g_bBotPlaying && !g_pWorld->mbIsIntro)
     {
-        iPassed = (clock() - cStart) / (CLOCKS_PER_SEC / 1000);
-        if(iPassed >= iMilliseconds)
+        // The tick the restart happens on still has to run.
+        if ((g_iBotWaited + 1) >= g_iBotRestartTicks)
         {
-            bRun = false;
+            return false;
         }
+
+        *pTimeoutNs = (g_iBotRestartTicks - g_iBotWaited - 1) * aiTickNs;
     }
+
+    return true;
 }
 
-EError SaveScore(u32 aiScore)
+// Waits in poll() on the keyboard and the spectator socket, with resizes let through, for up to aiTimeoutNs (0 waits
+// for as long as it takes). No ticks run and none are counted, so a recording made with idle spells in it plays back
+// the same.
+bool IdleWait(u64 aiTimeoutNs)
 {
-    if (!g_bScoreSaved)
+    u64 iDeadline = GetMonotonicNs() + aiTimeoutNs;
+
+    sigset_t sMask;
+    pthread_sigmask(SIG_BLOCK, nullptr, &sMask);
+    sigdelset(&sMask, SIGWINCH);
+
+    while (!InputPending(&g_xInput) && !g_bResized)
     {
-        FILE *pFile = fopen("scores", "w+");
+        // poll() skips the socket when nobody can spectate, it's -1.
+        struct pollfd vPoll[2] = { { g_xInput.mvReadyPipe[0], POLLIN, 0 }, { g_xSpectators.miListenFd, POLLIN, 0 } };
+        struct timespec sLeft;
+        struct timespec *pLeft = nullptr;
 
-        if (!pFile)
+        if (0 != aiTimeoutNs)
         {
-            return EError_Unknown;
+            u64 iNow = GetMonotonicNs();
+
+            if (iNow >= iDeadline)
+            {
+                return true;
+            }
+
+            sLeft.tv_sec = (iDeadline - iNow) / 1000000000ULL;
+            sLeft.tv_nsec = (iDeadline - iNow) % 1000000000ULL;
+            pLeft = &sLeft;
         }
 
-        char *pOut = new char[10];
-        sprintf(pOut, "%d", aiScore);
+        int iReady = ppoll(vPoll, 2, pLeft, &sMask);
 
-        fwrite(pOut, sizeof(u32), 1, pFile);
-        fclose(pFile);
+        // Someone wanting to watch is let in on the next frame. Anything but a signal going wrong just means ticking.
+        if ((0 < iReady && 0 != vPoll[1].revents) || (0 > iReady && EINTR != errno))
+        {
+            return false;
+        }
+    }
+
+    return false;
+}
 
-        delete[] pOut;
+EError SaveScore(u32 aiScore)
+{
+    if (!g_bScoreSaved)
+    {
+        // The writer thread takes it from here, the frame loop never waits on the disk.
+        ScoresSubmit(&g_xScores, aiScore);
+        g_iHiScore = ScoresBest(&g_xScores);
 
         g_bScoreSaved = true;
     }
+
+    return EError_OK;
 }
 
 u32 GetScore()
@@ -890,23 +1464,22 @@ u32 GetScore()
 
     if (pFile)
     {
-        char *pOut = new char[10];
-        fread(pOut, sizeof(u32), 1, pFile);
+        // Zeroed with room to spare, so whatever's read is always terminated.
+        char sOut[sizeof(u32) + 1] = {};
+        fread(sOut, 1, sizeof(u32), pFile);
         fclose(pFile);
 
-        iRtn = atoi(pOut);
-
-        delete[] pOut;
+        iRtn = strtoul(sOut, nullptr, 10);
     }
 
     return iRtn;
 }
 
-EError DrawIntro()
+template <typename TPalette> EError DrawIntro()
 {
     // Determine the middle of the screen.
-    u32 iXMid = g_xTerm.miXPos / 2;
-    u32 iYMid = g_xTerm.miYPos / 2;
+    u32 iXMid = g_pWorld->mxView.miWidth / 2;
+    u32 iYMid = g_pWorld->mxView.miHeight / 2;
     u32 iStrMid = strlen("Welcome to Shell Invaders!") / 2;
 
     /*
@@ -920,109 +1493,13 @@ EError DrawIntro()
      *
      * Press ENTER to begin!
      */
-    mvprintw((iYMid - 4), (iXMid - iStrMid), "Welcome to Shell Invaders!");
-    mvprintw((iYMid - 2), (iXMid - iStrMid), "Controls:");
-    mvprintw((iYMid - 1), (iXMid - iStrMid), "\tA/Left\t-\tMove Left");
-    mvprintw(iYMid, (iXMid - iStrMid), "\tD/Right\t-\tMove right");
-    mvprintw((iYMid+1), (iXMid - iStrMid), "\tW/Space\t-\tShoot");
-    mvprintw((iYMid+2), (iXMid - iStrMid), "\tESC\t-\tQuit/Return to Menu");
-    mvprintw((iYMid+4), (iXMid - iStrMid), "Press ENTER to begin!");
+    PutStr<TPalette>((iYMid - 4), (iXMid - iStrMid), EColor_White, "Welcome to Shell Invaders!");
+    PutStr<TPalette>((iYMid - 2), (iXMid - iStrMid), EColor_White, "Controls:");
+    PutStr<TPalette>((iYMid - 1), (iXMid - iStrMid), EColor_White, "\tA/Left\t-\tMove Left");
+    PutStr<TPalette>(iYMid, (iXMid - iStrMid), EColor_White, "\tD/Right\t-\tMove right");
+    PutStr<TPalette>((iYMid+1), (iXMid - iStrMid), EColor_White, "\tW/Space\t-\tShoot");
+    PutStr<TPalette>((iYMid+2), (iXMid - iStrMid), EColor_White, "\tESC\t-\tQuit/Return to Menu");
+    PutStr<TPalette>((iYMid+4), (iXMid - iStrMid), EColor_White, "Press ENTER to begin!");
 
     return EError_OK;
 }
-
-EError CreateBoard(GameObject *pPlyr)
-{
-    // First clear out the old crap.
-    for (int iIdx = (g_vHorde.size() -1); iIdx >= 0; --iIdx)
-    {
-        delete g_vHorde.at(iIdx);
-    }
-
-    g_vHorde.clear();
-
-    for (int iIdx = (g_vBarriers.size() - 1); iIdx >= 0; --iIdx)
-    {
-        delete g_vBarriers.at(iIdx);
-    }
-
-    g_vBarriers.clear();
-
-    // Determine the amount of barriers to make.
-    const char* csBarrierStr = "[###%d###]";
-    u32 iNumBarriers = (g_xTerm.miXPos / (strlen(csBarrierStr) - 1)) / 2; //!< We subtract 1 from the string length because in printing, %d will equal a single digit number.
-    u32 iBarrierXScale = g_xTerm.miXPos / iNumBarriers;
-    u32 iLastX = iBarrierXScale / 2;
-
-    for (u32 iIdx = 0; iIdx < iNumBarriers; ++iIdx)
-    {
-        // Allocate a new barrier object.
-        GameObject *pObj = new GameObject();
-        pObj->miXPos = iLastX;
-        pObj->miYPos = pPlyr->miYPos - 2;
-        pObj->msCharStr = csBarrierStr;
-        pObj->miValue = 9; //!< This has special meaning here, it's the health of the barrier.
-
-        // Push the barrier onto the vector.
-        g_vBarriers.push_back(pObj);
-
-        // Setup the next X position.
-        iLastX += iBarrierXScale;
-    }
-
-    // Create the horde of enemies.
-    u32 iBarrierY = pPlyr->miYPos - 2;
-    u32 iAmntHoriz = (g_xTerm.miXPos - (iBarrierXScale * 2)) / 2; //!< Calculate the amount of horizontal enemies.
-    u32 iAmntVert = (iBarrierY - 8); //!< Calculate the ammount of vertical lines in use. Subtract '8' as the lines start @ 3 and stop at 5 above barrier Y.
-    u32 iEnemyX = iBarrierXScale; // Enemies start at X position of the first barrier.
-    u32 iEnemyY = 3; // Vertical lines start @ 3.
-
-    for (u32 iIdx = 0; iIdx < (iAmntHoriz * iAmntVert); ++iIdx)
-    {
-        // First check to make sure that we don't overflow the row.
-        if (iEnemyX > (g_xTerm.miXPos - iBarrierXScale))
-        {
-            iEnemyX = iBarrierXScale;
-            iEnemyY += 2;
-        }
-
-        // Make sure we don't overflow vertically.
-        if (iEnemyY > (iBarrierY - 5))
-        {
-            break;
-        }
-
-        // Allocate a new object.
-        GameObject *pObj = new GameObject();
-        pObj->miXPos = iEnemyX;
-        pObj->miYPos = iEnemyY;
-        pObj->msCharStr = "";
-        pObj->miValue = 0;
-
-        // Determin the enemy stats (string and value).
-        if (iEnemyY >= 3 && iEnemyY <= 5)
-        {
-            // Setup class 3.
-            pObj->msCharStr = "&";
-            pObj->miValue = 15;
-        }
-        else if (iEnemyY >= 7 && iEnemyY <= 9)
-        {
-            // Setup class 2.
-            pObj->msCharStr = "$";
-            pObj->miValue = 10;
-        }
-        else
-        {
-            // Setup class 1.
-            pObj->msCharStr = "@";
-            pObj->miValue = 5;
-        }
-
-        // Push the character onto the horde vector.
-        g_vHorde.push_back(pObj);
-
-        // Update the X-Position.
-        iEnemyX += 2;
-    }
-}
@@ -0,0 +1,48 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ */
+#include <cstdlib>
+#include <cstring>
+
+#include "palette.h"
+
+const char* PaletteName(EPalette aePalette)
+{
+    static const char *s_vNames[] = { "mono", "8", "256" };
+    return s_vNames[aePalette];
+}
+
+bool PaletteFromName(const char *pName, EPalette *pPalette)
+{
+    for (int iIdx = EPalette_Mono; iIdx <= EPalette_256; ++iIdx)
+    {
+        if (0 == strcmp(pName, PaletteName(static_cast<EPalette>(iIdx))))
+        {
+            *pPalette = static_cast<EPalette>(iIdx);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+EPalette PaletteFromEnv()
+{
+    const char *pTerm = getenv("TERM");
+    const char *pColorTerm = getenv("COLORTERM");
+
+    if (nullptr == pTerm || 0 == strcmp(pTerm, "dumb"))
+    {
+        return EPalette_Mono;
+    }
+
+    // Anything claiming true color can do 256.
+    if ((nullptr != pColorTerm && '\0' != *pColorTerm) || nullptr != strstr(pTerm, "256color"))
+    {
+        return EPalette_256;
+    }
+
+    return EPalette_8;
+}
@@ -0,0 +1,76 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    Palettes, which turn a sprite's color class into what a terminal understands. Each is a policy the renderers are
+ *    specialized on at compile time, so drawing never asks what kind of terminal it's on; the front-end works that
+ *    out once at startup and picks the matching specialization.
+ *
+ *    Every palette has:
+ *        c_bColor        Whether it draws in color at all, when it doesn't no color code is ever sent.
+ *        Color(EColor)   Terminal color index for NCurses' color pairs (on black), -1 for the default.
+ *        Sgr(EColor)     Escape code selecting the color, for the ANSI renderer.
+ */
+#ifndef SHELL_INVADERS_PALETTE_H
+#define SHELL_INVADERS_PALETTE_H
+
+#include "sprites.h"
+
+enum EPalette
+{
+    EPalette_Mono, //!< No color, or the terminal can't do it.
+    EPalette_8, //!< The 8 standard colors.
+    EPalette_256 //!< xterm's 256 colors.
+};
+
+struct MonoPalette
+{
+    static const bool c_bColor = false;
+
+    static int Color(EColor) { return -1; }
+    static const char* Sgr(EColor) { return ""; }
+};
+
+struct Palette8
+{
+    static const bool c_bColor = true;
+
+    static int Color(EColor aeColor)
+    {
+        static const int s_vColors[EColor_Count] = { -1, 1, 2, 3, 7 };
+        return s_vColors[aeColor];
+    }
+
+    static const char* Sgr(EColor aeColor)
+    {
+        static const char *s_vSgr[EColor_Count] = { "\e[39m", "\e[31m", "\e[32m", "\e[33m", "\e[37m" };
+        return s_vSgr[aeColor];
+    }
+};
+
+// Brighter, purer versions of the same colors.
+struct Palette256
+{
+    static const bool c_bColor = true;
+
+    static int Color(EColor aeColor)
+    {
+        static const int s_vColors[EColor_Count] = { -1, 196, 46, 226, 231 };
+        return s_vColors[aeColor];
+    }
+
+    static const char* Sgr(EColor aeColor)
+    {
+        static const char *s_vSgr[EColor_Count] = { "\e[39m", "\e[38;5;196m", "\e[38;5;46m", "\e[38;5;226m",
+                                                    "\e[38;5;231m" };
+        return s_vSgr[aeColor];
+    }
+};
+
+const char* PaletteName(EPalette aePalette);
+bool PaletteFromName(const char *pName, EPalette *pPalette); //!< Parses "mono", "8" or "256".
+EPalette PaletteFromEnv(); //!< Best guess at what the terminal can do, from $TERM and $COLORTERM.
+
+#endif // SHELL_INVADERS_PALETTE_H
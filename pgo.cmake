@@ -0,0 +1,97 @@
+# Space Invaders in yer shell!
+# (c) 2016 Travis M Ervin
+#
+# Profile guided optimization, run by the pgo target. An instrumented Release build is trained on the session below,
+# then the same build tree is rebuilt with the profile (the profile's file names come from the object paths, so it
+# has to be the same tree). A plain Release build is timed against it on the scripted game.
+#
+# Takes SOURCE_DIR, BINARY_DIR, GENERATOR, SI_LTO and SI_ARCH.
+
+set(PGO_DIR "${BINARY_DIR}/pgo")
+set(RELEASE_DIR "${BINARY_DIR}/pgo-release")
+set(PROFILE_DIR "${PGO_DIR}/profile")
+
+# The training session. The scripted game is the simulation's hot loop, the bot exercises cloning and the search, the
+# arena the big board paths and the benchmarks frame composition.
+set(TRAIN_SCRIPTED "--size 80x24 --ticks 20000000 --seed 1 --script wwaaawwddd")
+set(TRAIN_BOT "--ticks 30000 --seed 1 --bot")
+set(TRAIN_ARENA "--size 4000x1000 --ticks 20000 --seed 1 --script wwaaawwddd")
+set(TRAIN_BENCH "--quick --time-ms 5")
+
+# What gets timed, and how many times (the best run counts).
+set(TIME_RUNS 3)
+
+function(pgo_configure aDir aStage)
+    file(MAKE_DIRECTORY "${aDir}")
+    execute_process(COMMAND ${CMAKE_COMMAND} -G "${GENERATOR}" -DCMAKE_BUILD_TYPE=Release -DSI_LTO=${SI_LTO}
+                            "-DSI_ARCH=${SI_ARCH}" "-DSI_PGO=${aStage}" "-DSI_PGO_DIR=${PROFILE_DIR}" "${SOURCE_DIR}"
+                    WORKING_DIRECTORY "${aDir}" RESULT_VARIABLE iResult OUTPUT_QUIET)
+
+    if(NOT iResult EQUAL 0)
+        message(FATAL_ERROR "Configuring ${aDir} failed.")
+    endif()
+
+    execute_process(COMMAND ${CMAKE_COMMAND} --build "${aDir}" RESULT_VARIABLE iResult OUTPUT_QUIET)
+
+    if(NOT iResult EQUAL 0)
+        message(FATAL_ERROR "Building ${aDir} failed.")
+    endif()
+endfunction()
+
+function(pgo_run aDir aBinary aArgs)
+    separate_arguments(vArgs UNIX_COMMAND "${aArgs}")
+    execute_process(COMMAND "${aDir}/${aBinary}" ${vArgs} WORKING_DIRECTORY "${aDir}" OUTPUT_QUIET ERROR_QUIET)
+endfunction()
+
+# Best ticks per second of the scripted game over TIME_RUNS runs.
+function(pgo_time aDir aOut)
+    separate_arguments(vArgs UNIX_COMMAND "${TRAIN_SCRIPTED}")
+    set(iBest 0)
+
+    foreach(iRun RANGE 1 ${TIME_RUNS})
+        execute_process(COMMAND "${aDir}/Space_Invaders_Headless" ${vArgs} WORKING_DIRECTORY "${aDir}"
+                        OUTPUT_VARIABLE sOut ERROR_QUIET)
+        string(REGEX MATCH "Ticks/s: ([0-9]+)" sMatch "${sOut}")
+
+        if(CMAKE_MATCH_1 GREATER iBest)
+            set(iBest ${CMAKE_MATCH_1})
+        endif()
+    endforeach()
+
+    set(${aOut} ${iBest} PARENT_SCOPE)
+endfunction()
+
+message(STATUS "PGO: building the instrumented binaries")
+file(REMOVE_RECURSE "${PROFILE_DIR}")
+pgo_configure("${PGO_DIR}" GENERATE)
+
+message(STATUS "PGO: training")
+pgo_run("${PGO_DIR}" Space_Invaders_Headless "${TRAIN_SCRIPTED}")
+pgo_run("${PGO_DIR}" Space_Invaders_Headless "${TRAIN_BOT}")
+pgo_run("${PGO_DIR}" Space_Invaders_Headless "${TRAIN_ARENA}")
+pgo_run("${PGO_DIR}" Space_Invaders_Bench "${TRAIN_BENCH}")
+
+message(STATUS "PGO: rebuilding with the profile")
+pgo_configure("${PGO_DIR}" USE)
+
+message(STATUS "PGO: building plain Release to compare against")
+pgo_configure("${RELEASE_DIR}" "")
+
+pgo_time("${RELEASE_DIR}" iRelease)
+pgo_time("${PGO_DIR}" iPgo)
+
+if(0 EQUAL iRelease)
+    message(FATAL_ERROR "The Release build didn't report its speed.")
+endif()
+
+math(EXPR iSpeedup "(${iPgo} * 100) / ${iRelease}")
+math(EXPR iWhole "${iSpeedup} / 100")
+math(EXPR iHundredths "${iSpeedup} % 100")
+
+if(iHundredths LESS 10)
+    set(iHundredths "0${iHundredths}")
+endif()
+
+message(STATUS "PGO: ${TRAIN_SCRIPTED}")
+message(STATUS "PGO: Release ${iRelease} ticks/s    PGO ${iPgo} ticks/s    Speedup ${iWhole}.${iHundredths}x")
+message(STATUS "PGO: binaries are in ${PGO_DIR}")
@@ -0,0 +1,156 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ */
+#include <cstring>
+
+#include "profiler.h"
+
+Profiler g_xProfiler;
+
+static u32 BucketOf(u64 aiNs)
+{
+    if (aiNs < c_iHistExact)
+    {
+        return static_cast<u32>(aiNs);
+    }
+
+    u32 iExp = 63 - __builtin_clzll(aiNs);
+    u32 iSub = static_cast<u32>(aiNs >> (iExp - 2)) & 3;
+
+    return c_iHistExact + ((iExp - 4) * 4) + iSub;
+}
+
+static u64 BucketTop(u32 aiBucket)
+{
+    if (aiBucket < c_iHistExact)
+    {
+        return aiBucket;
+    }
+
+    u32 iExp = ((aiBucket - c_iHistExact) / 4) + 4;
+    u64 iSub = (aiBucket - c_iHistExact) % 4;
+
+    return ((4 + iSub + 1) << (iExp - 2)) - 1;
+}
+
+void PhaseHistogram::Add(u64 aiNs)
+{
+    ++miCount;
+    miTotalNs += aiNs;
+    miMaxNs = (aiNs > miMaxNs) ? aiNs : miMaxNs;
+    ++mvBuckets[BucketOf(aiNs)];
+}
+
+u64 PhaseHistogram::Percentile(double anPercent) const
+{
+    if (0 == miCount)
+    {
+        return 0;
+    }
+
+    u64 iRank = static_cast<u64>((anPercent / 100.0) * miCount);
+    u64 iSeen = 0;
+
+    for (u32 iIdx = 0; iIdx < c_iHistBuckets; ++iIdx)
+    {
+        iSeen += mvBuckets[iIdx];
+
+        if (iSeen > iRank)
+        {
+            u64 iTop = BucketTop(iIdx);
+            return (iTop < miMaxNs) ? iTop : miMaxNs;
+        }
+    }
+
+    return miMaxNs;
+}
+
+void ProfileReset(bool abEnabled)
+{
+    memset(&g_xProfiler, 0, sizeof(g_xProfiler));
+    g_xProfiler.mbEnabled = abEnabled;
+}
+
+void ProfileFlush()
+{
+    for (u32 iIdx = 0; iIdx < EPhase_Count; ++iIdx)
+    {
+        if (g_xProfiler.mvTouched[iIdx])
+        {
+            g_xProfiler.mvPhases[iIdx].Add(g_xProfiler.mvPending[iIdx]);
+            g_xProfiler.mvPending[iIdx] = 0;
+            g_xProfiler.mvTouched[iIdx] = false;
+        }
+    }
+}
+
+const char* PhaseName(EPhase aePhase)
+{
+    static const char *s_vNames[EPhase_Count] =
+    {
+        "step", "ufo", "bullets", "horde", "input", "draw", "draw_barriers", "draw_horde", "draw_bullets", "draw_hud",
+        "present", "snapshot", "input_lag"
+    };
+
+    return s_vNames[aePhase];
+}
+
+int ProfileSummary(char *pBuf, u32 aiSize)
+{
+    static const EPhase s_vShown[] = { EPhase_Step, EPhase_Draw, EPhase_Present, EPhase_Input, EPhase_InputLag };
+    static const char *s_vLabels[] = { "sim", "draw", "out", "in", "lag" };
+
+    int iLen = 0;
+
+    for (u32 iIdx = 0; iIdx < (sizeof(s_vShown) / sizeof(s_vShown[0])) && iLen < static_cast<int>(aiSize); ++iIdx)
+    {
+        const PhaseHistogram *pHist = &g_xProfiler.mvPhases[s_vShown[iIdx]];
+
+        iLen += snprintf(pBuf + iLen, aiSize - iLen, "%s%s %llu/%lluus", (0 == iIdx) ? "" : "  ", s_vLabels[iIdx],
+                         pHist->Percentile(50) / 1000, pHist->Percentile(99) / 1000);
+    }
+
+    return iLen;
+}
+
+EError ProfileDump(const char *pPath)
+{
+    FILE *pFile = fopen(pPath, "w");
+
+    if (nullptr == pFile)
+    {
+        return EError_Unknown;
+    }
+
+    fprintf(pFile, "%-14s %10s %10s %10s %10s %10s %10s %10s\n", "phase", "frames", "mean_ns", "p50_ns", "p90_ns",
+            "p99_ns", "p999_ns", "max_ns");
+
+    for (u32 iIdx = 0; iIdx < EPhase_Count; ++iIdx)
+    {
+        const PhaseHistogram *pHist = &g_xProfiler.mvPhases[iIdx];
+
+        fprintf(pFile, "%-14s %10llu %10llu %10llu %10llu %10llu %10llu %10llu\n", PhaseName(static_cast<EPhase>(iIdx)),
+                pHist->miCount, (0 == pHist->miCount) ? 0 : (pHist->miTotalNs / pHist->miCount), pHist->Percentile(50),
+                pHist->Percentile(90), pHist->Percentile(99), pHist->Percentile(99.9), pHist->miMaxNs);
+    }
+
+    // Then every histogram in full, one line per bucket that has anything in it.
+    for (u32 iIdx = 0; iIdx < EPhase_Count; ++iIdx)
+    {
+        const PhaseHistogram *pHist = &g_xProfiler.mvPhases[iIdx];
+
+        fprintf(pFile, "\n[%s]\n", PhaseName(static_cast<EPhase>(iIdx)));
+
+        for (u32 iBucket = 0; iBucket < c_iHistBuckets; ++iBucket)
+        {
+            if (0 != pHist->mvBuckets[iBucket])
+            {
+                fprintf(pFile, "<= %llu ns: %u\n", BucketTop(iBucket), pHist->mvBuckets[iBucket]);
+            }
+        }
+    }
+
+    return (0 == fclose(pFile)) ? EError_OK : EError_Unknown;
+}
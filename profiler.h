@@ -0,0 +1,91 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    Per-phase frame timing. Each phase of a frame (simulation, drawing, output, input) is timed with
+ *    ProfileBegin()/ProfileEnd(), summed over the frame, and the frame's total for the phase goes into a latency
+ *    histogram when ProfileFlush() is called. Nothing is timed unless the profiler is enabled.
+ */
+#ifndef SHELL_INVADERS_PROFILER_H
+#define SHELL_INVADERS_PROFILER_H
+
+#include <cstdio>
+
+#include "game.h"
+#include "scheduler.h"
+
+enum EPhase
+{
+    EPhase_Step, //!< All of StepGame().
+    EPhase_UFO, //!< UFO spawn and movement.
+    EPhase_Bullets, //!< Bullet movement and collision.
+    EPhase_Horde, //!< MoveHorde().
+    EPhase_Input, //!< Reading and applying keys.
+    EPhase_Draw, //!< Laying out the whole frame.
+    EPhase_DrawBarriers,
+    EPhase_DrawHorde,
+    EPhase_DrawBullets,
+    EPhase_DrawHud,
+    EPhase_Present, //!< Pushing the frame out to the terminal (refresh).
+    EPhase_Snapshot, //!< Taking the rewind and crash dump snapshots.
+    EPhase_InputLag, //!< From a key arriving to the game acting on it, one sample per key rather than per frame.
+    EPhase_Count
+};
+
+// Histogram buckets: exact below 16ns, then four per power of two, which keeps every bucket within 25% of its value.
+const u32 c_iHistExact = 16;
+const u32 c_iHistBuckets = c_iHistExact + (60 * 4);
+
+struct PhaseHistogram
+{
+    u64 miCount; //!< Samples recorded.
+    u64 miTotalNs; //!< Sum of all samples.
+    u64 miMaxNs; //!< Largest sample.
+    u32 mvBuckets[c_iHistBuckets]; //!< Samples per bucket.
+
+    void Add(u64 aiNs);
+    u64 Percentile(double anPercent) const; //!< Upper bound of the bucket the percentile falls in.
+};
+
+struct Profiler
+{
+    bool mbEnabled; //!< Are phases being timed?
+    PhaseHistogram mvPhases[EPhase_Count];
+    u64 mvPending[EPhase_Count]; //!< Time spent in each phase since the last flush.
+    bool mvTouched[EPhase_Count]; //!< Did the phase run at all since the last flush?
+};
+
+extern Profiler g_xProfiler;
+
+inline u64 ProfileBegin()
+{
+    return g_xProfiler.mbEnabled ? GetMonotonicNs() : 0;
+}
+
+inline void ProfileEnd(EPhase aePhase, u64 aiStart)
+{
+    if (g_xProfiler.mbEnabled)
+    {
+        g_xProfiler.mvPending[aePhase] += GetMonotonicNs() - aiStart;
+        g_xProfiler.mvTouched[aePhase] = true;
+    }
+}
+
+// Records a single sample straight into a phase's histogram.
+inline void ProfileSample(EPhase aePhase, u64 aiNs)
+{
+    if (g_xProfiler.mbEnabled)
+    {
+        g_xProfiler.mvPhases[aePhase].Add(aiNs);
+    }
+}
+
+void ProfileReset(bool abEnabled); //!< Clears every histogram and turns timing on or off.
+void ProfileFlush(); //!< Ends a frame, recording what each phase that ran took.
+const char* PhaseName(EPhase aePhase);
+int ProfileSummary(char *pBuf, u32 aiSize); //!< One line of p50/p99 for the main phases, for an overlay.
+EError ProfileDump(const char *pPath); //!< Writes every histogram out in full.
+
+#endif // SHELL_INVADERS_PROFILER_H
@@ -0,0 +1,216 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ */
+#include <cstring>
+
+#include "replay.h"
+
+static const char c_sReplayMagic[4] = { 'S', 'I', 'R', 'P' };
+static const u32 c_iReplayVersion = 1;
+static const byte c_iReplayEnd = 0xFF;
+
+static void PutInt(FILE *pFile, u64 aiValue, u32 aiBytes)
+{
+    for (u32 iIdx = 0; iIdx < aiBytes; ++iIdx)
+    {
+        fputc(static_cast<int>((aiValue >> (iIdx * 8)) & 0xFF), pFile);
+    }
+}
+
+// Seven bits at a time, lowest first, the top bit says more follow. Most deltas fit in one byte.
+static void PutVarint(FILE *pFile, u64 aiValue)
+{
+    while (0x80 <= aiValue)
+    {
+        fputc(static_cast<int>((aiValue & 0x7F) | 0x80), pFile);
+        aiValue >>= 7;
+    }
+
+    fputc(static_cast<int>(aiValue), pFile);
+}
+
+static bool GetInt(ReplayReader *pReplay, u32 aiBytes, u64 *pValue)
+{
+    if ((pReplay->miPos + aiBytes) > pReplay->mvData.size())
+    {
+        return false;
+    }
+
+    *pValue = 0;
+    for (u32 iIdx = 0; iIdx < aiBytes; ++iIdx)
+    {
+        *pValue |= static_cast<u64>(pReplay->mvData[pReplay->miPos++]) << (iIdx * 8);
+    }
+
+    return true;
+}
+
+static bool GetVarint(ReplayReader *pReplay, u64 *pValue)
+{
+    *pValue = 0;
+
+    for (u32 iShift = 0; iShift < 64 && pReplay->miPos < pReplay->mvData.size(); iShift += 7)
+    {
+        byte iByte = pReplay->mvData[pReplay->miPos++];
+        *pValue |= static_cast<u64>(iByte & 0x7F) << iShift;
+
+        if (0 == (iByte & 0x80))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Reads the tick of the next record. A log cut short just ends there.
+static void ReadRecordTick(ReplayReader *pReplay)
+{
+    u64 iDelta = 0;
+
+    if (!GetVarint(pReplay, &iDelta) || pReplay->miPos >= pReplay->mvData.size())
+    {
+        pReplay->mbEnd = true;
+        return;
+    }
+
+    pReplay->miNextTick += iDelta;
+
+    if (c_iReplayEnd == pReplay->mvData[pReplay->miPos])
+    {
+        u64 iScore = 0;
+        ++pReplay->miPos;
+        GetInt(pReplay, 4, &iScore);
+
+        pReplay->mbEnd = true;
+        pReplay->miFinalScore = static_cast<u32>(iScore);
+    }
+}
+
+EError RecordOpen(ReplayRecorder *pRec, const char *pPath, u32 aiWidth, u32 aiHeight, u64 aiSeed)
+{
+    if (nullptr == pRec || nullptr == pPath)
+    {
+        return EError_InvalidArg;
+    }
+
+    pRec->mpFile = fopen(pPath, "wb");
+    if (nullptr == pRec->mpFile)
+    {
+        return EError_Unknown;
+    }
+
+    fwrite(c_sReplayMagic, 1, sizeof(c_sReplayMagic), pRec->mpFile);
+    PutInt(pRec->mpFile, c_iReplayVersion, 4);
+    PutInt(pRec->mpFile, aiWidth, 4);
+    PutInt(pRec->mpFile, aiHeight, 4);
+    PutInt(pRec->mpFile, aiSeed, 8);
+
+    pRec->miLastTick = 0;
+    pRec->miInputs = 0;
+
+    return EError_OK;
+}
+
+void RecordInput(ReplayRecorder *pRec, u64 aiTick, EInput aeInput)
+{
+    if (nullptr == pRec->mpFile || EInput_None == aeInput)
+    {
+        return;
+    }
+
+    PutVarint(pRec->mpFile, aiTick - pRec->miLastTick);
+    fputc(static_cast<int>(aeInput), pRec->mpFile);
+
+    pRec->miLastTick = aiTick;
+    ++pRec->miInputs;
+}
+
+EError RecordClose(ReplayRecorder *pRec, u64 aiTick, u32 aiScore)
+{
+    if (nullptr == pRec->mpFile)
+    {
+        return EError_OK;
+    }
+
+    PutVarint(pRec->mpFile, aiTick - pRec->miLastTick);
+    fputc(c_iReplayEnd, pRec->mpFile);
+    PutInt(pRec->mpFile, aiScore, 4);
+
+    bool bFailed = (0 != ferror(pRec->mpFile));
+    bFailed = (0 != fclose(pRec->mpFile)) || bFailed;
+    pRec->mpFile = nullptr;
+
+    return bFailed ? EError_Unknown : EError_OK;
+}
+
+EError ReplayOpen(ReplayReader *pReplay, const char *pPath)
+{
+    if (nullptr == pReplay || nullptr == pPath)
+    {
+        return EError_InvalidArg;
+    }
+
+    FILE *pFile = fopen(pPath, "rb");
+    if (nullptr == pFile)
+    {
+        return EError_Unknown;
+    }
+
+    pReplay->mvData.clear();
+
+    byte cBuf[4096];
+    size_t iRead = 0;
+
+    while (0 < (iRead = fread(cBuf, 1, sizeof(cBuf), pFile)))
+    {
+        pReplay->mvData.insert(pReplay->mvData.end(), cBuf, cBuf + iRead);
+    }
+
+    fclose(pFile);
+
+    // Check the header before trusting anything else in there.
+    u64 iVersion = 0;
+    u64 iWidth = 0;
+    u64 iHeight = 0;
+
+    pReplay->miPos = sizeof(c_sReplayMagic);
+
+    if (pReplay->mvData.size() < sizeof(c_sReplayMagic) ||
+        0 != memcmp(pReplay->mvData.data(), c_sReplayMagic, sizeof(c_sReplayMagic)) ||
+        !GetInt(pReplay, 4, &iVersion) || c_iReplayVersion != iVersion ||
+        !GetInt(pReplay, 4, &iWidth) || !GetInt(pReplay, 4, &iHeight) || !GetInt(pReplay, 8, &pReplay->miSeed))
+    {
+        return EError_InvalidArg;
+    }
+
+    pReplay->miWidth = static_cast<u32>(iWidth);
+    pReplay->miHeight = static_cast<u32>(iHeight);
+    pReplay->miNextTick = 0;
+    pReplay->mbEnd = false;
+    pReplay->miFinalScore = 0;
+
+    ReadRecordTick(pReplay);
+
+    return EError_OK;
+}
+
+bool ReplayNext(ReplayReader *pReplay, u64 aiTick, EInput *pInput)
+{
+    if (pReplay->mbEnd || pReplay->miNextTick != aiTick)
+    {
+        return false;
+    }
+
+    *pInput = static_cast<EInput>(pReplay->mvData[pReplay->miPos++]);
+    ReadRecordTick(pReplay);
+
+    return true;
+}
+
+bool ReplayFinished(const ReplayReader *pReplay, u64 aiTick)
+{
+    return pReplay->mbEnd && aiTick >= pReplay->miNextTick;
+}
@@ -0,0 +1,57 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    Input recording and replay. The simulation only changes on ticks, inputs and its random streams, so a log of the
+ *    board size, the seed and every input with the tick it landed on is enough to play a game out again exactly.
+ *
+ *    File layout (all integers little endian):
+ *        "SIRP" u32 version, u32 width, u32 height, u64 seed      Header.
+ *        varint tick delta, byte input                         One per input (EInput).
+ *        varint tick delta, 0xFF, u32 final score              End of the log.
+ *
+ *    Ticks count the StepGame() calls made before the input was applied, so inputs given before the first step are
+ *    on tick 0.
+ */
+#ifndef SHELL_INVADERS_REPLAY_H
+#define SHELL_INVADERS_REPLAY_H
+
+#include <cstdio>
+#include <vector>
+
+#include "game.h"
+
+struct ReplayRecorder
+{
+    FILE *mpFile; //!< Log being written, nullptr when not recording.
+    u64 miLastTick; //!< Tick of the last thing written, deltas are taken from here.
+    u64 miInputs; //!< Inputs written so far.
+
+    ReplayRecorder() : mpFile(nullptr), miLastTick(0), miInputs(0) {}
+};
+
+struct ReplayReader
+{
+    std::vector<byte> mvData; //!< The whole log.
+    size_t miPos; //!< Read position in mvData.
+    u32 miWidth; //!< Board size the log was recorded on.
+    u32 miHeight;
+    u64 miSeed; //!< Seed the log was recorded with.
+    u64 miNextTick; //!< Tick of the record at miPos.
+    bool mbEnd; //!< The record at miPos is the end of the log.
+    u32 miFinalScore; //!< Score when recording stopped (valid once mbEnd is set).
+
+    ReplayReader() : miPos(0), miWidth(0), miHeight(0), miSeed(0), miNextTick(0), mbEnd(true), miFinalScore(0) {}
+};
+
+EError RecordOpen(ReplayRecorder *pRec, const char *pPath, u32 aiWidth, u32 aiHeight, u64 aiSeed); //!< Starts a log.
+void RecordInput(ReplayRecorder *pRec, u64 aiTick, EInput aeInput); //!< Appends an input, does nothing when not recording.
+EError RecordClose(ReplayRecorder *pRec, u64 aiTick, u32 aiScore); //!< Ends the log on the given tick.
+
+EError ReplayOpen(ReplayReader *pReplay, const char *pPath); //!< Loads a log and reads its header.
+bool ReplayNext(ReplayReader *pReplay, u64 aiTick, EInput *pInput); //!< Pops the next input due on a tick, if there is one.
+bool ReplayFinished(const ReplayReader *pReplay, u64 aiTick); //!< Has the log run out by this tick?
+
+#endif // SHELL_INVADERS_REPLAY_H
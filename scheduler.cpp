@@ -0,0 +1,109 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ */
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+
+#include "scheduler.h"
+
+u64 GetMonotonicNs()
+{
+    struct timespec sNow;
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+    return (static_cast<u64>(sNow.tv_sec) * 1000000000ULL) + sNow.tv_nsec;
+}
+
+void SchedulerInit(FrameScheduler *pSched, u32 aiTickRate, u32 aiRenderRate, u32 aiMaxCatchUp)
+{
+    memset(pSched, 0, sizeof(FrameScheduler));
+    pSched->miTickNs = 1000000000ULL / aiTickRate;
+    pSched->miRenderNs = (0 == aiRenderRate) ? 0 : (1000000000ULL / aiRenderRate);
+    pSched->miMaxCatchUp = aiMaxCatchUp;
+    pSched->miNextTick = GetMonotonicNs();
+}
+
+u32 SchedulerWaitForTicks(FrameScheduler *pSched)
+{
+    u64 iNow = GetMonotonicNs();
+
+    // Sleep until the absolute deadline, so time spent working this frame doesn't push the next one back.
+    if (iNow < pSched->miNextTick)
+    {
+        struct timespec sDeadline;
+        sDeadline.tv_sec = pSched->miNextTick / 1000000000ULL;
+        sDeadline.tv_nsec = pSched->miNextTick % 1000000000ULL;
+
+        while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &sDeadline, nullptr))
+        {
+            // Interrupted by a signal, go back to sleep.
+        }
+
+        iNow = GetMonotonicNs();
+    }
+
+    // Work out how many ticks have come due, this is at least the one we waited for.
+    u64 iLate = iNow - pSched->miNextTick;
+    u64 iDue = 1 + (iLate / pSched->miTickNs);
+
+    if (iLate > pSched->miWorstLateNs)
+    {
+        pSched->miWorstLateNs = iLate;
+    }
+
+    if (1 < iDue)
+    {
+        ++pSched->miMissedDeadlines;
+    }
+
+    // The deadlines stay on the original tick grid, even for the ticks that get dropped.
+    pSched->miNextTick += iDue * pSched->miTickNs;
+
+    if (0 != pSched->miMaxCatchUp && iDue > pSched->miMaxCatchUp)
+    {
+        pSched->miDroppedTicks += iDue - pSched->miMaxCatchUp;
+        iDue = pSched->miMaxCatchUp;
+    }
+
+    pSched->miTicks += iDue;
+    return static_cast<u32>(iDue);
+}
+
+bool SchedulerRenderDue(FrameScheduler *pSched)
+{
+    u64 iNow = GetMonotonicNs();
+
+    if ((iNow - pSched->miLastRender) + (pSched->miTickNs / 2) < pSched->miRenderNs)
+    {
+        return false;
+    }
+
+    pSched->miLastRender = iNow;
+    ++pSched->miFrames;
+    return true;
+}
+
+// The ticks that would have been due while idle are never owed, the next one is due right away and the ones after it
+// keep to a fresh grid from there.
+void SchedulerResume(FrameScheduler *pSched, u64 aiIdleSince)
+{
+    u64 iNow = GetMonotonicNs();
+
+    pSched->miIdleNs += (iNow > aiIdleSince) ? (iNow - aiIdleSince) : 0;
+    ++pSched->miIdles;
+    pSched->miNextTick = iNow;
+}
+
+void SchedulerReport(const FrameScheduler *pSched, FILE *pOut)
+{
+    fprintf(pOut, "Ticks: %llu    Frames: %llu    Missed deadlines: %llu    Dropped ticks: %llu    Worst late: %.3fms\n",
+            pSched->miTicks, pSched->miFrames, pSched->miMissedDeadlines, pSched->miDroppedTicks,
+            pSched->miWorstLateNs / 1000000.0);
+
+    if (0 != pSched->miIdles)
+    {
+        fprintf(pOut, "Idle: %.1fs over %llu waits\n", pSched->miIdleNs / 1000000000.0, pSched->miIdles);
+    }
+}
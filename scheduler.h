@@ -0,0 +1,42 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    Fixed timestep frame scheduler. The simulation ticks at a fixed rate against CLOCK_MONOTONIC deadlines, the
+ *    front-end decides separately when a frame gets pushed out to the terminal.
+ */
+#ifndef SHELL_INVADERS_SCHEDULER_H
+#define SHELL_INVADERS_SCHEDULER_H
+
+#include <cstdio>
+
+#include "game.h"
+
+const u32 c_iMaxRate = 1000000000; //!< Most ticks or frames a second, each has to last at least a nanosecond.
+
+struct FrameScheduler
+{
+    u64 miTickNs; //!< Length of one simulation tick in nanoseconds.
+    u64 miRenderNs; //!< Minimum time between two rendered frames in nanoseconds.
+    u64 miNextTick; //!< Absolute CLOCK_MONOTONIC time (ns) the next tick is due.
+    u64 miLastRender; //!< Absolute CLOCK_MONOTONIC time (ns) of the last rendered frame.
+    u32 miMaxCatchUp; //!< Most ticks run back-to-back when behind, 0 means catch up on everything.
+    u64 miTicks; //!< Total simulation ticks run.
+    u64 miFrames; //!< Total frames rendered.
+    u64 miMissedDeadlines; //!< Wake-ups that came later than a whole tick past their deadline.
+    u64 miDroppedTicks; //!< Ticks thrown away by the catch-up policy.
+    u64 miWorstLateNs; //!< Worst lateness of a wake-up in nanoseconds.
+    u64 miIdles; //!< Times the front-end stopped ticking to wait for something to happen.
+    u64 miIdleNs; //!< Time spent waiting like that in nanoseconds.
+};
+
+u64 GetMonotonicNs();
+void SchedulerInit(FrameScheduler *pSched, u32 aiTickRate, u32 aiRenderRate, u32 aiMaxCatchUp);
+u32 SchedulerWaitForTicks(FrameScheduler *pSched); //!< Sleeps until the next tick is due and returns how many ticks to run.
+void SchedulerResume(FrameScheduler *pSched, u64 aiIdleSince); //!< Starts ticking again after idling since then.
+bool SchedulerRenderDue(FrameScheduler *pSched); //!< Returns true (and starts a new frame) if a frame should be pushed out.
+void SchedulerReport(const FrameScheduler *pSched, FILE *pOut);
+
+#endif // SHELL_INVADERS_SCHEDULER_H
@@ -0,0 +1,490 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ */
+#include <cstring>
+#include <ctime>
+#include <cerrno>
+#include <string>
+#include <algorithm>
+#include <functional>
+
+// Linux specific headers.
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "scores.h"
+
+static const char c_sScoresMagic[4] = { 'S', 'I', 'H', 'S' };
+static const u32 c_iScoresVersion = 1;
+static const u32 c_iHeaderSize = 8;
+static const u32 c_iRecordSize = 16;
+
+static void PutInt(byte *pOut, u64 aiValue, u32 aiBytes)
+{
+    for (u32 iIdx = 0; iIdx < aiBytes; ++iIdx)
+    {
+        pOut[iIdx] = static_cast<byte>((aiValue >> (iIdx * 8)) & 0xFF);
+    }
+}
+
+static u64 GetInt(const byte *pIn, u32 aiBytes)
+{
+    u64 iValue = 0;
+
+    for (u32 iIdx = 0; iIdx < aiBytes; ++iIdx)
+    {
+        iValue |= static_cast<u64>(pIn[iIdx]) << (iIdx * 8);
+    }
+
+    return iValue;
+}
+
+// CRC-32 (the zlib one), a table built the first time through.
+static u32 Crc32(const byte *pData, size_t aiLen)
+{
+    static u32 s_vTable[256];
+    static bool s_bBuilt = false;
+
+    if (!s_bBuilt)
+    {
+        for (u32 iIdx = 0; iIdx < 256; ++iIdx)
+        {
+            u32 iCrc = iIdx;
+
+            for (u32 iBit = 0; iBit < 8; ++iBit)
+            {
+                iCrc = (iCrc & 1) ? (0xEDB88320U ^ (iCrc >> 1)) : (iCrc >> 1);
+            }
+
+            s_vTable[iIdx] = iCrc;
+        }
+
+        s_bBuilt = true;
+    }
+
+    u32 iCrc = 0xFFFFFFFFU;
+    for (size_t iIdx = 0; iIdx < aiLen; ++iIdx)
+    {
+        iCrc = s_vTable[(iCrc ^ pData[iIdx]) & 0xFF] ^ (iCrc >> 8);
+    }
+
+    return iCrc ^ 0xFFFFFFFFU;
+}
+
+static void EncodeRecord(const ScoreRecord &rRecord, byte *pOut)
+{
+    PutInt(pOut, rRecord.miTime, 8);
+    PutInt(pOut + 8, rRecord.miScore, 4);
+    PutInt(pOut + 12, Crc32(pOut, 12), 4);
+}
+
+static bool DecodeRecord(const byte *pIn, ScoreRecord *pRecord)
+{
+    if (GetInt(pIn + 12, 4) != Crc32(pIn, 12))
+    {
+        return false;
+    }
+
+    pRecord->miTime = GetInt(pIn, 8);
+    pRecord->miScore = static_cast<u32>(GetInt(pIn + 8, 4));
+    return true;
+}
+
+static void EncodeHeader(byte *pOut)
+{
+    memcpy(pOut, c_sScoresMagic, sizeof(c_sScoresMagic));
+    PutInt(pOut + 4, c_iScoresVersion, 4);
+}
+
+static bool WriteAll(int aiFd, const byte *pData, size_t aiLen)
+{
+    while (0 < aiLen)
+    {
+        ssize_t iWritten = write(aiFd, pData, aiLen);
+
+        if (0 > iWritten)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+
+            return false;
+        }
+
+        pData += iWritten;
+        aiLen -= iWritten;
+    }
+
+    return true;
+}
+
+// Locks the file the path names right now. Someone may compact the log between our open() and our flock(), in which
+// case we're holding a lock on a file nobody else will look at again and have to start over on the new one.
+static bool LockCurrent(ScoreStore *pStore, int aiOp)
+{
+    for (;;)
+    {
+        if (0 > pStore->miFd)
+        {
+            pStore->miFd = open(pStore->msPath, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+            if (0 > pStore->miFd)
+            {
+                return false;
+            }
+        }
+
+        if (0 != flock(pStore->miFd, aiOp))
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+
+            return false;
+        }
+
+        struct stat sHeld;
+        struct stat sNamed;
+
+        if (0 == fstat(pStore->miFd, &sHeld) && 0 == stat(pStore->msPath, &sNamed) &&
+            sHeld.st_dev == sNamed.st_dev && sHeld.st_ino == sNamed.st_ino)
+        {
+            return true;
+        }
+
+        flock(pStore->miFd, LOCK_UN);
+        close(pStore->miFd);
+        pStore->miFd = -1;
+    }
+}
+
+// Maps the log in and reads every record that checks out. The caller holds the lock.
+static EError ReadLog(int aiFd, std::vector<ScoreRecord> *pRecords, u64 *pCorrupt)
+{
+    struct stat sStat;
+
+    if (0 != fstat(aiFd, &sStat))
+    {
+        return EError_Unknown;
+    }
+
+    size_t iSize = static_cast<size_t>(sStat.st_size);
+
+    if (0 == iSize)
+    {
+        return EError_OK;
+    }
+
+    // A crash part way through the very first append leaves a torn header and nothing else. Appending writes a fresh
+    // header over it, so it's read as an empty log rather than keeping the leaderboard shut for good.
+    if (c_iHeaderSize > iSize)
+    {
+        if (nullptr != pCorrupt)
+        {
+            ++(*pCorrupt);
+        }
+
+        return EError_OK;
+    }
+
+    void *pMap = mmap(nullptr, iSize, PROT_READ, MAP_SHARED, aiFd, 0);
+
+    if (MAP_FAILED == pMap)
+    {
+        return EError_Unknown;
+    }
+
+    const byte *pBytes = static_cast<const byte*>(pMap);
+    EError eRtn = EError_OK;
+
+    if (0 != memcmp(pBytes, c_sScoresMagic, sizeof(c_sScoresMagic)) || c_iScoresVersion != GetInt(pBytes + 4, 4))
+    {
+        eRtn = EError_InvalidArg;
+    }
+    else
+    {
+        for (size_t iPos = c_iHeaderSize; (iPos + c_iRecordSize) <= iSize; iPos += c_iRecordSize)
+        {
+            ScoreRecord sRecord;
+
+            if (DecodeRecord(pBytes + iPos, &sRecord))
+            {
+                pRecords->push_back(sRecord);
+            }
+            else if (nullptr != pCorrupt)
+            {
+                ++(*pCorrupt);
+            }
+        }
+    }
+
+    munmap(pMap, iSize);
+
+    return eRtn;
+}
+
+// Higher scores first, the older of two equal scores got there first.
+static bool RecordBefore(const ScoreRecord &rLeft, const ScoreRecord &rRight)
+{
+    return (rLeft.miScore != rRight.miScore) ? (rLeft.miScore > rRight.miScore) : (rLeft.miTime < rRight.miTime);
+}
+
+// Rewrites the log with only its best records. The caller holds the exclusive lock on the current log, which keeps
+// every other writer out until the new one has been renamed into place.
+static bool Compact(ScoreStore *pStore)
+{
+    std::vector<ScoreRecord> vRecords;
+
+    if (EError_OK != ReadLog(pStore->miFd, &vRecords, nullptr))
+    {
+        return false;
+    }
+
+    if (c_iScoresKeep < vRecords.size())
+    {
+        std::partial_sort(vRecords.begin(), vRecords.begin() + c_iScoresKeep, vRecords.end(), RecordBefore);
+        vRecords.resize(c_iScoresKeep);
+    }
+
+    std::vector<byte> vOut(c_iHeaderSize + (vRecords.size() * c_iRecordSize));
+    EncodeHeader(&vOut[0]);
+
+    for (size_t iIdx = 0; iIdx < vRecords.size(); ++iIdx)
+    {
+        EncodeRecord(vRecords[iIdx], &vOut[c_iHeaderSize + (iIdx * c_iRecordSize)]);
+    }
+
+    std::string sTemp = std::string(pStore->msPath) + "." + std::to_string(static_cast<long long>(getpid())) + ".tmp";
+    int iTempFd = open(sTemp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (0 > iTempFd)
+    {
+        return false;
+    }
+
+    bool bOK = WriteAll(iTempFd, &vOut[0], vOut.size()) && 0 == fsync(iTempFd);
+    close(iTempFd);
+
+    if (!bOK || 0 != rename(sTemp.c_str(), pStore->msPath))
+    {
+        unlink(sTemp.c_str());
+        return false;
+    }
+
+    ++pStore->miCompactions;
+    return true;
+}
+
+// Appends a batch of records in one write. Runs on the writer thread.
+static void Append(ScoreStore *pStore, const std::vector<ScoreRecord> &vBatch, bool abCompact)
+{
+    if (!LockCurrent(pStore, LOCK_EX))
+    {
+        pStore->miFailed += vBatch.size();
+        return;
+    }
+
+    struct stat sStat;
+    bool bOK = (0 == fstat(pStore->miFd, &sStat));
+    off_t iSize = bOK ? sStat.st_size : 0;
+
+    // Start a log nobody has written to yet, and drop whatever is left of a record a crash cut short.
+    std::vector<byte> vOut;
+
+    if (bOK && c_iHeaderSize > iSize)
+    {
+        bOK = (0 == ftruncate(pStore->miFd, 0));
+        vOut.resize(c_iHeaderSize);
+        EncodeHeader(&vOut[0]);
+        iSize = 0;
+    }
+    else if (bOK && 0 != ((iSize - c_iHeaderSize) % c_iRecordSize))
+    {
+        iSize -= (iSize - c_iHeaderSize) % c_iRecordSize;
+        bOK = (0 == ftruncate(pStore->miFd, iSize));
+    }
+
+    size_t iStart = vOut.size();
+    vOut.resize(iStart + (vBatch.size() * c_iRecordSize));
+
+    for (size_t iIdx = 0; iIdx < vBatch.size(); ++iIdx)
+    {
+        EncodeRecord(vBatch[iIdx], &vOut[iStart + (iIdx * c_iRecordSize)]);
+    }
+
+    bOK = bOK && (vOut.empty() || WriteAll(pStore->miFd, &vOut[0], vOut.size())) && 0 == fdatasync(pStore->miFd);
+
+    if (bOK)
+    {
+        pStore->miWritten += vBatch.size();
+    }
+    else
+    {
+        pStore->miFailed += vBatch.size();
+    }
+
+    u64 iRecords = (static_cast<u64>(iSize) + vOut.size() - c_iHeaderSize) / c_iRecordSize;
+
+    if (bOK && (abCompact || c_iScoresCompactAt < iRecords))
+    {
+        Compact(pStore);
+    }
+
+    flock(pStore->miFd, LOCK_UN);
+}
+
+static void WriteLoop(ScoreStore *pStore)
+{
+    std::vector<ScoreRecord> vBatch;
+
+    for (;;)
+    {
+        bool bStop = false;
+        bool bCompact = false;
+
+        {
+            std::unique_lock<std::mutex> xLock(pStore->mxLock);
+
+            while (!pStore->mbStop && !pStore->mbCompactDue && pStore->mvQueue.empty())
+            {
+                pStore->mxWake.wait(xLock);
+            }
+
+            vBatch.swap(pStore->mvQueue);
+            bStop = pStore->mbStop;
+            bCompact = pStore->mbCompactDue;
+            pStore->mbCompactDue = false;
+        }
+
+        if (!vBatch.empty() || bCompact)
+        {
+            Append(pStore, vBatch, bCompact);
+            vBatch.clear();
+        }
+
+        // Whatever was queued before the stop has been written by now.
+        if (bStop)
+        {
+            return;
+        }
+    }
+}
+
+EError ScoresOpen(ScoreStore *pStore, const char *pPath)
+{
+    if (nullptr == pStore || nullptr == pPath)
+    {
+        return EError_InvalidArg;
+    }
+
+    pStore->msPath = pPath;
+
+    // Shared is enough to read, a log that isn't there yet is made by the first score written to it.
+    if (!LockCurrent(pStore, LOCK_SH))
+    {
+        return EError_Unknown;
+    }
+
+    std::vector<ScoreRecord> vRecords;
+    EError eRtn = ReadLog(pStore->miFd, &vRecords, &pStore->miCorrupt);
+    flock(pStore->miFd, LOCK_UN);
+
+    if (EError_OK != eRtn)
+    {
+        close(pStore->miFd);
+        pStore->miFd = -1;
+        return eRtn;
+    }
+
+    pStore->miLoaded = vRecords.size();
+    pStore->mbCompactDue = (c_iScoresCompactAt < vRecords.size());
+
+    u32 iTop = std::min<u32>(c_iScoresTop, vRecords.size());
+    std::partial_sort(vRecords.begin(), vRecords.begin() + iTop, vRecords.end(), RecordBefore);
+
+    pStore->mvTop.clear();
+    for (u32 iIdx = 0; iIdx < iTop; ++iIdx)
+    {
+        pStore->mvTop.push_back(vRecords[iIdx].miScore);
+    }
+
+    pStore->mbStop = false;
+    pStore->mxThread = std::thread(WriteLoop, pStore);
+
+    return EError_OK;
+}
+
+void ScoresSubmit(ScoreStore *pStore, u32 aiScore)
+{
+    // The board is updated straight away, whether or not it makes it to the disk.
+    std::vector<u32>::iterator xAt = std::upper_bound(pStore->mvTop.begin(), pStore->mvTop.end(), aiScore,
+                                                      std::greater<u32>());
+    pStore->mvTop.insert(xAt, aiScore);
+
+    if (c_iScoresTop < pStore->mvTop.size())
+    {
+        pStore->mvTop.resize(c_iScoresTop);
+    }
+
+    if (!pStore->mxThread.joinable())
+    {
+        ++pStore->miFailed;
+        return;
+    }
+
+    ScoreRecord sRecord;
+    sRecord.miTime = static_cast<u64>(time(nullptr));
+    sRecord.miScore = aiScore;
+
+    {
+        std::lock_guard<std::mutex> xLock(pStore->mxLock);
+        pStore->mvQueue.push_back(sRecord);
+    }
+
+    pStore->mxWake.notify_one();
+}
+
+u32 ScoresBest(const ScoreStore *pStore)
+{
+    return pStore->mvTop.empty() ? 0 : pStore->mvTop[0];
+}
+
+void ScoresClose(ScoreStore *pStore)
+{
+    if (pStore->mxThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> xLock(pStore->mxLock);
+            pStore->mbStop = true;
+        }
+
+        pStore->mxWake.notify_one();
+        pStore->mxThread.join();
+    }
+
+    if (0 <= pStore->miFd)
+    {
+        close(pStore->miFd);
+        pStore->miFd = -1;
+    }
+}
+
+void ScoresReport(const ScoreStore *pStore, FILE *pOut)
+{
+    fprintf(pOut, "Scores loaded: %llu    Corrupt: %llu    Written: %llu    Failed: %llu    Compactions: %llu\n",
+            pStore->miLoaded, pStore->miCorrupt, pStore->miWritten, pStore->miFailed, pStore->miCompactions);
+
+    fprintf(pOut, "Leaderboard:");
+    for (u32 iIdx = 0; iIdx < pStore->mvTop.size(); ++iIdx)
+    {
+        fprintf(pOut, " %u", pStore->mvTop[iIdx]);
+    }
+    fprintf(pOut, "\n");
+}
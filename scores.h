@@ -0,0 +1,72 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    The leaderboard, kept in an append-only log that any number of games on the machine can share. On startup the
+ *    log is mapped in and the best scores picked out of it; after that a game never touches the disk itself. Scores
+ *    are handed to a writer thread, which appends them under an exclusive flock() and syncs them, so the frame loop
+ *    never waits on anything but a short queue lock.
+ *
+ *    File layout (all integers little endian):
+ *        "SIHS" u32 version                                Header.
+ *        u64 time, u32 score, u32 crc                      One per score, the CRC covers the 12 bytes before it.
+ *
+ *    A record torn by a crash fails its CRC and is skipped, and the next writer trims a cut short tail back to a
+ *    whole record before appending. Once the log grows past c_iScoresCompactAt records the writer thread rewrites it
+ *    with only the best c_iScoresKeep into a temporary file and renames it over the log. Writers holding the old
+ *    file notice the swap once they have their lock (the path no longer names their file) and open the new one.
+ */
+#ifndef SHELL_INVADERS_SCORES_H
+#define SHELL_INVADERS_SCORES_H
+
+#include <cstdio>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "game.h"
+
+// Scores kept in memory for lookups, best first.
+const u32 c_iScoresTop = 10;
+
+// Records the log can reach before it's compacted, and how many of the best survive that.
+const u32 c_iScoresCompactAt = 4096;
+const u32 c_iScoresKeep = 1024;
+
+struct ScoreRecord
+{
+    u64 miTime; //!< Seconds since the epoch the game ended.
+    u32 miScore;
+};
+
+struct ScoreStore
+{
+    const char *msPath; //!< The log.
+    int miFd; //!< The log, as the writer thread last opened it.
+    std::thread mxThread;
+    std::mutex mxLock; //!< Guards mvQueue and mbStop.
+    std::condition_variable mxWake;
+    std::vector<ScoreRecord> mvQueue; //!< Scores waiting on the writer thread.
+    bool mbStop;
+    bool mbCompactDue; //!< The log was already too long when it was loaded.
+    std::vector<u32> mvTop; //!< The best scores, best first, only the game's thread touches this.
+    u64 miLoaded; //!< Valid records found in the log on startup.
+    u64 miCorrupt; //!< Records that failed their CRC on startup.
+    u64 miWritten; //!< Records the writer thread appended, only it writes this until ScoresClose().
+    u64 miFailed; //!< Records the writer thread couldn't append.
+    u64 miCompactions;
+
+    ScoreStore() : msPath(nullptr), miFd(-1), mbStop(false), mbCompactDue(false), miLoaded(0), miCorrupt(0),
+                   miWritten(0), miFailed(0), miCompactions(0) {}
+};
+
+EError ScoresOpen(ScoreStore *pStore, const char *pPath); //!< Loads the best scores and starts the writer thread.
+void ScoresSubmit(ScoreStore *pStore, u32 aiScore); //!< Queues a finished game's score, never blocks on the disk.
+u32 ScoresBest(const ScoreStore *pStore); //!< The best score there is, 0 when there's none.
+void ScoresClose(ScoreStore *pStore); //!< Writes out whatever is queued and stops the writer thread.
+void ScoresReport(const ScoreStore *pStore, FILE *pOut);
+
+#endif // SHELL_INVADERS_SCORES_H
@@ -0,0 +1,631 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ */
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+
+// Linux specific headers.
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "snapshot.h"
+#include "scheduler.h"
+
+static const char c_sSnapshotMagic[4] = { 'S', 'I', 'S', 'N' };
+static const u32 c_iSnapshotVersion = 2;
+
+// The fixed size fields of a bullet lane.
+struct SnapshotLane
+{
+    u32 miBullets;
+    u32 miSlots;
+    u32 miFreeSlot;
+    u32 miNextGeneration;
+};
+
+// Every fixed size field in the snapshot, copied in and out in one go. Ufo, Rng, GameParams and TimerWheel are plain
+// values, so they go in whole.
+struct SnapshotHeader
+{
+    char mvMagic[4];
+    u32 miVersion;
+    u32 miHeaderSize; //!< sizeof(SnapshotHeader) in the build that took it.
+    u32 miChunks; //!< Occupancy grid chunks in use.
+    u64 miSize; //!< The whole snapshot, header included.
+    u64 miTick;
+    GameParams mxParams;
+    int miBoardWidth;
+    int miBoardHeight;
+    int miPlayerX;
+    int miPlayerY;
+    u32 miScore;
+    u32 miLives;
+    u32 miBarrierY;
+    u32 miFireSkip;
+    u32 miHordeReset;
+    byte mbHordeMoveRight;
+    byte mbGameOver;
+    byte mbWin;
+    byte mbMoveDown;
+    byte mbIsIntro;
+    Ufo mxUFO;
+    Rng mxUFORng;
+    Rng mxFireRng;
+    TimerWheel mxTimers;
+    int miHordeOriginX;
+    int miHordeOriginY;
+    u32 miHordeCols;
+    u32 miHordeRows;
+    u32 miHordeWords;
+    u32 miHordeAlive;
+    u32 miHordeMinCol;
+    u32 miHordeMaxCol;
+    u32 miHordeMaxRow;
+    u32 miHordeGeneration;
+    u32 miBarriers;
+    u32 miBarrierGeneration;
+    SnapshotLane mvLanes[2]; //!< The player's lane, then the enemy's.
+};
+
+static size_t LaneSize(const SnapshotLane &rLane)
+{
+    return (rLane.miBullets * ((3 * sizeof(int)) + sizeof(u32))) + (rLane.miSlots * sizeof(BulletSlot));
+}
+
+// Bytes a snapshot with this header takes. The counts have to have been checked, or this can overflow.
+static size_t SnapshotSize(const SnapshotHeader &rHead)
+{
+    size_t iRows = rHead.miHordeRows;
+
+    return sizeof(SnapshotHeader) + (iRows * rHead.miHordeWords * sizeof(u64)) + (rHead.miHordeCols * sizeof(u32)) +
+           (iRows * ((2 * sizeof(u32)) + sizeof(byte))) + (rHead.miBarriers * (sizeof(int) + sizeof(u32))) +
+           LaneSize(rHead.mvLanes[0]) + LaneSize(rHead.mvLanes[1]) +
+           (rHead.miChunks * (sizeof(u32) + c_iGridChunkCells));
+}
+
+template <typename T>
+static byte* PutArray(byte *pOut, const T *pData, size_t aiCount)
+{
+    if (0 < aiCount)
+    {
+        memcpy(pOut, pData, aiCount * sizeof(T));
+    }
+
+    return pOut + (aiCount * sizeof(T));
+}
+
+template <typename T>
+static const byte* GetArray(const byte *pIn, std::vector<T> *pOut, size_t aiCount)
+{
+    pOut->resize(aiCount);
+
+    if (0 < aiCount)
+    {
+        memcpy(&(*pOut)[0], pIn, aiCount * sizeof(T));
+    }
+
+    return pIn + (aiCount * sizeof(T));
+}
+
+// One element of an array still in the snapshot, which needn't be aligned.
+template <typename T>
+static T ElementAt(const byte *pArray, size_t aiIdx)
+{
+    T xValue;
+    memcpy(&xValue, pArray + (aiIdx * sizeof(T)), sizeof(T));
+    return xValue;
+}
+
+static void PutLane(SnapshotLane *pOut, const BulletLane *pLane)
+{
+    pOut->miBullets = pLane->Size();
+    pOut->miSlots = pLane->mvSlots.size();
+    pOut->miFreeSlot = pLane->miFreeSlot;
+    pOut->miNextGeneration = pLane->miNextGeneration;
+}
+
+static byte* PutLaneArrays(byte *pOut, const BulletLane *pLane)
+{
+    pOut = PutArray(pOut, pLane->mvX.data(), pLane->mvX.size());
+    pOut = PutArray(pOut, pLane->mvY.data(), pLane->mvY.size());
+    pOut = PutArray(pOut, pLane->mvSubY.data(), pLane->mvSubY.size());
+    pOut = PutArray(pOut, pLane->mvSlot.data(), pLane->mvSlot.size());
+    return PutArray(pOut, pLane->mvSlots.data(), pLane->mvSlots.size());
+}
+
+static const byte* GetLane(const byte *pIn, const SnapshotLane &rLane, BulletLane *pLane)
+{
+    pIn = GetArray(pIn, &pLane->mvX, rLane.miBullets);
+    pIn = GetArray(pIn, &pLane->mvY, rLane.miBullets);
+    pIn = GetArray(pIn, &pLane->mvSubY, rLane.miBullets);
+    pIn = GetArray(pIn, &pLane->mvSlot, rLane.miBullets);
+    pIn = GetArray(pIn, &pLane->mvSlots, rLane.miSlots);
+    pLane->miFreeSlot = rLane.miFreeSlot;
+    pLane->miNextGeneration = rLane.miNextGeneration;
+    return pIn;
+}
+
+// Whether a lane's slot indexes all land inside its arrays, which the world's lane has to have room for. Returns where
+// the next lane starts, or nullptr.
+static const byte* CheckLane(const byte *pIn, const SnapshotLane &rLane, const BulletLane *pLane)
+{
+    if (rLane.miBullets > rLane.miSlots || rLane.miSlots > pLane->miCapacity ||
+        (c_iNoSlot != rLane.miFreeSlot && rLane.miFreeSlot >= rLane.miSlots))
+    {
+        return nullptr;
+    }
+
+    const byte *pSlot = pIn + (rLane.miBullets * 3 * sizeof(int));
+    const byte *pSlots = pSlot + (rLane.miBullets * sizeof(u32));
+
+    for (u32 iIdx = 0; iIdx < rLane.miBullets; ++iIdx)
+    {
+        if (ElementAt<u32>(pSlot, iIdx) >= rLane.miSlots)
+        {
+            return nullptr;
+        }
+    }
+
+    for (u32 iIdx = 0; iIdx < rLane.miSlots; ++iIdx)
+    {
+        u32 iIndex = ElementAt<BulletSlot>(pSlots, iIdx).miIndex;
+
+        if (c_iNoSlot != iIndex && iIndex >= rLane.miSlots)
+        {
+            return nullptr;
+        }
+    }
+
+    return pIn + LaneSize(rLane);
+}
+
+static bool CheckTimers(const TimerWheel &rTimers)
+{
+    for (u32 iIdx = 0; iIdx < ETimer_Count; ++iIdx)
+    {
+        if ((c_iNoWheelSlot != rTimers.mvSlotOf[iIdx] && rTimers.mvSlotOf[iIdx] >= (c_iWheelLevels * c_iWheelSlots)) ||
+            (c_iNoTimer != rTimers.mvNext[iIdx] && rTimers.mvNext[iIdx] >= ETimer_Count) ||
+            (c_iNoTimer != rTimers.mvPrev[iIdx] && rTimers.mvPrev[iIdx] >= ETimer_Count))
+        {
+            return false;
+        }
+    }
+
+    for (u32 iIdx = 0; iIdx < (c_iWheelLevels * c_iWheelSlots); ++iIdx)
+    {
+        if (c_iNoTimer != rTimers.mvHead[iIdx] && rTimers.mvHead[iIdx] >= ETimer_Count)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Reads the fixed size fields, as long as they're from a build that lays them out the same.
+static bool ReadHeader(const std::vector<byte> &vData, SnapshotHeader *pHead)
+{
+    if (sizeof(SnapshotHeader) > vData.size())
+    {
+        return false;
+    }
+
+    memcpy(pHead, &vData[0], sizeof(SnapshotHeader));
+
+    return 0 == memcmp(pHead->mvMagic, c_sSnapshotMagic, sizeof(c_sSnapshotMagic)) &&
+           c_iSnapshotVersion == pHead->miVersion && sizeof(SnapshotHeader) == pHead->miHeaderSize;
+}
+
+// Reads the header and checks the rest against it: every count is within what the board allows, the sizes add up,
+// and nothing the game looks things up by (row sprites, bullet slots, grid chunks, timer links) points outside its
+// table.
+static bool CheckSnapshot(const std::vector<byte> &vData, SnapshotHeader *pHead)
+{
+    if (!ReadHeader(vData, pHead))
+    {
+        return false;
+    }
+
+    u32 iWidth = pHead->miBoardWidth;
+    u32 iHeight = pHead->miBoardHeight;
+
+    if (c_iMinBoardWidth > iWidth || c_iMaxBoardWidth < iWidth || c_iMinBoardHeight > iHeight ||
+        c_iMaxBoardHeight < iHeight || pHead->miHordeCols > iWidth || pHead->miHordeRows > iHeight ||
+        pHead->miHordeWords != ((pHead->miHordeCols + 63) / 64) || pHead->miBarriers > iWidth ||
+        pHead->mvLanes[0].miSlots > c_iBulletLaneCapacity || pHead->mvLanes[1].miSlots > c_iBulletLaneCapacity ||
+        pHead->miChunks > (((iWidth + c_iGridChunkWidth - 1) / c_iGridChunkWidth) *
+                           ((iHeight + c_iGridChunkHeight - 1) / c_iGridChunkHeight)) ||
+        SnapshotSize(*pHead) != pHead->miSize || vData.size() != pHead->miSize || !CheckTimers(pHead->mxTimers))
+    {
+        return false;
+    }
+
+    if (0 < pHead->miHordeAlive && (pHead->miHordeMinCol > pHead->miHordeMaxCol ||
+                                    pHead->miHordeMaxCol >= pHead->miHordeCols ||
+                                    pHead->miHordeMaxRow >= pHead->miHordeRows))
+    {
+        return false;
+    }
+
+    // The row sprites come after the mask and the column and row counts.
+    size_t iRows = pHead->miHordeRows;
+    const byte *pPos = &vData[0] + sizeof(SnapshotHeader) + (iRows * pHead->miHordeWords * sizeof(u64)) +
+                       (pHead->miHordeCols * sizeof(u32)) + (iRows * sizeof(u32));
+
+    for (u32 iRow = 0; iRow < pHead->miHordeRows; ++iRow)
+    {
+        if (ESprite_Enemy1 > pPos[iRow] || ESprite_Enemy3 < pPos[iRow])
+        {
+            return false;
+        }
+    }
+
+    pPos += (iRows * (sizeof(byte) + sizeof(u32))) + (pHead->miBarriers * (sizeof(int) + sizeof(u32)));
+    pPos = CheckLane(pPos, pHead->mvLanes[0], &g_pWorld->mxBullets.mxPlayer);
+    pPos = (nullptr == pPos) ? nullptr : CheckLane(pPos, pHead->mvLanes[1], &g_pWorld->mxBullets.mxEnemy);
+
+    if (nullptr == pPos)
+    {
+        return false;
+    }
+
+    u32 iChunkCols = (iWidth + c_iGridChunkWidth - 1) / c_iGridChunkWidth;
+    u32 iChunks = iChunkCols * ((iHeight + c_iGridChunkHeight - 1) / c_iGridChunkHeight);
+
+    for (u32 iIdx = 0; iIdx < pHead->miChunks; ++iIdx)
+    {
+        if (ElementAt<u32>(pPos, iIdx) >= iChunks)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void SnapshotSave(std::vector<byte> *pOut, u64 aiTick, const GameObject *pPlayer, const GameObject *pScore)
+{
+    const World *pWorld = g_pWorld;
+    const Horde *pHorde = &pWorld->mxHorde;
+    SnapshotHeader xHead = SnapshotHeader();
+
+    memcpy(xHead.mvMagic, c_sSnapshotMagic, sizeof(c_sSnapshotMagic));
+    xHead.miVersion = c_iSnapshotVersion;
+    xHead.miHeaderSize = sizeof(SnapshotHeader);
+    xHead.miChunks = pWorld->mxGrid.mvUsed.size();
+    xHead.miTick = aiTick;
+    xHead.mxParams = pWorld->mxParams;
+    xHead.miBoardWidth = pWorld->miBoardWidth;
+    xHead.miBoardHeight = pWorld->miBoardHeight;
+    xHead.miPlayerX = pPlayer->miXPos;
+    xHead.miPlayerY = pPlayer->miYPos;
+    xHead.miScore = pScore->miValue;
+    xHead.miLives = pWorld->miLives;
+    xHead.miBarrierY = pWorld->miBarrierY;
+    xHead.miFireSkip = pWorld->miFireSkip;
+    xHead.miHordeReset = pWorld->miHordeReset;
+    xHead.mbHordeMoveRight = pWorld->mbHordeMoveRight;
+    xHead.mbGameOver = pWorld->mbGameOver;
+    xHead.mbWin = pWorld->mbWin;
+    xHead.mbMoveDown = pWorld->mbMoveDown;
+    xHead.mbIsIntro = pWorld->mbIsIntro;
+    xHead.mxUFO = pWorld->mxUFO;
+    xHead.mxUFORng = pWorld->mxUFORng;
+    xHead.mxFireRng = pWorld->mxFireRng;
+    xHead.mxTimers = pWorld->mxTimers;
+    xHead.miHordeOriginX = pHorde->miOriginX;
+    xHead.miHordeOriginY = pHorde->miOriginY;
+    xHead.miHordeCols = pHorde->miCols;
+    xHead.miHordeRows = pHorde->miRows;
+    xHead.miHordeWords = pHorde->miWords;
+    xHead.miHordeAlive = pHorde->miAlive;
+    xHead.miHordeMinCol = pHorde->miMinCol;
+    xHead.miHordeMaxCol = pHorde->miMaxCol;
+    xHead.miHordeMaxRow = pHorde->miMaxRow;
+    xHead.miHordeGeneration = pHorde->miGeneration;
+    xHead.miBarriers = pWorld->mxBarriers.Size();
+    xHead.miBarrierGeneration = pWorld->mxBarriers.miGeneration;
+    PutLane(&xHead.mvLanes[0], &pWorld->mxBullets.mxPlayer);
+    PutLane(&xHead.mvLanes[1], &pWorld->mxBullets.mxEnemy);
+    xHead.miSize = SnapshotSize(xHead);
+
+    // Storage from the last snapshot taken into this buffer is reused.
+    pOut->resize(xHead.miSize);
+
+    byte *pPos = PutArray(&(*pOut)[0], &xHead, 1);
+    pPos = PutArray(pPos, pHorde->mvAlive.data(), pHorde->mvAlive.size());
+    pPos = PutArray(pPos, pHorde->mvColAlive.data(), pHorde->mvColAlive.size());
+    pPos = PutArray(pPos, pHorde->mvRowAlive.data(), pHorde->mvRowAlive.size());
+    pPos = PutArray(pPos, pHorde->mvRowSprite.data(), pHorde->mvRowSprite.size());
+    pPos = PutArray(pPos, pHorde->mvRowValue.data(), pHorde->mvRowValue.size());
+    pPos = PutArray(pPos, pWorld->mxBarriers.mvLeft.data(), pWorld->mxBarriers.mvLeft.size());
+    pPos = PutArray(pPos, pWorld->mxBarriers.mvHealth.data(), pWorld->mxBarriers.mvHealth.size());
+    pPos = PutLaneArrays(pPos, &pWorld->mxBullets.mxPlayer);
+    pPos = PutLaneArrays(pPos, &pWorld->mxBullets.mxEnemy);
+    pPos = PutArray(pPos, pWorld->mxGrid.mvUsed.data(), pWorld->mxGrid.mvUsed.size());
+    PutArray(pPos, pWorld->mxGrid.mvCells.data(), pWorld->mxGrid.mvCells.size());
+}
+
+EError SnapshotRestore(const std::vector<byte> &vData, GameObject *pPlayer, GameObject *pScore, u64 *pTick)
+{
+    SnapshotHeader xHead;
+
+    if (nullptr == pPlayer || nullptr == pScore || !CheckSnapshot(vData, &xHead) ||
+        g_pWorld->miBoardWidth != xHead.miBoardWidth || g_pWorld->miBoardHeight != xHead.miBoardHeight)
+    {
+        return EError_InvalidArg;
+    }
+
+    World *pWorld = g_pWorld;
+    Horde *pHorde = &pWorld->mxHorde;
+
+    *pTick = xHead.miTick;
+    pWorld->mxParams = xHead.mxParams;
+    pPlayer->miXPos = xHead.miPlayerX;
+    pPlayer->miYPos = xHead.miPlayerY;
+    pScore->miValue = xHead.miScore;
+    pWorld->miLives = xHead.miLives;
+    pWorld->miBarrierY = xHead.miBarrierY;
+    pWorld->miFireSkip = xHead.miFireSkip;
+    pWorld->miHordeReset = xHead.miHordeReset;
+    pWorld->mbHordeMoveRight = (0 != xHead.mbHordeMoveRight);
+    pWorld->mbGameOver = (0 != xHead.mbGameOver);
+    pWorld->mbWin = (0 != xHead.mbWin);
+    pWorld->mbMoveDown = (0 != xHead.mbMoveDown);
+    pWorld->mbIsIntro = (0 != xHead.mbIsIntro);
+    pWorld->mxUFO = xHead.mxUFO;
+    pWorld->mxUFORng = xHead.mxUFORng;
+    pWorld->mxFireRng = xHead.mxFireRng;
+    pWorld->mxTimers = xHead.mxTimers;
+    pHorde->miOriginX = xHead.miHordeOriginX;
+    pHorde->miOriginY = xHead.miHordeOriginY;
+    pHorde->miCols = xHead.miHordeCols;
+    pHorde->miRows = xHead.miHordeRows;
+    pHorde->miWords = xHead.miHordeWords;
+    pHorde->miAlive = xHead.miHordeAlive;
+    pHorde->miMinCol = xHead.miHordeMinCol;
+    pHorde->miMaxCol = xHead.miHordeMaxCol;
+    pHorde->miMaxRow = xHead.miHordeMaxRow;
+    pHorde->miGeneration = xHead.miHordeGeneration;
+    pWorld->mxBarriers.miGeneration = xHead.miBarrierGeneration;
+
+    const byte *pPos = &vData[0] + sizeof(SnapshotHeader);
+    pPos = GetArray(pPos, &pHorde->mvAlive, static_cast<size_t>(pHorde->miWords) * pHorde->miRows);
+    pPos = GetArray(pPos, &pHorde->mvColAlive, pHorde->miCols);
+    pPos = GetArray(pPos, &pHorde->mvRowAlive, pHorde->miRows);
+    pPos = GetArray(pPos, &pHorde->mvRowSprite, pHorde->miRows);
+    pPos = GetArray(pPos, &pHorde->mvRowValue, pHorde->miRows);
+    pPos = GetArray(pPos, &pWorld->mxBarriers.mvLeft, xHead.miBarriers);
+    pPos = GetArray(pPos, &pWorld->mxBarriers.mvHealth, xHead.miBarriers);
+    pPos = GetLane(pPos, xHead.mvLanes[0], &pWorld->mxBullets.mxPlayer);
+    pPos = GetLane(pPos, xHead.mvLanes[1], &pWorld->mxBullets.mxEnemy);
+
+    // The barrier column table is rebuilt, only the barriers still standing are in it.
+    pWorld->mvBarrierColumns.assign(static_cast<u32>(pWorld->miBoardWidth), c_iNoBarrier);
+
+    for (u32 iBarrier = 0; iBarrier < pWorld->mxBarriers.Size(); ++iBarrier)
+    {
+        for (int iCol = pWorld->mxBarriers.mvLeft[iBarrier]; iCol <= pWorld->mxBarriers.Right(iBarrier); ++iCol)
+        {
+            if (0 < pWorld->mxBarriers.mvHealth[iBarrier] && 0 <= iCol && iCol < pWorld->miBoardWidth)
+            {
+                pWorld->mvBarrierColumns[iCol] = iBarrier;
+            }
+        }
+    }
+
+    // Each chunk's cells start where its place in the list of chunks in use says.
+    OccupancyGrid *pGrid = &pWorld->mxGrid;
+    pGrid->Clear();
+    pPos = GetArray(pPos, &pGrid->mvUsed, xHead.miChunks);
+    GetArray(pPos, &pGrid->mvCells, static_cast<size_t>(xHead.miChunks) * c_iGridChunkCells);
+
+    for (u32 iIdx = 0; iIdx < pGrid->mvUsed.size(); ++iIdx)
+    {
+        pGrid->mvChunkAt[pGrid->mvUsed[iIdx]] = iIdx * c_iGridChunkCells;
+    }
+
+    pWorld->mxDirty.mbFullRedraw = true;
+
+    return EError_OK;
+}
+
+bool SnapshotBoardSize(const std::vector<byte> &vData, u32 *pWidth, u32 *pHeight)
+{
+    SnapshotHeader xHead;
+
+    if (!ReadHeader(vData, &xHead))
+    {
+        return false;
+    }
+
+    *pWidth = xHead.miBoardWidth;
+    *pHeight = xHead.miBoardHeight;
+    return true;
+}
+
+EError SnapshotWrite(const std::vector<byte> &vData, const char *pPath)
+{
+    FILE *pFile = fopen(pPath, "wb");
+
+    if (nullptr == pFile)
+    {
+        return EError_Unknown;
+    }
+
+    bool bWritten = (vData.size() == fwrite(vData.data(), 1, vData.size(), pFile));
+    bWritten = (0 == fclose(pFile)) && bWritten;
+
+    return bWritten ? EError_OK : EError_Unknown;
+}
+
+EError SnapshotRead(std::vector<byte> *pData, const char *pPath)
+{
+    FILE *pFile = fopen(pPath, "rb");
+
+    if (nullptr == pFile)
+    {
+        return EError_Unknown;
+    }
+
+    pData->clear();
+
+    byte cBuf[4096];
+    size_t iRead = 0;
+
+    while (0 < (iRead = fread(cBuf, 1, sizeof(cBuf), pFile)))
+    {
+        pData->insert(pData->end(), cBuf, cBuf + iRead);
+    }
+
+    fclose(pFile);
+
+    return EError_OK;
+}
+
+void RewindInit(RewindRing *pRing, u32 aiSeconds, u32 aiTickRate)
+{
+    pRing->mvSlots.resize(aiSeconds * c_iRewindPerSecond);
+    pRing->mvTick.assign(pRing->mvSlots.size(), 0);
+    pRing->miInterval = (c_iRewindPerSecond < aiTickRate) ? (aiTickRate / c_iRewindPerSecond) : 1;
+    RewindClear(pRing);
+}
+
+void RewindClear(RewindRing *pRing)
+{
+    pRing->miHead = 0;
+    pRing->miCount = 0;
+}
+
+void RewindTake(RewindRing *pRing, u64 aiTick, const GameObject *pPlayer, const GameObject *pScore)
+{
+    u32 iSlots = pRing->mvSlots.size();
+
+    if (0 == iSlots || 0 != (aiTick % pRing->miInterval))
+    {
+        return;
+    }
+
+    // Right after rewinding, the newest snapshot already is this tick.
+    u32 iNewest = (pRing->miHead + iSlots - 1) % iSlots;
+
+    if (0 < pRing->miCount && aiTick == pRing->mvTick[iNewest])
+    {
+        return;
+    }
+
+    u64 iStart = GetMonotonicNs();
+
+    SnapshotSave(&pRing->mvSlots[pRing->miHead], aiTick, pPlayer, pScore);
+    pRing->mvTick[pRing->miHead] = aiTick;
+    pRing->miLargest = std::max(pRing->miLargest, pRing->mvSlots[pRing->miHead].size());
+    pRing->miHead = (pRing->miHead + 1) % iSlots;
+    pRing->miCount = std::min(pRing->miCount + 1, iSlots);
+
+    ++pRing->miTaken;
+    pRing->miSaveNs += GetMonotonicNs() - iStart;
+}
+
+bool RewindBack(RewindRing *pRing, u64 aiTicks, GameObject *pPlayer, GameObject *pScore, u64 *pTick)
+{
+    u32 iSlots = pRing->mvSlots.size();
+
+    if (0 == pRing->miCount)
+    {
+        return false;
+    }
+
+    // Everything taken since the tick being gone back to is dropped, down to the oldest snapshot if need be. The one
+    // restored stays, so going back again starts from it.
+    u64 iTarget = (*pTick > aiTicks) ? (*pTick - aiTicks) : 0;
+    u32 iNewest = (pRing->miHead + iSlots - 1) % iSlots;
+
+    while (1 < pRing->miCount && pRing->mvTick[iNewest] > iTarget)
+    {
+        pRing->miHead = iNewest;
+        --pRing->miCount;
+        iNewest = (pRing->miHead + iSlots - 1) % iSlots;
+    }
+
+    if (EError_OK != SnapshotRestore(pRing->mvSlots[iNewest], pPlayer, pScore, pTick))
+    {
+        return false;
+    }
+
+    ++pRing->miRewinds;
+    return true;
+}
+
+void RewindReport(const RewindRing *pRing, FILE *pOut)
+{
+    fprintf(pOut, "Rewind: %zu seconds    Snapshots: %llu    Largest: %zu bytes    Save: %.1fus    Rewinds: %llu\n",
+            pRing->mvSlots.size() / c_iRewindPerSecond, pRing->miTaken, pRing->miLargest,
+            (0 == pRing->miTaken) ? 0.0 : (pRing->miSaveNs / 1000.0 / pRing->miTaken), pRing->miRewinds);
+}
+
+void CrashDumpTake(CrashDump *pDump, u64 aiTick, const GameObject *pPlayer, const GameObject *pScore)
+{
+    if (nullptr == pDump->msPath)
+    {
+        return;
+    }
+
+    u64 iStart = GetMonotonicNs();
+    int iNext = (0 == pDump->miReady) ? 1 : 0;
+
+    SnapshotSave(&pDump->mvBuffers[iNext], aiTick, pPlayer, pScore);
+
+    // The snapshot has to be all there before a handler can see it's the one to write.
+    std::atomic_signal_fence(std::memory_order_release);
+    pDump->miReady = iNext;
+
+    ++pDump->miTaken;
+    pDump->miSaveNs += GetMonotonicNs() - iStart;
+}
+
+// Only open(), write() and close() are safe in a signal handler, so that's all this uses.
+void CrashDumpWrite(const CrashDump *pDump)
+{
+    int iReady = pDump->miReady;
+
+    if (nullptr == pDump->msPath || 0 > iReady)
+    {
+        return;
+    }
+
+    std::atomic_signal_fence(std::memory_order_acquire);
+
+    int iFd = open(pDump->msPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (0 > iFd)
+    {
+        return;
+    }
+
+    const byte *pData = pDump->mvBuffers[iReady].data();
+    size_t iLeft = pDump->mvBuffers[iReady].size();
+
+    while (0 < iLeft)
+    {
+        ssize_t iWritten = write(iFd, pData, iLeft);
+
+        if (0 >= iWritten)
+        {
+            break;
+        }
+
+        pData += iWritten;
+        iLeft -= iWritten;
+    }
+
+    close(iFd);
+}
+
+void CrashDumpReport(const CrashDump *pDump, FILE *pOut)
+{
+    fprintf(pOut, "Crash dump: %s    Snapshots: %llu    Save: %.1fus\n", pDump->msPath, pDump->miTaken,
+            (0 == pDump->miTaken) ? 0.0 : (pDump->miSaveNs / 1000.0 / pDump->miTaken));
+}
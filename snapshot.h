@@ -0,0 +1,84 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    World snapshots. Everything a game needs to carry on from a tick (the world, the player and the score) is packed
+ *    into one flat buffer and unpacked again with a handful of memcpy()s, so taking one every frame costs next to
+ *    nothing. The front-end keeps the last few seconds of them in a RewindRing to rewind with, and the latest one in a
+ *    CrashDump to write out if the game goes down.
+ *
+ *    Layout:
+ *        SnapshotHeader                                        Every fixed size field, magic "SISN" and version first.
+ *        horde alive mask, column counts, row counts, row sprites, row values
+ *        barrier lefts, barrier health
+ *        player lane x, y, sub-y, slot, slots; then the enemy lane's
+ *        grid chunks in use, then their cells
+ *
+ *    Each array is stored whole, its length is in the header. Nothing is converted, so integers are in the machine's
+ *    own byte order and a snapshot is only meant to be read back by the same build that took it. What can be worked
+ *    out from the rest (the barrier column table) isn't stored, and neither is what belongs to the front-end (the
+ *    view and the dirty cells, a restored world is redrawn in full).
+ */
+#ifndef SHELL_INVADERS_SNAPSHOT_H
+#define SHELL_INVADERS_SNAPSHOT_H
+
+#include <cstdio>
+#include <vector>
+
+#include <signal.h>
+
+#include "game.h"
+
+const u32 c_iRewindPerSecond = 4; //!< Snapshots the rewind ring takes every second of play.
+
+// The last few seconds of play, a snapshot every miInterval ticks. Slots are reused as the ring goes round, so once
+// it's gone round once, taking a snapshot never allocates.
+struct RewindRing
+{
+    std::vector<std::vector<byte> > mvSlots;
+    std::vector<u64> mvTick; //!< Tick each slot's snapshot was taken on.
+    u32 miHead; //!< Slot the next snapshot goes in.
+    u32 miCount; //!< Snapshots held, the newest just before miHead.
+    u32 miInterval; //!< Ticks between snapshots.
+    u64 miTaken;
+    u64 miRewinds;
+    u64 miSaveNs; //!< Time spent taking snapshots.
+    size_t miLargest; //!< Biggest snapshot taken, in bytes.
+
+    RewindRing() : miHead(0), miCount(0), miInterval(1), miTaken(0), miRewinds(0), miSaveNs(0), miLargest(0) {}
+};
+
+// The world as of the last frame, kept for writing out from a signal handler. It's taken into whichever buffer isn't
+// the complete one and then flipped, so a crash part way through taking one still leaves the last whole one behind.
+struct CrashDump
+{
+    const char *msPath; //!< Where it's written, nullptr when crash dumps are off.
+    std::vector<byte> mvBuffers[2];
+    volatile sig_atomic_t miReady; //!< Buffer holding the last complete snapshot, -1 before the first.
+    u64 miTaken;
+    u64 miSaveNs;
+
+    CrashDump() : msPath(nullptr), miReady(-1), miTaken(0), miSaveNs(0) {}
+};
+
+// Saving packs up g_pWorld, the player and the score as of a tick, and restoring puts them back and hands back the
+// tick. A snapshot is only restored onto a board the size it was taken on (see SnapshotBoardSize()).
+void SnapshotSave(std::vector<byte> *pOut, u64 aiTick, const GameObject *pPlayer, const GameObject *pScore);
+EError SnapshotRestore(const std::vector<byte> &vData, GameObject *pPlayer, GameObject *pScore, u64 *pTick);
+bool SnapshotBoardSize(const std::vector<byte> &vData, u32 *pWidth, u32 *pHeight); //!< The board it was taken on.
+EError SnapshotWrite(const std::vector<byte> &vData, const char *pPath);
+EError SnapshotRead(std::vector<byte> *pData, const char *pPath);
+
+void RewindInit(RewindRing *pRing, u32 aiSeconds, u32 aiTickRate); //!< Sizes the ring, 0 seconds turns it off.
+void RewindClear(RewindRing *pRing); //!< Forgets every snapshot, the storage is kept.
+void RewindTake(RewindRing *pRing, u64 aiTick, const GameObject *pPlayer, const GameObject *pScore); //!< When due.
+bool RewindBack(RewindRing *pRing, u64 aiTicks, GameObject *pPlayer, GameObject *pScore, u64 *pTick); //!< Goes back.
+void RewindReport(const RewindRing *pRing, FILE *pOut);
+
+void CrashDumpTake(CrashDump *pDump, u64 aiTick, const GameObject *pPlayer, const GameObject *pScore);
+void CrashDumpWrite(const CrashDump *pDump); //!< Writes the last complete snapshot out, safe in a signal handler.
+void CrashDumpReport(const CrashDump *pDump, FILE *pOut);
+
+#endif // SHELL_INVADERS_SNAPSHOT_H
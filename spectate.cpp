@@ -0,0 +1,608 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ */
+#include <cstring>
+#include <cerrno>
+
+// Linux specific headers.
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "spectate.h"
+#include "ansi_renderer.h"
+#include "scheduler.h"
+
+static const char c_sSpectateMagic[4] = { 'S', 'I', 'S', 'P' };
+static const u32 c_iSpectateVersion = 1;
+static const u32 c_iHelloSize = 8;
+static const u32 c_iFrameHeaderSize = 13;
+static const byte c_iKindKey = 'K';
+static const byte c_iKindDelta = 'D';
+static const u32 c_iMaxVarintBytes = 5; //!< Longest a u32 gets as a varint.
+
+// Unchanged cells this few between two changed ones are cheaper to send again than to start a new run over.
+static const u32 c_iMaxRunGap = 1;
+
+// Most queued frames handed to the kernel in one sendmsg().
+static const u32 c_iMaxSendFrames = 16;
+
+static void PutInt(std::vector<byte> *pOut, u64 aiValue, u32 aiBytes)
+{
+    for (u32 iIdx = 0; iIdx < aiBytes; ++iIdx)
+    {
+        pOut->push_back(static_cast<byte>((aiValue >> (iIdx * 8)) & 0xFF));
+    }
+}
+
+// Seven bits at a time, lowest first, the top bit says more follow.
+static void PutVarint(std::vector<byte> *pOut, u64 aiValue)
+{
+    while (0x80 <= aiValue)
+    {
+        pOut->push_back(static_cast<byte>((aiValue & 0x7F) | 0x80));
+        aiValue >>= 7;
+    }
+
+    pOut->push_back(static_cast<byte>(aiValue));
+}
+
+static u64 GetInt(const byte *pIn, u32 aiBytes)
+{
+    u64 iValue = 0;
+
+    for (u32 iIdx = 0; iIdx < aiBytes; ++iIdx)
+    {
+        iValue |= static_cast<u64>(pIn[iIdx]) << (iIdx * 8);
+    }
+
+    return iValue;
+}
+
+static bool GetVarint(const byte *pIn, size_t aiLen, size_t *pPos, u64 *pValue)
+{
+    *pValue = 0;
+
+    for (u32 iShift = 0; iShift < 64 && *pPos < aiLen; iShift += 7)
+    {
+        byte iByte = pIn[(*pPos)++];
+        *pValue |= static_cast<u64>(iByte & 0x7F) << iShift;
+
+        if (0 == (iByte & 0x80))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Turns a frame into runs of the cells that differ from pBase, or from a blank screen when there's no base.
+static SharedFrame Encode(const FrameBuffer *pFrame, const FrameBuffer *pBase, u32 aiFrame)
+{
+    std::vector<byte> *pOut = new std::vector<byte>();
+    SharedFrame pShared(pOut);
+
+    u32 iCells = pFrame->miWidth * pFrame->miHeight;
+    const Cell *pCells = &pFrame->mvCells[0];
+    const Cell *pBaseCells = (nullptr == pBase) ? nullptr : &pBase->mvCells[0];
+    const Cell xBlank = { ' ', EColor_Default };
+
+    pOut->reserve(c_iFrameHeaderSize + ((nullptr == pBase) ? (iCells * 2) : 256));
+    pOut->push_back((nullptr == pBase) ? c_iKindKey : c_iKindDelta);
+    PutInt(pOut, pFrame->miWidth, 2);
+    PutInt(pOut, pFrame->miHeight, 2);
+    PutInt(pOut, aiFrame, 4);
+    PutInt(pOut, 0, 4);
+
+    u32 iLastEnd = 0;
+    u32 iIdx = 0;
+
+    while (iIdx < iCells)
+    {
+        if (pCells[iIdx] == ((nullptr == pBaseCells) ? xBlank : pBaseCells[iIdx]))
+        {
+            ++iIdx;
+            continue;
+        }
+
+        // Carry the run on over short gaps of unchanged cells.
+        u32 iStart = iIdx;
+        u32 iEnd = iIdx + 1;
+
+        for (iIdx = iEnd; iIdx < iCells && (iIdx - iEnd) <= c_iMaxRunGap; ++iIdx)
+        {
+            if (pCells[iIdx] != ((nullptr == pBaseCells) ? xBlank : pBaseCells[iIdx]))
+            {
+                iEnd = iIdx + 1;
+            }
+        }
+
+        PutVarint(pOut, iStart - iLastEnd);
+        PutVarint(pOut, iEnd - iStart);
+
+        for (u32 iCell = iStart; iCell < iEnd; ++iCell)
+        {
+            pOut->push_back(static_cast<byte>(pCells[iCell].mcGlyph));
+            pOut->push_back(pCells[iCell].miColor);
+        }
+
+        iLastEnd = iEnd;
+        iIdx = iEnd;
+    }
+
+    u32 iSize = pOut->size() - c_iFrameHeaderSize;
+    for (u32 iByte = 0; iByte < 4; ++iByte)
+    {
+        (*pOut)[9 + iByte] = static_cast<byte>((iSize >> (iByte * 8)) & 0xFF);
+    }
+
+    return pShared;
+}
+
+// The most a frame that size can take to encode, with every cell a run of its own.
+static u64 MaxFrameSize(u32 aiWidth, u32 aiHeight)
+{
+    return static_cast<u64>(aiWidth) * aiHeight * (2 + (2 * c_iMaxVarintBytes));
+}
+
+// Applies a frame's runs on top of whatever the buffer holds. False if they don't fit in it.
+static bool Decode(FrameBuffer *pFrame, const byte *pRuns, size_t aiLen)
+{
+    u64 iCells = pFrame->mvCells.size();
+    u64 iPos = 0;
+    size_t iRead = 0;
+
+    while (iRead < aiLen)
+    {
+        u64 iSkip = 0;
+        u64 iCount = 0;
+
+        // Each is checked against what's left rather than added up, so values off the wire can't wrap the sums.
+        if (!GetVarint(pRuns, aiLen, &iRead, &iSkip) || !GetVarint(pRuns, aiLen, &iRead, &iCount) ||
+            iSkip > (iCells - iPos) || iCount > (iCells - iPos - iSkip) || iCount > ((aiLen - iRead) / 2))
+        {
+            return false;
+        }
+
+        iPos += iSkip;
+
+        for (u64 iCell = 0; iCell < iCount; ++iCell, ++iPos, iRead += 2)
+        {
+            pFrame->mvCells[iPos].mcGlyph = static_cast<char>(pRuns[iRead]);
+            pFrame->mvCells[iPos].miColor = pRuns[iRead + 1];
+        }
+    }
+
+    return true;
+}
+
+// Sends as much of a spectator's queue as the socket will take without blocking. False once it has hung up.
+static bool FlushSpectator(Spectator *pSpectator)
+{
+    while (!pSpectator->mvQueue.empty())
+    {
+        // The frames go out straight from the shared buffers.
+        struct iovec vIov[c_iMaxSendFrames];
+        u32 iIovs = 0;
+
+        for (u32 iIdx = 0; iIdx < pSpectator->mvQueue.size() && iIovs < c_iMaxSendFrames; ++iIdx, ++iIovs)
+        {
+            const std::vector<byte> &rFrame = *pSpectator->mvQueue[iIdx];
+            size_t iSkip = (0 == iIdx) ? pSpectator->miSent : 0;
+
+            vIov[iIovs].iov_base = const_cast<byte*>(&rFrame[iSkip]);
+            vIov[iIovs].iov_len = rFrame.size() - iSkip;
+        }
+
+        struct msghdr sMsg;
+        memset(&sMsg, 0, sizeof(sMsg));
+        sMsg.msg_iov = vIov;
+        sMsg.msg_iovlen = iIovs;
+
+        ssize_t iSent = sendmsg(pSpectator->miFd, &sMsg, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+        if (0 > iSent)
+        {
+            return (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno);
+        }
+
+        pSpectator->miQueued -= iSent;
+
+        // Pop everything that went out whole.
+        size_t iLeft = iSent + pSpectator->miSent;
+        pSpectator->miSent = 0;
+
+        while (!pSpectator->mvQueue.empty() && iLeft >= pSpectator->mvQueue.front()->size())
+        {
+            iLeft -= pSpectator->mvQueue.front()->size();
+            pSpectator->mvQueue.pop_front();
+        }
+
+        pSpectator->miSent = iLeft;
+
+        if (0 != iLeft)
+        {
+            // The socket's full.
+            return true;
+        }
+    }
+
+    return true;
+}
+
+EError SpectateListen(SpectatorServer *pServer, const char *pPath)
+{
+    if (nullptr == pServer || nullptr == pPath)
+    {
+        return EError_InvalidArg;
+    }
+
+    struct sockaddr_un sAddr;
+    memset(&sAddr, 0, sizeof(sAddr));
+    sAddr.sun_family = AF_UNIX;
+
+    if (strlen(pPath) >= sizeof(sAddr.sun_path))
+    {
+        return EError_InvalidArg;
+    }
+
+    strcpy(sAddr.sun_path, pPath);
+
+    int iFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (0 > iFd)
+    {
+        return EError_Unknown;
+    }
+
+    // A socket left behind by a game that didn't get to clean up would fail the bind.
+    unlink(pPath);
+
+    if (0 != bind(iFd, reinterpret_cast<struct sockaddr*>(&sAddr), sizeof(sAddr)) || 0 != listen(iFd, 16))
+    {
+        close(iFd);
+        return EError_Unknown;
+    }
+
+    pServer->miListenFd = iFd;
+    pServer->msPath = pPath;
+    pServer->mbHaveLast = false;
+
+    return EError_OK;
+}
+
+bool SpectatePoll(SpectatorServer *pServer)
+{
+    if (0 > pServer->miListenFd)
+    {
+        return false;
+    }
+
+    for (;;)
+    {
+        int iFd = accept4(pServer->miListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (0 > iFd)
+        {
+            break;
+        }
+
+        // The hello always fits in an empty socket.
+        std::vector<byte> vHello(c_sSpectateMagic, c_sSpectateMagic + sizeof(c_sSpectateMagic));
+        PutInt(&vHello, c_iSpectateVersion, 4);
+
+        if (static_cast<ssize_t>(c_iHelloSize) != send(iFd, &vHello[0], vHello.size(), MSG_DONTWAIT | MSG_NOSIGNAL))
+        {
+            close(iFd);
+            continue;
+        }
+
+        Spectator xSpectator;
+        xSpectator.miFd = iFd;
+        pServer->mvSpectators.push_back(xSpectator);
+        ++pServer->miJoined;
+
+        // Nobody should have to wait on the next keyframe to see something.
+        pServer->mbHaveLast = false;
+    }
+
+    // With nobody watching there's nothing to take a delta against.
+    if (pServer->mvSpectators.empty())
+    {
+        pServer->mbHaveLast = false;
+    }
+
+    return !pServer->mvSpectators.empty();
+}
+
+void SpectatePublish(SpectatorServer *pServer, const FrameBuffer *pFrame)
+{
+    if (pServer->mvSpectators.empty())
+    {
+        return;
+    }
+
+    u64 iStart = GetMonotonicNs();
+
+    // Sizes only change with a new board, which starts over on a keyframe.
+    bool bKey = !pServer->mbHaveLast || c_iKeyframeInterval <= pServer->miSinceKey ||
+                pFrame->miWidth != pServer->mxLast.miWidth || pFrame->miHeight != pServer->mxLast.miHeight;
+
+    SharedFrame pEncoded = Encode(pFrame, bKey ? nullptr : &pServer->mxLast, pServer->miFrame);
+
+    pServer->mxLast.miWidth = pFrame->miWidth;
+    pServer->mxLast.miHeight = pFrame->miHeight;
+    pServer->mxLast.mvCells = pFrame->mvCells;
+    pServer->mbHaveLast = true;
+    pServer->miSinceKey = bKey ? 1 : (pServer->miSinceKey + 1);
+    pServer->miKeyframes += bKey ? 1 : 0;
+    pServer->miEncodedBytes += pEncoded->size();
+    ++pServer->miFrame;
+
+    pServer->miEncodeNs += GetMonotonicNs() - iStart;
+
+    // Every spectator gets a reference to the same bytes.
+    for (u32 iIdx = 0; iIdx < pServer->mvSpectators.size(); )
+    {
+        Spectator *pSpectator = &pServer->mvSpectators[iIdx];
+
+        if (c_iSpectatorBacklog < pSpectator->miQueued)
+        {
+            // Too far behind, so it gets whatever frame is half sent and then nothing until a keyframe.
+            size_t iKeep = (0 == pSpectator->miSent) ? 0 : 1;
+
+            while (iKeep < pSpectator->mvQueue.size())
+            {
+                pSpectator->miQueued -= pSpectator->mvQueue.back()->size();
+                pSpectator->mvQueue.pop_back();
+            }
+
+            pSpectator->mbWaitKey = true;
+            ++pServer->miSkipped;
+        }
+
+        if (bKey || !pSpectator->mbWaitKey)
+        {
+            pSpectator->mvQueue.push_back(pEncoded);
+            pSpectator->miQueued += pEncoded->size();
+            pSpectator->mbWaitKey = false;
+        }
+
+        if (FlushSpectator(pSpectator))
+        {
+            ++iIdx;
+            continue;
+        }
+
+        // It hung up.
+        close(pSpectator->miFd);
+        pServer->mvSpectators[iIdx] = pServer->mvSpectators.back();
+        pServer->mvSpectators.pop_back();
+        ++pServer->miLeft;
+    }
+}
+
+void SpectateClose(SpectatorServer *pServer)
+{
+    for (u32 iIdx = 0; iIdx < pServer->mvSpectators.size(); ++iIdx)
+    {
+        close(pServer->mvSpectators[iIdx].miFd);
+    }
+
+    pServer->mvSpectators.clear();
+
+    if (0 <= pServer->miListenFd)
+    {
+        close(pServer->miListenFd);
+        unlink(pServer->msPath);
+        pServer->miListenFd = -1;
+    }
+}
+
+void SpectateReport(const SpectatorServer *pServer, FILE *pOut)
+{
+    fprintf(pOut, "Spectators: %llu    Left: %llu    Skipped to a keyframe: %llu    Frames: %u    Keyframes: %llu"
+            "    Bytes/frame: %.1f    Encode: %.1fus/frame\n", pServer->miJoined, pServer->miLeft, pServer->miSkipped,
+            pServer->miFrame, pServer->miKeyframes,
+            (0 == pServer->miFrame) ? 0.0 : (static_cast<double>(pServer->miEncodedBytes) / pServer->miFrame),
+            (0 == pServer->miFrame) ? 0.0 : (pServer->miEncodeNs / 1000.0 / pServer->miFrame));
+}
+
+int RunWatch(const char *pPath, EPalette aePalette)
+{
+    struct sockaddr_un sAddr;
+    memset(&sAddr, 0, sizeof(sAddr));
+    sAddr.sun_family = AF_UNIX;
+
+    int iFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (0 > iFd || strlen(pPath) >= sizeof(sAddr.sun_path) ||
+        (strcpy(sAddr.sun_path, pPath), 0 != connect(iFd, reinterpret_cast<struct sockaddr*>(&sAddr), sizeof(sAddr))))
+    {
+        fprintf(stderr, "Was unable to connect to the game at %s!\n", pPath);
+        if (0 <= iFd)
+        {
+            close(iFd);
+        }
+        return -1;
+    }
+
+    // Raw keys, so ESC or q can stop watching.
+    struct termios sOrig;
+    struct termios sRaw;
+    tcgetattr(STDIN_FILENO, &sOrig);
+    sRaw = sOrig;
+    cfmakeraw(&sRaw);
+    tcsetattr(STDIN_FILENO, TCSANOW, &sRaw);
+
+    AnsiRenderer xRenderer;
+    FrameBuffer xFrame;
+    bool bStarted = false; //!< The renderer is set up for the stream's screen size.
+    bool bHello = false;
+    bool bKeyed = false; //!< A keyframe has come in, deltas mean something from here on.
+    bool bWatching = true;
+    const char *pEnd = "The game ended.";
+    std::vector<byte> vIn;
+    u64 iFrames = 0;
+    u64 iKeyframes = 0;
+    u64 iBytes = 0;
+
+    while (bWatching)
+    {
+        struct pollfd vFds[2];
+        vFds[0].fd = iFd;
+        vFds[0].events = POLLIN;
+        vFds[1].fd = STDIN_FILENO;
+        vFds[1].events = POLLIN;
+
+        if (0 > poll(vFds, 2, -1))
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+
+            break;
+        }
+
+        if (0 != (vFds[1].revents & POLLIN))
+        {
+            char vKeys[64];
+            ssize_t iKeys = read(STDIN_FILENO, vKeys, sizeof(vKeys));
+
+            for (ssize_t iIdx = 0; iIdx < iKeys; ++iIdx)
+            {
+                if (27 == vKeys[iIdx] || 'q' == vKeys[iIdx])
+                {
+                    bWatching = false;
+                    pEnd = nullptr;
+                }
+            }
+        }
+
+        if (0 == (vFds[0].revents & (POLLIN | POLLHUP | POLLERR)))
+        {
+            continue;
+        }
+
+        byte vBuf[65536];
+        ssize_t iRead = read(iFd, vBuf, sizeof(vBuf));
+
+        if (0 >= iRead)
+        {
+            break;
+        }
+
+        vIn.insert(vIn.end(), vBuf, vBuf + iRead);
+        iBytes += iRead;
+
+        // Apply every whole frame that's in, only the last of them gets shown.
+        size_t iPos = 0;
+        bool bNew = false;
+
+        if (!bHello && c_iHelloSize <= vIn.size())
+        {
+            if (0 != memcmp(&vIn[0], c_sSpectateMagic, sizeof(c_sSpectateMagic)) ||
+                c_iSpectateVersion != GetInt(&vIn[4], 4))
+            {
+                pEnd = "That isn't a game that can be watched.";
+                break;
+            }
+
+            bHello = true;
+            iPos = c_iHelloSize;
+        }
+
+        while (bHello && (iPos + c_iFrameHeaderSize) <= vIn.size())
+        {
+            const byte *pHeader = &vIn[iPos];
+            u32 iWidth = GetInt(pHeader + 1, 2);
+            u32 iHeight = GetInt(pHeader + 3, 2);
+            size_t iSize = GetInt(pHeader + 9, 4);
+
+            // The sizes come off the wire. A frame no game could have sent ends the stream before any of it is
+            // buffered.
+            if (c_iMinBoardWidth > iWidth || c_iMaxBoardWidth < iWidth || c_iMinBoardHeight > iHeight ||
+                c_iMaxBoardHeight < iHeight || MaxFrameSize(iWidth, iHeight) < iSize)
+            {
+                pEnd = "The game sent a frame that makes no sense.";
+                bWatching = false;
+                break;
+            }
+
+            if ((iPos + c_iFrameHeaderSize + iSize) > vIn.size())
+            {
+                break;
+            }
+
+            const byte *pRuns = pHeader + c_iFrameHeaderSize;
+
+            if (c_iKindKey == pHeader[0])
+            {
+                xFrame.Resize(iWidth, iHeight);
+                bKeyed = Decode(&xFrame, pRuns, iSize);
+                iKeyframes += 1;
+            }
+            else if (bKeyed && iWidth == xFrame.miWidth && iHeight == xFrame.miHeight)
+            {
+                bKeyed = Decode(&xFrame, pRuns, iSize);
+            }
+
+            bNew = bNew || bKeyed;
+            ++iFrames;
+            iPos += c_iFrameHeaderSize + iSize;
+        }
+
+        vIn.erase(vIn.begin(), vIn.begin() + iPos);
+
+        if (!bNew)
+        {
+            continue;
+        }
+
+        // The screen is laid out for the stream's board size, starting over if it changes.
+        if (bStarted && (xFrame.miWidth != xRenderer.mxBack.miWidth || xFrame.miHeight != xRenderer.mxBack.miHeight))
+        {
+            AnsiShutdown(&xRenderer);
+            bStarted = false;
+        }
+
+        if (!bStarted)
+        {
+            xRenderer = AnsiRenderer();
+
+            if (EError_OK != AnsiInit(&xRenderer, STDOUT_FILENO, xFrame.miWidth, xFrame.miHeight, aePalette))
+            {
+                pEnd = "Was unable to write to the terminal!";
+                break;
+            }
+
+            bStarted = true;
+        }
+
+        xRenderer.mxBack.mvCells = xFrame.mvCells;
+        AnsiPresent(&xRenderer);
+    }
+
+    if (bStarted)
+    {
+        AnsiShutdown(&xRenderer);
+    }
+
+    tcsetattr(STDIN_FILENO, TCSANOW, &sOrig);
+    close(iFd);
+
+    if (nullptr != pEnd)
+    {
+        fprintf(stderr, "%s\n", pEnd);
+    }
+
+    fprintf(stderr, "Watched: %llu frames    Keyframes: %llu    Bytes: %llu\n", iFrames, iKeyframes, iBytes);
+
+    return 0;
+}
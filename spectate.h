@@ -0,0 +1,81 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    Spectating. A game started with --spectate PATH listens on a Unix domain socket and streams every frame it
+ *    draws to whoever connects; --watch PATH connects and shows the stream with the ANSI renderer.
+ *
+ *    Each frame is encoded once, as the cells that changed since the last one, and every spectator's queue holds a
+ *    reference to that same buffer, so the cost of encoding doesn't depend on how many are watching. Every
+ *    c_iKeyframeInterval frames a keyframe carries the whole screen. Spectators join on a keyframe, and one that
+ *    can't keep up (more than c_iSpectatorBacklog bytes behind) has its backlog thrown away and picks up again at the
+ *    next keyframe. Sockets are never blocked on, so a slow spectator can't hold up the game.
+ *
+ *    Stream layout (all integers little endian):
+ *        "SISP" u32 version                                    Once, on connecting.
+ *        byte kind, u16 width, u16 height, u32 frame, u32 size   Every frame, kind is 'K' (keyframe) or 'D' (delta).
+ *        varint skip, varint count, count x (glyph, color)     Runs of cells making up the frame's size bytes.
+ *
+ *    A run starts skip cells past the end of the last one (row major, from the top-left for the first) and overwrites
+ *    the next count. A keyframe starts from a blank screen, a delta from the frame before it.
+ */
+#ifndef SHELL_INVADERS_SPECTATE_H
+#define SHELL_INVADERS_SPECTATE_H
+
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "game.h"
+#include "framebuffer.h"
+#include "palette.h"
+
+const u32 c_iKeyframeInterval = 60; //!< Frames between keyframes.
+const size_t c_iSpectatorBacklog = 256 * 1024; //!< Bytes a spectator can fall behind before it's skipped ahead.
+
+// One encoded frame, shared by every spectator it's queued for.
+typedef std::shared_ptr<const std::vector<byte> > SharedFrame;
+
+struct Spectator
+{
+    int miFd;
+    std::deque<SharedFrame> mvQueue; //!< Frames still to send, the front one may be partly sent.
+    size_t miSent; //!< Bytes of the front frame already sent.
+    size_t miQueued; //!< Bytes waiting to be sent, all frames included.
+    bool mbWaitKey; //!< Deltas are no use to it until it gets a keyframe.
+
+    Spectator() : miFd(-1), miSent(0), miQueued(0), mbWaitKey(true) {}
+};
+
+struct SpectatorServer
+{
+    int miListenFd; //!< -1 when nobody can spectate.
+    const char *msPath; //!< Socket the server is listening on.
+    std::vector<Spectator> mvSpectators;
+    FrameBuffer mxLast; //!< The last frame encoded, deltas are taken against it.
+    bool mbHaveLast; //!< Whether mxLast holds a frame, the next one's a keyframe when it doesn't.
+    u32 miFrame; //!< Frames encoded.
+    u32 miSinceKey; //!< Frames since the last keyframe.
+    u64 miKeyframes;
+    u64 miEncodedBytes;
+    u64 miEncodeNs;
+    u64 miJoined;
+    u64 miLeft;
+    u64 miSkipped; //!< Times a spectator fell too far behind and was skipped to a keyframe.
+
+    SpectatorServer() : miListenFd(-1), msPath(nullptr), mbHaveLast(false), miFrame(0), miSinceKey(0), miKeyframes(0),
+                        miEncodedBytes(0), miEncodeNs(0), miJoined(0), miLeft(0), miSkipped(0) {}
+};
+
+EError SpectateListen(SpectatorServer *pServer, const char *pPath); //!< Starts taking spectators on a socket.
+bool SpectatePoll(SpectatorServer *pServer); //!< Lets in anyone waiting to connect, returns whether anyone's watching.
+void SpectatePublish(SpectatorServer *pServer, const FrameBuffer *pFrame); //!< Encodes a frame once and sends it out.
+void SpectateClose(SpectatorServer *pServer); //!< Hangs up on every spectator and removes the socket.
+void SpectateReport(const SpectatorServer *pServer, FILE *pOut);
+
+int RunWatch(const char *pPath, EPalette aePalette); //!< Shows the game streamed on a socket, returns the exit code.
+
+#endif // SHELL_INVADERS_SPECTATE_H
@@ -0,0 +1,82 @@
+/*
+ * Space Invaders in yer shell!
+ * (c) 2016 Travis M Ervin
+ * 4 Spaces per TAB ; 120 Columns
+ *
+ * Desc:
+ *    Every sprite in the game, built at compile time: its characters, how wide it is, where its center sits and the
+ *    class of color it's drawn in. What a color class looks like on a given terminal is up to the palette the
+ *    renderer was started with (see palette.h). Adding a sprite is adding a line to c_vSprites.
+ */
+#ifndef SHELL_INVADERS_SPRITES_H
+#define SHELL_INVADERS_SPRITES_H
+
+typedef unsigned int u32;
+
+// Colors a sprite or cell can be drawn in.
+enum EColor
+{
+    EColor_Default, //!< Terminal default.
+    EColor_Red,
+    EColor_Green,
+    EColor_Yellow,
+    EColor_White,
+    EColor_Count
+};
+
+enum ESprite
+{
+    ESprite_Player,
+    ESprite_UFO,
+    ESprite_Enemy1, //!< Class 1 enemy.
+    ESprite_Enemy2, //!< Class 2 enemy.
+    ESprite_Enemy3, //!< Class 3 enemy.
+    ESprite_Barrier, //!< The barrier's health goes in its center cell.
+    ESprite_PlayerShot,
+    ESprite_EnemyShot,
+    ESprite_Count
+};
+
+struct Sprite
+{
+    const char *msGlyphs; //!< One character per cell.
+    u32 miWidth; //!< Cells wide.
+    int miCenter; //!< Cell the object's position refers to, counted from the left.
+    EColor meColor;
+};
+
+constexpr u32 GlyphWidth(const char *pGlyphs)
+{
+    return ('\0' == *pGlyphs) ? 0 : (1 + GlyphWidth(pGlyphs + 1));
+}
+
+constexpr Sprite MakeSprite(const char *pGlyphs, EColor aeColor)
+{
+    return Sprite{ pGlyphs, GlyphWidth(pGlyphs), static_cast<int>(GlyphWidth(pGlyphs) / 2), aeColor };
+}
+
+// In ESprite order.
+constexpr Sprite c_vSprites[ESprite_Count] =
+{
+    MakeSprite("<^>", EColor_Green),
+    MakeSprite("<~~~>", EColor_Red),
+    MakeSprite("@", EColor_White),
+    MakeSprite("$", EColor_White),
+    MakeSprite("&", EColor_White),
+    MakeSprite("[###9###]", EColor_Green),
+    MakeSprite("*", EColor_Yellow),
+    MakeSprite(".", EColor_Yellow)
+};
+
+constexpr const Sprite& SpriteOf(ESprite aeSprite)
+{
+    return c_vSprites[aeSprite];
+}
+
+// Barriers go from green to yellow to red as they're worn down.
+constexpr EColor BarrierColor(u32 aiHealth)
+{
+    return (7 <= aiHealth) ? EColor_Green : ((4 <= aiHealth) ? EColor_Yellow : EColor_Red);
+}
+
+#endif // SHELL_INVADERS_SPRITES_H